@@ -0,0 +1,38 @@
+#include "allocations.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+namespace {
+
+atomic<size_t> counter(0);
+
+}
+
+void *operator new(size_t size) {
+    counter.fetch_add(1, memory_order_relaxed);
+    void *p = malloc(size ? size : 1);
+    if (!p) {
+        throw bad_alloc();
+    }
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+size_t benchmarks::allocations() {
+    return counter.load(memory_order_relaxed);
+}
+
+string benchmarks::allocations_label(size_t allocations, size_t items) {
+    char label[64];
+    snprintf(label, sizeof(label), "%.1f allocations per item",
+             items ? static_cast<double>(allocations) / items : 0.0);
+    return label;
+}
@@ -0,0 +1,25 @@
+#ifndef BENCHMARKS_ALLOCATIONS_H_
+#define BENCHMARKS_ALLOCATIONS_H_
+
+#include <cstddef>
+#include <string>
+
+namespace benchmarks {
+
+/**
+ * The number of heap allocations made by the whole process so far.
+ *
+ * Every operator new of the benchmark binary is counted, so the
+ * difference between two readings is what the code in between
+ * allocated.
+ */
+std::size_t allocations();
+
+/**
+ * A label reporting allocations per item, for benchmark::State::SetLabel
+ */
+std::string allocations_label(std::size_t allocations, std::size_t items);
+
+}
+
+#endif // BENCHMARKS_ALLOCATIONS_H_
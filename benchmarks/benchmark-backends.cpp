@@ -0,0 +1,66 @@
+#include "fake-server.h"
+
+#include <api/client.h>
+#include <api/config.h>
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+
+using namespace std;
+using namespace benchmarks;
+
+namespace {
+
+/**
+ * A client for the backend given by range 0: 0 for REST, 1 for GraphQL
+ */
+api::Client::Ptr make_client(const benchmark::State &state) {
+    auto config = make_shared<api::Config>();
+    config->apiroot = FakeServer::instance().apiroot();
+    config->backend = state.range(0) ?
+                api::Config::Backend::graphql : api::Config::Backend::rest;
+    return api::Client::create(config);
+}
+
+/**
+ * A user search with every profile complete: one request per user on
+ * top of the search with REST, a single one with GraphQL
+ */
+void users_with_profiles(benchmark::State &state) {
+    auto client = make_client(state);
+
+    size_t users = 0;
+    size_t requests = 0;
+    while (state.KeepRunning()) {
+        auto result = client->users("qt");
+        ++requests;
+        if (!client->searches_return_profiles()) {
+            for (const auto &user : result.users) {
+                client->user(user.login);
+                ++requests;
+            }
+        }
+        users += result.users.size();
+    }
+    state.SetItemsProcessed(users);
+    state.SetLabel(to_string(requests / state.iterations()) + " requests per search");
+}
+BENCHMARK(users_with_profiles)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+/**
+ * The details of a repository preview: README, languages and release in
+ * three REST requests or one GraphQL one, plus the contributors
+ */
+void repository_details(benchmark::State &state) {
+    auto client = make_client(state);
+
+    while (state.KeepRunning()) {
+        benchmark::DoNotOptimize(client->details("user0/qt-0"));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(repository_details)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+}
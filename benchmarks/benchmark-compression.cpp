@@ -0,0 +1,68 @@
+#include "fake-server.h"
+
+#include <api/client.h>
+#include <api/config.h>
+
+#include <benchmark/benchmark.h>
+#include <core/net/http/client.h>
+#include <core/net/http/request.h>
+#include <core/net/http/response.h>
+
+#include <memory>
+#include <string>
+
+namespace http = core::net::http;
+
+using namespace std;
+using namespace benchmarks;
+
+namespace {
+
+/**
+ * Bytes on the wire for a 100 repository search page, with and without
+ * compression (range 0 is 1 for compressed)
+ */
+void repositories_wire_bytes(benchmark::State &state) {
+    auto client = http::make_client();
+
+    http::Request::Configuration configuration;
+    configuration.uri = FakeServer::instance().apiroot()
+            + "/search/repositories?q=qt&per_page=100";
+    if (state.range(0)) {
+        configuration.header.add("Accept-Encoding", "gzip, deflate");
+    }
+
+    // The plain client doesn't inflate anything, so the body is exactly
+    // what crossed the network
+    size_t bytes = 0;
+    while (state.KeepRunning()) {
+        auto response = client->get(configuration)->execute(
+                    [](const http::Request::Progress &) {
+            return http::Request::Progress::Next::continue_operation;
+        });
+        bytes += response.body.size();
+    }
+    state.SetBytesProcessed(bytes);
+    state.SetLabel(to_string(bytes / state.iterations()) + " bytes per page");
+}
+BENCHMARK(repositories_wire_bytes)->Arg(0)->Arg(1);
+
+/**
+ * End-to-end latency of a 100 repository search through the client,
+ * parsing included, with and without compression
+ */
+void repositories_latency(benchmark::State &state) {
+    auto config = make_shared<api::Config>();
+    config->apiroot = FakeServer::instance().apiroot();
+    config->compression = state.range(0);
+    api::Client client(config);
+
+    size_t repositories = 0;
+    while (state.KeepRunning()) {
+        repositories += client.repositories("qt", true, true, false, 100).repositories.size();
+    }
+    state.SetItemsProcessed(repositories);
+}
+BENCHMARK(repositories_latency)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
+
+}
@@ -0,0 +1,207 @@
+#include "allocations.h"
+
+#include <api/client.h>
+#include <api/decoder.h>
+#include <api/json_stream.h>
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QVariantMap>
+
+using namespace std;
+using namespace api;
+using namespace benchmarks;
+
+namespace {
+
+/**
+ * About what a socket read hands to the client at a time
+ */
+const size_t CHUNK = 16 * 1024;
+
+/**
+ * A repository object as the search API returns it, unused keys included
+ */
+void repository_json(ostream &out, int i) {
+    out << R"({"id": )" << 1000 + i << R"(, "name": "qt-)" << i
+        << R"(", "full_name": "user)" << i % 17 << "/qt-" << i
+        << R"(", "owner": {"login": "user)" << i % 17 << R"(", "id": )" << 100 + i % 17
+        << R"(, "avatar_url": "https://avatars.githubusercontent.com/u/)" << 100 + i % 17
+        << R"(?v=3", "url": "https://api.github.com/users/user)" << i % 17
+        << R"(", "html_url": "https://github.com/user)" << i % 17
+        << R"(", "type": "User", "site_admin": false}, "private": false)"
+        << R"(, "html_url": "https://github.com/user)" << i % 17 << "/qt-" << i
+        << R"(", "description": "A qt project, number )" << i
+        << R"( of the search results", "fork": )" << (i % 5 ? "false" : "true")
+        << R"(, "created_at": "2014-06-01T12:00:00Z", "updated_at": "2015-08-01T12:00:00Z")"
+        << R"(, "pushed_at": "2015-08-01T12:00:00Z", "size": )" << 100 * i
+        << R"(, "stargazers_count": )" << 1000 + i << R"(, "watchers_count": )" << 1000 + i
+        << R"(, "language": "C++", "forks_count": )" << i % 50
+        << R"(, "open_issues_count": )" << i % 7 << R"(, "score": 1.0})";
+}
+
+void code_json(ostream &out, int i) {
+    out << R"({"name": "file)" << i << R"(.cpp", "path": "src/file)" << i
+        << R"(.cpp", "sha": "d1a2b3c4d5e6f708192a3b4c5d6e7f8091a2b3c4")"
+        << R"(, "url": "https://api.github.com/repositories/1/contents/src/file)" << i
+        << R"(.cpp", "html_url": "https://github.com/user0/qt-0/blob/master/src/file)" << i
+        << R"(.cpp", "repository": )";
+    repository_json(out, i % 10);
+    out << R"(, "score": 1.0})";
+}
+
+void user_json(ostream &out, int i) {
+    out << R"({"login": "user)" << i << R"(", "id": )" << 100 + i
+        << R"(, "avatar_url": "https://avatars.githubusercontent.com/u/)" << 100 + i
+        << R"(?v=3", "url": "https://api.github.com/users/user)" << i
+        << R"(", "html_url": "https://github.com/user)" << i
+        << R"(", "type": "User", "site_admin": false, "score": 1.0})";
+}
+
+/**
+ * A search response with the given number of items
+ */
+string payload(void (*item)(ostream &, int), int count) {
+    ostringstream out;
+    out << R"({"total_count": )" << count << R"(, "incomplete_results": false, "items": [)";
+    for (int i = 0; i < count; ++i) {
+        if (i) {
+            out << ", ";
+        }
+        item(out, i);
+    }
+    out << "]}";
+    return out.str();
+}
+
+/**
+ * Streams a payload through the parser the client uses, in socket-sized
+ * chunks, decoding every item into a list of Record
+ */
+template<typename Record>
+void parse(benchmark::State &state, void (*item)(ostream &, int)) {
+    const string body = payload(item, state.range(0));
+
+    size_t items = 0;
+    size_t allocated = 0;
+    while (state.KeepRunning()) {
+        vector<Record> records;
+        size_t before = allocations();
+        JsonStream stream([&records](const QJsonObject &object) {
+            records.emplace_back();
+            decode(object, records.back());
+        });
+        for (size_t offset = 0; offset < body.size(); offset += CHUNK) {
+            stream.feed(body.data() + offset, min(CHUNK, body.size() - offset));
+        }
+        allocated += allocations() - before;
+        items += records.size();
+        benchmark::DoNotOptimize(records);
+    }
+    state.SetItemsProcessed(items);
+    state.SetBytesProcessed(body.size() * state.iterations());
+    state.SetLabel(allocations_label(allocated, items));
+}
+
+/**
+ * What Client::repositories() does with each page once it is off the network
+ */
+void parse_repositories(benchmark::State &state) {
+    parse<Client::Repository>(state, repository_json);
+}
+BENCHMARK(parse_repositories)->RangeMultiplier(10)->Range(10, 10000);
+
+void parse_code(benchmark::State &state) {
+    parse<Client::Code>(state, code_json);
+}
+BENCHMARK(parse_code)->RangeMultiplier(10)->Range(10, 10000);
+
+void parse_users(benchmark::State &state) {
+    parse<Client::User>(state, user_json);
+}
+BENCHMARK(parse_users)->RangeMultiplier(10)->Range(10, 10000);
+
+/**
+ * The QVariant based conversion that the decoder replaced
+ */
+Client::RepositoryList variant_repositories(const QJsonDocument &root) {
+    Client::RepositoryList result;
+    QVariantMap variant = root.toVariant().toMap();
+    QVariantList items = variant["items"].toList();
+    for (const QVariant &i : items) {
+        QVariantMap item = i.toMap();
+        QVariantMap owner = item["owner"].toMap();
+        result.emplace_back(
+                    Client::Repository {
+                        Client::Owner {
+                            owner["login"].toString().toStdString(),
+                            owner["id"].toUInt(),
+                            owner["avatar_url"].toString().toStdString(),
+                            owner["html_url"].toString().toStdString()
+                        },
+                        item["name"].toString().toStdString(),
+                        item["full_name"].toString().toStdString(),
+                        item["description"].toString().toStdString(),
+                        item["private"].toBool(),
+                        item["fork"].toBool(),
+                        item["html_url"].toString().toStdString(),
+                        item["language"].toString().toStdString(),
+                        item["forks_count"].toUInt(),
+                        item["stargazers_count"].toUInt(),
+                        item["watchers_count"].toUInt(),
+                        item["open_issues_count"].toUInt(),
+                        item["created_at"].toString().toStdString(),
+                        item["pushed_at"].toString().toStdString()
+                    });
+    }
+    return result;
+}
+
+Client::RepositoryList decoded_repositories(const QJsonDocument &root) {
+    Client::RepositoryList result;
+    for (const QJsonValue &item : root.object().value(QLatin1String("items")).toArray()) {
+        result.emplace_back();
+        decode(item.toObject(), result.back());
+    }
+    return result;
+}
+
+/**
+ * Converts an already parsed document into records, to compare the
+ * decoder with the QVariant conversion alone
+ */
+void convert(benchmark::State &state,
+             Client::RepositoryList (*conversion)(const QJsonDocument &)) {
+    const string body = payload(repository_json, state.range(0));
+    QJsonDocument root = QJsonDocument::fromJson(QByteArray(body.data(), body.size()));
+
+    size_t items = 0;
+    size_t allocated = 0;
+    while (state.KeepRunning()) {
+        size_t before = allocations();
+        Client::RepositoryList repositories = conversion(root);
+        allocated += allocations() - before;
+        items += repositories.size();
+        benchmark::DoNotOptimize(repositories);
+    }
+    state.SetItemsProcessed(items);
+    state.SetLabel(allocations_label(allocated, items));
+}
+
+void convert_repositories_qvariant(benchmark::State &state) {
+    convert(state, variant_repositories);
+}
+BENCHMARK(convert_repositories_qvariant)->Arg(100);
+
+void convert_repositories_decoder(benchmark::State &state) {
+    convert(state, decoded_repositories);
+}
+BENCHMARK(convert_repositories_decoder)->Arg(100);
+
+}
@@ -0,0 +1,58 @@
+#include <scope/renderers.h>
+#include <scope/settings_snapshot.h>
+
+#include <benchmark/benchmark.h>
+#include <unity/scopes/CategoryRenderer.h>
+#include <unity/scopes/Variant.h>
+
+namespace sc = unity::scopes;
+
+using namespace std;
+using namespace scope;
+
+namespace {
+
+sc::VariantMap settings() {
+    sc::VariantMap result;
+    result["searchName"] = sc::Variant(true);
+    result["searchDescription"] = sc::Variant(true);
+    result["searchReadme"] = sc::Variant(false);
+    result["resultLimit"] = sc::Variant(30.0);
+    return result;
+}
+
+/**
+ * What every query used to do before searching: build the renderers of
+ * its categories from their JSON and parse the settings
+ */
+void query_setup_per_query(benchmark::State &state) {
+    sc::VariantMap raw = settings();
+    while (state.KeepRunning()) {
+        sc::CategoryRenderer repositories(Renderers::REPOSITORY_TEMPLATE);
+        sc::CategoryRenderer code(Renderers::CODE_TEMPLATE);
+        sc::CategoryRenderer empty(Renderers::EMPTY_TEMPLATE);
+        benchmark::DoNotOptimize(repositories);
+        benchmark::DoNotOptimize(code);
+        benchmark::DoNotOptimize(empty);
+        benchmark::DoNotOptimize(Settings::parse(raw));
+    }
+}
+BENCHMARK(query_setup_per_query);
+
+/**
+ * The same with the state the scope builds at start: the renderers are
+ * shared, and unchanged settings are only compared
+ */
+void query_setup_shared(benchmark::State &state) {
+    sc::VariantMap raw = settings();
+    auto renderers = make_shared<Renderers>();
+    SettingsSnapshot snapshot;
+    while (state.KeepRunning()) {
+        Renderers::Ptr shared = renderers;
+        benchmark::DoNotOptimize(shared);
+        benchmark::DoNotOptimize(snapshot.get(raw));
+    }
+}
+BENCHMARK(query_setup_shared);
+
+}
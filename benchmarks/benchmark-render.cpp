@@ -0,0 +1,233 @@
+#include "allocations.h"
+
+#include <api/client.h>
+#include <api/config.h>
+#include <scope/preview.h>
+#include <scope/query.h>
+#include <scope/result_cache.h>
+
+#include <benchmark/benchmark.h>
+#include <gmock/gmock.h>
+#include <unity/scopes/ActionMetadata.h>
+#include <unity/scopes/CannedQuery.h>
+#include <unity/scopes/CategoryRenderer.h>
+#include <unity/scopes/SearchMetadata.h>
+#include <unity/scopes/testing/Category.h>
+#include <unity/scopes/testing/MockPreviewReply.h>
+#include <unity/scopes/testing/MockSearchReply.h>
+#include <unity/scopes/testing/Result.h>
+
+#include <iostream>
+#include <memory>
+#include <string>
+
+namespace sc = unity::scopes;
+namespace sct = unity::scopes::testing;
+
+using namespace std;
+using namespace testing;
+using namespace api;
+using namespace scope;
+using namespace benchmarks;
+
+namespace {
+
+/**
+ * Every result is answered from this cache, so only the rendering is
+ * measured and nothing goes to the network
+ */
+ResultCache::Ptr make_cache() {
+    return make_shared<ResultCache>(256 * 1024 * 1024, chrono::seconds(3600));
+}
+
+/**
+ * A client that has nowhere to connect, should anything miss the cache
+ */
+Config::Ptr make_config() {
+    auto config = make_shared<Config>();
+    config->apiroot = "http://127.0.0.1:1";
+    return config;
+}
+
+Client::Repository repository(int i) {
+    Client::Repository result;
+    result.owner.login = "user" + to_string(i % 17);
+    result.owner.id = 100 + i % 17;
+    result.owner.avatar_url = "https://avatars.githubusercontent.com/u/"
+            + to_string(result.owner.id) + "?v=3";
+    result.owner.url = "https://github.com/" + result.owner.login;
+    result.name = "qt-" + to_string(i);
+    result.full_name = result.owner.login + "/" + result.name;
+    result.description = "A qt project, number " + to_string(i) + " of the search results";
+    result.prvt = false;
+    result.fork = i % 5 == 0;
+    result.html_url = "https://github.com/" + result.full_name;
+    result.language = "C++";
+    result.forks_count = i % 50;
+    result.stargazers_count = 1000 + i;
+    result.watchers_count = 1000 + i;
+    result.open_issues_count = i % 7;
+    result.created_at = "2014-06-01T12:00:00Z";
+    result.pushed_at = "2015-08-01T12:00:00Z";
+    return result;
+}
+
+Client::Code code(int i) {
+    Client::Code result;
+    result.name = "file" + to_string(i) + ".cpp";
+    result.path = "src/" + result.name;
+    result.repository = repository(i % 10);
+    result.html_url = result.repository.html_url + "/blob/master/" + result.path;
+    return result;
+}
+
+Client::User user(int i) {
+    Client::User result;
+    result.login = "user" + to_string(i);
+    result.id = 100 + i;
+    result.avatar_url = "https://avatars.githubusercontent.com/u/" + to_string(result.id) + "?v=3";
+    result.html_url = "https://github.com/" + result.login;
+    return result;
+}
+
+/**
+ * Query prints its configuration problems, which outside of a scope
+ * would be once per iteration
+ */
+class QuietErrors {
+public:
+    QuietErrors() :
+        previous_(cerr.rdbuf(nullptr)) {
+    }
+
+    ~QuietErrors() {
+        cerr.clear();
+        cerr.rdbuf(previous_);
+    }
+
+private:
+    streambuf *previous_;
+};
+
+/**
+ * Runs queries against a mock reply which accepts every result
+ */
+void run_queries(benchmark::State &state, const string &query_string,
+                 const string &department, ResultCache::Ptr cache, size_t items) {
+    const Config::Ptr config = make_config();
+
+    NiceMock<sct::MockSearchReply> reply;
+    ON_CALL(reply, register_category(_, _, _, _)).WillByDefault(Invoke(
+                [](const string &id, const string &title, const string &icon,
+                   const sc::CategoryRenderer &renderer) -> sc::Category::SCPtr {
+        return make_shared<sct::Category>(id, title, icon, renderer);
+    }));
+    ON_CALL(reply, push(Matcher<sc::CategorisedResult const&>(_))).WillByDefault(Return(true));
+    sc::SearchReplyProxy reply_proxy(&reply, [](sc::SearchReply*) {});
+
+    sc::CannedQuery query(SCOPE_NAME, query_string, department);
+    sc::SearchMetadata metadata("en_EN", "phone");
+
+    QuietErrors quiet;
+    size_t allocated = 0;
+    while (state.KeepRunning()) {
+        size_t before = allocations();
+        Query q(query, metadata, config);
+        q.setResultCache(cache);
+        q.run(reply_proxy);
+        allocated += allocations() - before;
+    }
+    state.SetItemsProcessed(items * state.iterations());
+    state.SetLabel(allocations_label(allocated, items * state.iterations()));
+}
+
+/**
+ * The root department, its repositories and the code of the repository
+ * named in the query, so that the code search runs too
+ */
+void query_run_repositories(benchmark::State &state) {
+    auto repositories = make_shared<Client::RepositoryRes>();
+    auto codes = make_shared<Client::CodeRes>();
+    for (int i = 0; i < state.range(0); ++i) {
+        repositories->repositories.push_back(repository(i));
+        codes->codes.push_back(code(i));
+    }
+    repositories->total_count = repositories->repositories.size();
+    codes->total_count = codes->codes.size();
+
+    // The keys Query builds with the default settings. Repositories are
+    // searched with the whole query, code without the qualifier.
+    const string query_string = "qt repo:linux/linux";
+    auto cache = make_cache();
+    cache->repositories.put(ResultCache::key(query_string, true, true, true, 30), repositories);
+    cache->code.put(ResultCache::key("qt", "linux/linux"), codes);
+
+    run_queries(state, query_string, "", cache, 2 * state.range(0));
+}
+BENCHMARK(query_run_repositories)->RangeMultiplier(10)->Range(10, 10000);
+
+void query_run_users(benchmark::State &state) {
+    auto users = make_shared<Client::UserRes>();
+    for (int i = 0; i < state.range(0); ++i) {
+        users->users.push_back(user(i));
+    }
+    users->total_count = users->users.size();
+
+    auto cache = make_cache();
+    cache->users.put(ResultCache::key("qt"), users);
+
+    run_queries(state, "qt", "users", cache, state.range(0));
+}
+BENCHMARK(query_run_users)->RangeMultiplier(10)->Range(10, 10000);
+
+/**
+ * A repository preview with its details already fetched
+ */
+void preview_run_repository(benchmark::State &state) {
+    const Client::Repository shown = repository(0);
+
+    auto details = make_shared<Client::Details>();
+    details->readme = string(600, 'x');
+    details->latest_release = "v1.0.0";
+    for (int i = 0; i < 10; ++i) {
+        details->languages.emplace_back("Language" + to_string(i), 10000 / (i + 1));
+    }
+    for (int i = 0; i < 5; ++i) {
+        details->contributors.emplace_back("user" + to_string(i), 100 / (i + 1));
+    }
+    auto cache = make_cache();
+    cache->details.put(shown.full_name, details);
+
+    sct::Result result;
+    result.set_uri(shown.html_url);
+    result.set_title(shown.full_name);
+    result.set_art(shown.owner.avatar_url);
+    result["description"] = shown.description;
+    result["developer_uri"] = shown.owner.url;
+    result["new_issue_uri"] = shown.html_url + "/issues/new";
+    result["code_query"] = shown.html_url + "/search";
+    result["full_name"] = shown.full_name;
+    result["type"] = "repository";
+
+    NiceMock<sct::MockPreviewReply> reply;
+    ON_CALL(reply, register_layout(_)).WillByDefault(Return(true));
+    ON_CALL(reply, push(Matcher<sc::PreviewWidgetList const&>(_))).WillByDefault(Return(true));
+    sc::PreviewReplyProxy reply_proxy(&reply, [](sc::PreviewReply*) {});
+
+    const Config::Ptr config = make_config();
+    sc::ActionMetadata metadata("en_EN", "phone");
+
+    size_t allocated = 0;
+    while (state.KeepRunning()) {
+        size_t before = allocations();
+        Preview preview(result, metadata, config);
+        preview.setResultCache(cache);
+        preview.run(reply_proxy);
+        allocated += allocations() - before;
+    }
+    state.SetItemsProcessed(state.iterations());
+    state.SetLabel(allocations_label(allocated, state.iterations()));
+}
+BENCHMARK(preview_run_repository);
+
+}
@@ -0,0 +1,56 @@
+#ifndef BENCHMARKS_FAKE_SERVER_H_
+#define BENCHMARKS_FAKE_SERVER_H_
+
+#include <core/posix/exec.h>
+
+#include <stdexcept>
+#include <string>
+
+namespace benchmarks {
+
+/**
+ * The Python fake API server of the tests, started once and shared by
+ * every benchmark of the run
+ */
+class FakeServer {
+public:
+    static FakeServer &instance() {
+        static FakeServer server;
+        return server;
+    }
+
+    /**
+     * The API root to point a api::Config at
+     */
+    const std::string &apiroot() const {
+        return apiroot_;
+    }
+
+private:
+    FakeServer() :
+        process_(core::posix::exec("/usr/bin/python3", { FAKE_SERVER }, { },
+                                   core::posix::StandardStream::stdout)) {
+        // The server will print out the random port it is using
+        std::string port;
+        process_.cout() >> port;
+        if (port.empty()) {
+            throw std::runtime_error("The fake server did not start");
+        }
+        apiroot_ = "http://127.0.0.1:" + port;
+    }
+
+    ~FakeServer() {
+        try {
+            process_.send_signal_or_throw(core::posix::Signal::sig_term);
+        } catch (...) {
+        }
+    }
+
+    core::posix::ChildProcess process_;
+
+    std::string apiroot_;
+};
+
+}
+
+#endif // BENCHMARKS_FAKE_SERVER_H_
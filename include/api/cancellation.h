@@ -0,0 +1,43 @@
+#ifndef API_CANCELLATION_H_
+#define API_CANCELLATION_H_
+
+#include <atomic>
+#include <memory>
+
+namespace api {
+
+/**
+ * A cancellation flag for one request, or for a group of requests.
+ *
+ * Copies share the same flag, so the token can be handed to a request
+ * and tripped later from any thread. Once cancelled it stays cancelled;
+ * a new request simply gets a new token.
+ */
+class CancellationToken {
+public:
+    CancellationToken() :
+        cancelled_(std::make_shared<std::atomic<bool>>(false)) {
+    }
+
+    /**
+     * Trip the flag (this method can be called from a different thread)
+     */
+    void cancel() const {
+        *cancelled_ = true;
+    }
+
+    bool cancelled() const {
+        return *cancelled_;
+    }
+
+    bool operator==(const CancellationToken &other) const {
+        return cancelled_ == other.cancelled_;
+    }
+
+private:
+    std::shared_ptr<std::atomic<bool>> cancelled_;
+};
+
+}
+
+#endif // API_CANCELLATION_H_
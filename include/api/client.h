@@ -1,17 +1,22 @@
 #ifndef API_CLIENT_H_
 #define API_CLIENT_H_
 
+#include <api/cancellation.h>
 #include <api/config.h>
+#include <api/rate_limiter.h>
 
-#include <atomic>
 #include <deque>
+#include <functional>
+#include <future>
+#include <list>
 #include <map>
+#include <mutex>
 #include <string>
+#include <utility>
+#include <vector>
 #include <core/net/http/request.h>
 #include <core/net/uri.h>
 
-#include <QJsonDocument>
-
 namespace api {
 
 /**
@@ -21,6 +26,7 @@ namespace api {
  */
 class Client {
 public:
+    typedef std::shared_ptr<Client> Ptr;
 
     /**
       * Information about a Owner
@@ -36,6 +42,7 @@ public:
       * Information about a User
       */
     struct User {
+        std::string login;
         unsigned int id;
         std::string avatar_url;
         std::string html_url;
@@ -124,27 +131,176 @@ public:
         CodeList codes;
     };
 
+    /**
+     * The extra information shown in a repository preview
+     */
+    struct Details {
+        /**
+         * The beginning of the README
+         */
+        std::string readme;
+
+        /**
+         * Languages and their bytes of code, largest first
+         */
+        std::vector<std::pair<std::string, unsigned int>> languages;
+
+        /**
+         * The tag of the latest release
+         */
+        std::string latest_release;
+
+        /**
+         * The top contributors and their number of contributions
+         */
+        std::vector<std::pair<std::string, unsigned int>> contributors;
+    };
+
+    /**
+     * Callbacks receiving each result as soon as it has been parsed,
+     * while the rest of the response is still being downloaded
+     */
+    typedef std::function<void(const User &)> UserHandler;
+    typedef std::function<void(const Repository &)> RepositoryHandler;
+    typedef std::function<void(const Code &)> CodeHandler;
+
+    /**
+     * Callback receiving each part of the Details as soon as it has been
+     * fetched, with only that part set
+     */
+    typedef std::function<void(const Details &)> DetailsHandler;
+
     Client(Config::Ptr config);
 
     virtual ~Client() = default;
 
+    /**
+     * A client for the backend chosen by Config::backend
+     */
+    static Ptr create(Config::Ptr config);
+
+    /**
+     * Read a response header, ignoring the case of its name
+     */
+    static std::string header_value(const core::net::http::Header &header,
+                                    const std::string &name);
+
+    /**
+     * Whether the users returned by users() already hold their full
+     * profile, so they don't need a user() request each
+     */
+    virtual bool searches_return_profiles() const;
+
     /**
      * Search for users
+     *
+     * The total_count of the result is only set if the whole response
+     * was received.
      */
-    virtual UserRes users(const std::string &query);
+    virtual UserRes users(const std::string &query,
+                          const UserHandler &on_user = UserHandler());
 
     /**
      * Search for repositories
+     *
+     * The total_count of the result is only set if the whole response
+     * was received.
+     */
+    virtual RepositoryRes repositories(const std::string &query, bool name, bool description, bool readme,
+                                       const RepositoryHandler &on_repository = RepositoryHandler());
+
+    /**
+     * Search for up to limit repositories, over as many pages as needed
+     *
+     * The first page streams in on the calling thread while the next ones
+     * are fetched concurrently, at most Config::max_parallel_pages requests
+     * at a time. on_repository is called on the calling thread in rank
+     * order, and repositories appearing on two pages are only reported once.
      */
-    virtual RepositoryRes repositories(const std::string &query, bool name, bool description, bool readme);
+    virtual RepositoryRes repositories(const std::string &query, bool name, bool description, bool readme,
+                                       std::size_t limit,
+                                       const RepositoryHandler &on_repository = RepositoryHandler());
 
     /**
      * Search for code
+     *
+     * The total_count of the result is only set if the whole response
+     * was received.
+     */
+    virtual CodeRes code(const std::string &query, const std::string &repo,
+                         const CodeHandler &on_code = CodeHandler());
+
+    /**
+     * Get the full profile of a user, given its login
+     *
+     * Searches only return the login, the id and the URLs of each user.
+     */
+    virtual User user(const std::string &login);
+
+    /**
+     * Get the preview details of a repository, given its full name
+     *
+     * The parts are fetched concurrently, and on_part is called for each
+     * one as it arrives. Parts that could not be fetched are left empty.
      */
-    virtual CodeRes code(const std::string &query, const std::string &repo);
+    virtual Details details(const std::string &full_name,
+                            const DetailsHandler &on_part = DetailsHandler());
+
+    /**
+     * Variants of the searches above aborted as soon as the token is
+     * tripped, run on the calling thread
+     */
+    UserRes users(const std::string &query,
+                  const CancellationToken &token,
+                  const UserHandler &on_user = UserHandler());
+
+    RepositoryRes repositories(const std::string &query, bool name, bool description, bool readme,
+                               std::size_t limit,
+                               const CancellationToken &token,
+                               const RepositoryHandler &on_repository = RepositoryHandler());
+
+    CodeRes code(const std::string &query, const std::string &repo,
+                 const CancellationToken &token,
+                 const CodeHandler &on_code = CodeHandler());
+
+    User user(const std::string &login, const CancellationToken &token);
+
+    Details details(const std::string &full_name,
+                    const CancellationToken &token,
+                    const DetailsHandler &on_part = DetailsHandler());
+
+    /**
+     * Asynchronous variants of the searches above
+     *
+     * Each search runs on its own thread and calls its handler there.
+     * Tripping the token aborts both the download and the parse, without
+     * affecting any other request of this client. The client must outlive
+     * the returned futures.
+     */
+    std::future<UserRes> users_async(const std::string &query,
+                                     const CancellationToken &token,
+                                     const UserHandler &on_user = UserHandler());
+
+    std::future<RepositoryRes> repositories_async(const std::string &query, bool name, bool description, bool readme,
+                                                  std::size_t limit,
+                                                  const CancellationToken &token,
+                                                  const RepositoryHandler &on_repository = RepositoryHandler());
+
+    std::future<CodeRes> code_async(const std::string &query, const std::string &repo,
+                                    const CancellationToken &token,
+                                    const CodeHandler &on_code = CodeHandler());
+
+    std::future<User> user_async(const std::string &login,
+                                 const CancellationToken &token);
+
+    std::future<Details> details_async(const std::string &full_name,
+                                       const CancellationToken &token,
+                                       const DetailsHandler &on_part = DetailsHandler());
 
     /**
      * Cancel any pending queries (this method can be called from a different thread)
+     *
+     * Requests started afterwards are not affected.
      */
     virtual void cancel();
 
@@ -154,15 +310,110 @@ public:
     std::string getRepo() const;
     void setRepo(const std::string &value);
 
+    /**
+     * How the rate limiter treats this client's requests. Clients doing
+     * speculative work should use RateLimiter::Priority::background.
+     */
+    RateLimiter::Priority getPriority() const;
+    void setPriority(RateLimiter::Priority value);
+
 protected:
+    typedef std::function<void(const std::string &)> DataHandler;
+
+    /**
+     * Called when everything a DataHandler received so far has to be
+     * thrown away, because another body follows
+     */
+    typedef std::function<void()> ResetHandler;
+
+    /**
+     * The searches themselves, aborted as soon as the token is tripped
+     */
+    virtual UserRes fetch_users(const std::string &query,
+                                const CancellationToken &token,
+                                const UserHandler &on_user);
+
+    virtual RepositoryRes fetch_repositories(const std::string &query, bool name, bool description, bool readme,
+                                             std::size_t limit,
+                                             const CancellationToken &token,
+                                             const RepositoryHandler &on_repository);
+
+    virtual CodeRes fetch_code(const std::string &query, const std::string &repo,
+                               const CancellationToken &token,
+                               const CodeHandler &on_code);
+
+    virtual User fetch_user(const std::string &login,
+                            const CancellationToken &token);
+
+    virtual Details fetch_details(const std::string &full_name,
+                                  const CancellationToken &token,
+                                  const DetailsHandler &on_part);
+
+    /**
+     * The top contributors of a repository, which only the REST API lists
+     */
+    Details fetch_contributors(const std::string &full_name,
+                               const CancellationToken &token);
+
+    /**
+     * Run the fetches of the parts of the details concurrently, calling
+     * on_part with each as it completes, and merge them. Parts failing
+     * with std::domain_error are left empty.
+     */
+    Details fetch_parts(const std::vector<std::function<Details()>> &fetches,
+                        const CancellationToken &token,
+                        const DetailsHandler &on_part);
+
+    /**
+     * Send a JSON query and return the whole response body. An empty body
+     * means the request could not be sent, within the rate limit or at all.
+     *
+     * Throws std::domain_error with the body on an unexpected status.
+     */
+    std::string post(const core::net::Uri::Path &path, const std::string &payload,
+                     const CancellationToken &token);
+
+    /**
+     * The beginning of a README, cut at a word boundary
+     */
+    static std::string readme_excerpt(const std::string &text);
+
+    /**
+     * Fetch a single page of a repository search, or GitHub's default
+     * first page if page is 0
+     */
+    RepositoryRes repositories_page(const std::string &query, bool name, bool description, bool readme,
+                                    std::size_t page, std::size_t per_page,
+                                    const CancellationToken &token,
+                                    const RepositoryHandler &on_repository);
+
+    /**
+     * Fetch an API resource, handing each chunk of the body to on_data
+     * as soon as it arrives.
+     *
+     * The status is only known once the whole body is in, so an error
+     * body may reach on_data too. When another body is handed out after
+     * it, such as the one of a retry, on_reset is called first.
+     */
     void get(const core::net::Uri::Path &path,
              const core::net::Uri::QueryParameters &parameters,
-             QJsonDocument &root);
+             const CancellationToken &token,
+             const DataHandler &on_data,
+             const ResetHandler &on_reset);
+
+    /**
+     * Wait before trying a failed request again, with jittered exponential
+     * backoff. Returns false if the request should not be tried again.
+     */
+    bool retry(std::size_t attempt, RateLimiter::Endpoint endpoint,
+               const CancellationToken &token);
+
     /**
      * Progress callback that allows the query to cancel pending HTTP requests.
      */
     core::net::http::Request::Progress::Next progress_report(
-            const core::net::http::Request::Progress& progress);
+            const core::net::http::Request::Progress& progress,
+            const CancellationToken &token);
 
     /**
      * Hang onto the configuration information
@@ -170,12 +421,28 @@ protected:
     Config::Ptr config_;
 
     /**
-     * Thread-safe cancelled flag
+     * Keeps a token in the list tripped by #cancel while its request runs
      */
-    std::atomic<bool> cancelled_;
+    class Tracked {
+    public:
+        Tracked(Client &client, const CancellationToken &token);
+        ~Tracked();
+
+    private:
+        Client &client_;
+        std::list<CancellationToken>::iterator position_;
+    };
+
+    /**
+     * The tokens of the requests currently running
+     */
+    std::mutex active_mutex_;
+    std::list<CancellationToken> active_;
 
 private:
     std::string repo = ""; // Used when searching codes
+
+    RateLimiter::Priority priority = RateLimiter::Priority::user;
 };
 
 }
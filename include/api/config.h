@@ -1,14 +1,30 @@
 #ifndef API_CONFIG_H_
 #define API_CONFIG_H_
 
+#include <chrono>
 #include <memory>
 #include <string>
 
 namespace api {
 
+class ConnectionPool;
+class LatencyTracker;
+class Metrics;
+class RateLimiter;
+class ResponseCache;
+class Tracer;
+
 struct Config {
     typedef std::shared_ptr<Config> Ptr;
 
+    /*
+     * The APIs a Client can be built on
+     */
+    enum class Backend {
+        rest,
+        graphql
+    };
+
     /*
      * The root of all API request URLs
      */
@@ -18,6 +34,112 @@ struct Config {
      * The custom HTTP user agent string for this library
      */
     std::string user_agent { "example-network-scope 0.1; (foo)" };
+
+    /*
+     * Which API Client::create() builds clients for. GraphQL needs an
+     * access token.
+     */
+    Backend backend { Backend::rest };
+
+    /*
+     * A personal access token sent with every request, if not empty
+     */
+    std::string access_token;
+
+    /*
+     * Ask for gzip/deflate compressed responses
+     */
+    bool compression { true };
+
+    /*
+     * The maximum number of keep-alive connections open to the API host
+     */
+    std::size_t max_connections_per_host { 4 };
+
+    /*
+     * How long an idle connection is expected to be kept open by the server
+     */
+    std::chrono::seconds keep_alive { 60 };
+
+    /*
+     * The maximum number of result pages requested at the same time
+     */
+    std::size_t max_parallel_pages { 4 };
+
+    /*
+     * Warm connections shared by all the clients, set up by the scope at start.
+     * When empty every request opens its own connection.
+     */
+    std::shared_ptr<ConnectionPool> pool;
+
+    /*
+     * On-disk cache used to revalidate responses with ETag/Last-Modified.
+     * When empty every response is downloaded in full.
+     */
+    std::shared_ptr<ResponseCache> response_cache;
+
+    /*
+     * The unauthenticated search API budget
+     */
+    double search_requests_per_minute { 10 };
+
+    /*
+     * The unauthenticated budget of the rest of the API
+     */
+    double core_requests_per_hour { 60 };
+
+    /*
+     * The longest a user-facing request waits for the budget to refill
+     * before falling back to cached data
+     */
+    std::chrono::milliseconds max_rate_limit_wait { 2000 };
+
+    /*
+     * Keeps requests within the rate limits, set up by the scope at start.
+     * When empty requests are sent regardless of the budget.
+     */
+    std::shared_ptr<RateLimiter> rate_limiter;
+
+    /*
+     * How many times a request is tried when it fails with a network error
+     * or a 5xx status
+     */
+    std::size_t max_attempts { 3 };
+
+    /*
+     * The base of the exponential backoff between attempts, before jitter
+     */
+    std::chrono::milliseconds retry_backoff { 200 };
+
+    /*
+     * A duplicate request is sent when the first one hasn't started to
+     * answer within this percentile of the recent response times.
+     * 0 disables hedging.
+     */
+    double hedge_percentile { 0.95 };
+
+    /*
+     * Never hedge sooner than this, however fast the API has been
+     */
+    std::chrono::milliseconds min_hedge_delay { 100 };
+
+    /*
+     * Recent response times used for hedging, set up by the scope at start.
+     * When empty requests are never hedged.
+     */
+    std::shared_ptr<LatencyTracker> latency;
+
+    /*
+     * Records where the time of each request goes, set up by the scope
+     * when tracing is asked for. When empty nothing is recorded.
+     */
+    std::shared_ptr<Tracer> tracer;
+
+    /*
+     * Latency histograms and counters, set up by the scope at start.
+     * When empty nothing is counted.
+     */
+    std::shared_ptr<Metrics> metrics;
 };
 
 }
@@ -0,0 +1,153 @@
+#ifndef API_CONNECTION_POOL_H_
+#define API_CONNECTION_POOL_H_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <api/cancellation.h>
+
+#include <core/net/http/response.h>
+#include <core/net/http/streaming_client.h>
+#include <core/net/http/streaming_request.h>
+
+namespace api {
+
+/**
+ * A pool of warm keep-alive HTTP connections, shared by every Client.
+ *
+ * Each pooled connection owns its own net-cpp client whose event loop runs
+ * on a dedicated thread, so curl keeps the TCP and TLS session to the host
+ * open between requests. A request borrows a connection, runs on it and
+ * hands it back; no more than the configured number of connections is ever
+ * open to a single host.
+ */
+class ConnectionPool: public std::enable_shared_from_this<ConnectionPool> {
+public:
+    typedef std::shared_ptr<ConnectionPool> Ptr;
+
+    /**
+     * Counters describing how well the pool is doing.
+     *
+     * curl does not tell net-cpp whether it reused the TCP and TLS session,
+     * so handshakes and reuses are guessed from how long the connection sat
+     * idle, against the keep-alive the server is assumed to have.
+     */
+    struct Stats {
+        /**
+         * Requests on a new connection, or one idle past the keep-alive
+         */
+        std::uint64_t estimated_handshakes;
+
+        /**
+         * Requests on a connection used within the keep-alive
+         */
+        std::uint64_t estimated_reuses;
+
+        /**
+         * Requests that had to wait because the host was at its cap
+         */
+        std::uint64_t waits;
+    };
+
+private:
+    struct Connection;
+
+public:
+    /**
+     * A borrowed connection, returned to the pool when destroyed.
+     */
+    class Lease {
+    public:
+        Lease(Lease &&other);
+
+        Lease(const Lease &) = delete;
+        Lease &operator=(const Lease &) = delete;
+
+        ~Lease();
+
+        /**
+         * The HTTP client backing this connection
+         */
+        std::shared_ptr<core::net::http::StreamingClient> client() const;
+
+        /**
+         * Run a request on this connection and wait for its response.
+         * The body is handed to the data handler as it arrives.
+         *
+         * Throws core::net::Error if the request fails or is aborted by the
+         * progress handler.
+         */
+        core::net::http::Response execute(
+                const core::net::http::Request::Configuration &configuration,
+                const core::net::http::Request::ProgressHandler &progress,
+                const core::net::http::StreamingRequest::DataHandler &data);
+
+    private:
+        friend class ConnectionPool;
+
+        Lease(std::shared_ptr<ConnectionPool> pool, const std::string &host,
+              std::shared_ptr<Connection> connection);
+
+        std::shared_ptr<ConnectionPool> pool_;
+        std::string host_;
+        std::shared_ptr<Connection> connection_;
+    };
+
+    /**
+     * @param max_per_host the maximum number of open connections to one host
+     * @param keep_alive how long an idle connection is assumed to stay open
+     */
+    ConnectionPool(std::size_t max_per_host, std::chrono::seconds keep_alive);
+
+    ~ConnectionPool();
+
+    /**
+     * Borrow a connection to the given host (e.g. "https://api.github.com").
+     *
+     * Blocks while all the connections to that host are in use. Returns
+     * nullptr if the token is tripped before one is free.
+     */
+    std::unique_ptr<Lease> acquire(const std::string &host,
+                                   const CancellationToken &token);
+
+    /**
+     * Borrow a connection to the given host only if one is free right away.
+     *
+     * Returns nullptr while all the connections to that host are in use.
+     */
+    std::unique_ptr<Lease> try_acquire(const std::string &host);
+
+    Stats stats() const;
+
+private:
+    struct Host {
+        std::vector<std::shared_ptr<Connection>> idle;
+        std::size_t open = 0;
+    };
+
+    /**
+     * Hand out an idle connection, or open a new one (call with the lock
+     * held and the host below its cap)
+     */
+    Lease lend(std::unique_lock<std::mutex> &lock, Host &h, const std::string &host);
+
+    void release(const std::string &host, std::shared_ptr<Connection> connection);
+
+    const std::size_t max_per_host_;
+    const std::chrono::seconds keep_alive_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable available_;
+    std::map<std::string, Host> hosts_;
+    Stats stats_;
+};
+
+}
+
+#endif // API_CONNECTION_POOL_H_
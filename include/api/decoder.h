@@ -0,0 +1,24 @@
+#ifndef API_DECODER_H_
+#define API_DECODER_H_
+
+#include <api/client.h>
+
+#include <QJsonObject>
+
+namespace api {
+
+/**
+ * Decode API objects straight into their records.
+ *
+ * The keys come from the record's Schema, shared by all the endpoints
+ * returning that record. Values are written directly into the members,
+ * without building a QVariantMap first.
+ */
+void decode(const QJsonObject &object, Client::Owner &owner);
+void decode(const QJsonObject &object, Client::Repository &repository);
+void decode(const QJsonObject &object, Client::Code &code);
+void decode(const QJsonObject &object, Client::User &user);
+
+}
+
+#endif // API_DECODER_H_
@@ -0,0 +1,98 @@
+#ifndef API_DISK_LRU_H_
+#define API_DISK_LRU_H_
+
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <map>
+#include <string>
+
+namespace api {
+
+/**
+ * The files of a cache directory, with a byte budget.
+ *
+ * Keeps the size and the last use of every file, and deletes the least
+ * recently used ones once the directory grows past its budget. The files
+ * left by previous runs are picked up on construction, in the order they
+ * were last written.
+ *
+ * Only the bookkeeping is done here: the owner reads and writes the files
+ * itself, and serialises the calls with its own lock.
+ */
+class DiskLru {
+public:
+    struct File {
+        std::size_t size;
+
+        /**
+         * When the file was last written, or as set by its owner
+         */
+        std::time_t modified;
+    };
+
+    /**
+     * Whether a file name is one of the entries, rather than something
+     * else such as a temporary file
+     */
+    typedef std::function<bool(const std::string &name)> Filter;
+
+    /**
+     * @param directory where the files are stored, created if missing
+     * @param budget the number of bytes the files may use on disk
+     * @param is_entry picks the files that count as entries
+     */
+    DiskLru(const std::string &directory, std::size_t budget, const Filter &is_entry);
+
+    DiskLru(const DiskLru &) = delete;
+    DiskLru &operator=(const DiskLru &) = delete;
+
+    const std::string &directory() const;
+
+    std::string path(const std::string &name) const;
+
+    /**
+     * Mark a file as just used. Returns nullptr if there is no such file.
+     */
+    File *use(const std::string &name);
+
+    /**
+     * Account for a file just written under its final name, deleting the
+     * least recently used ones if that takes us over budget. Returns false
+     * if the file is not there.
+     */
+    bool stored(const std::string &name);
+
+    /**
+     * Files deleted to stay within the budget
+     */
+    std::uint64_t evictions() const;
+
+private:
+    struct Entry {
+        File file;
+        std::uint64_t used;
+    };
+
+    void insert(const std::string &name, std::size_t size, std::time_t modified);
+
+    void evict();
+
+    const std::string directory_;
+    const std::size_t budget_;
+
+    std::map<std::string, Entry> files_;
+
+    // The names of the files by last use, least recent first
+    std::map<std::uint64_t, std::string> order_;
+
+    std::size_t bytes_;
+    std::uint64_t clock_;
+
+    std::atomic<std::uint64_t> evictions_;
+};
+
+}
+
+#endif // API_DISK_LRU_H_
@@ -0,0 +1,46 @@
+#ifndef API_GRAPHQL_CLIENT_H_
+#define API_GRAPHQL_CLIENT_H_
+
+#include <api/client.h>
+
+namespace api {
+
+/**
+ * A Client on top of GitHub's GraphQL API.
+ *
+ * Each search is a single request asking for exactly the fields the scope
+ * shows, so users come back with their full profile and repositories with
+ * their owner, instead of one REST request per hit. The preview details
+ * take one request instead of three. Code search and contributors only
+ * exist in the REST API, so they are still fetched from there.
+ *
+ * GitHub only answers authenticated GraphQL requests: Config::access_token
+ * must be set.
+ */
+class GraphQLClient: public Client {
+public:
+    GraphQLClient(Config::Ptr config);
+
+    bool searches_return_profiles() const override;
+
+protected:
+    UserRes fetch_users(const std::string &query,
+                        const CancellationToken &token,
+                        const UserHandler &on_user) override;
+
+    RepositoryRes fetch_repositories(const std::string &query, bool name, bool description, bool readme,
+                                     std::size_t limit,
+                                     const CancellationToken &token,
+                                     const RepositoryHandler &on_repository) override;
+
+    User fetch_user(const std::string &login,
+                    const CancellationToken &token) override;
+
+    Details fetch_details(const std::string &full_name,
+                          const CancellationToken &token,
+                          const DetailsHandler &on_part) override;
+};
+
+}
+
+#endif // API_GRAPHQL_CLIENT_H_
@@ -0,0 +1,110 @@
+#ifndef API_INFLATER_H_
+#define API_INFLATER_H_
+
+#include <functional>
+#include <string>
+
+#include <zlib.h>
+
+namespace api {
+
+/**
+ * Decompresses a response body chunk by chunk, as it arrives.
+ *
+ * The Content-Encoding header decides how a body is decoded, but net-cpp
+ * only reports it once the whole body is in. So the bodies that can't be
+ * mistaken are decoded as they stream: text, such as a JSON document or
+ * an HTML error page, is passed through as is, and streams with a gzip or
+ * zlib header are inflated. Anything else is held back until finish()
+ * is given the header: "deflate" then means a raw deflate stream, which
+ * some servers send, and any other encoding passes the body through
+ * unchanged.
+ *
+ * The output is handed out in blocks of a fixed size, so the whole
+ * decompressed body never has to sit in memory at once.
+ */
+class Inflater {
+public:
+    typedef std::function<void(const std::string &)> DataHandler;
+
+    /**
+     * @param on_data receives the decompressed blocks
+     */
+    explicit Inflater(const DataHandler &on_data);
+
+    ~Inflater();
+
+    Inflater(const Inflater &) = delete;
+    Inflater &operator=(const Inflater &) = delete;
+
+    /**
+     * Decompress the next chunk of the body
+     *
+     * Throws std::domain_error if the stream is corrupt.
+     */
+    void feed(const std::string &chunk);
+
+    /**
+     * Hand out what is left once the whole body is in
+     *
+     * @param content_encoding the Content-Encoding header of the response
+     *
+     * Throws std::domain_error if the compressed stream was cut short.
+     */
+    void finish(const std::string &content_encoding);
+
+    /**
+     * Whether the body was compressed at all
+     */
+    bool compressed() const;
+
+private:
+    enum class Mode {
+        unknown,
+        identity,
+        inflate,
+
+        /**
+         * Not recognised, waiting for Content-Encoding
+         */
+        deferred
+    };
+
+    void start(const std::string &chunk);
+
+    /**
+     * Pick the format from the bytes collected so far, if they are enough
+     * to be sure of it
+     */
+    void recognise();
+
+    /**
+     * Decode what was held back the way the header says
+     */
+    void decide(const std::string &content_encoding);
+
+    void begin_inflate(int window_bits);
+
+    void inflate(const char *data, std::size_t size);
+
+    DataHandler on_data_;
+
+    Mode mode_;
+    z_stream stream_;
+    bool finished_;
+
+    /**
+     * The first bytes, until the format is recognised or decided
+     */
+    std::string head_;
+
+    /**
+     * Reused for every block handed out
+     */
+    std::string buffer_;
+    std::string block_;
+};
+
+}
+
+#endif // API_INFLATER_H_
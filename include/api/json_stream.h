@@ -0,0 +1,85 @@
+#ifndef API_JSON_STREAM_H_
+#define API_JSON_STREAM_H_
+
+#include <functional>
+#include <map>
+#include <string>
+
+#include <QJsonObject>
+
+namespace api {
+
+/**
+ * Incremental parser for GitHub search responses.
+ *
+ * The body is fed in chunks as it comes off the socket. Each element of the
+ * top-level "items" array is handed to the callback as soon as its closing
+ * brace arrives, so results can be shown before the rest of the payload
+ * has been downloaded. Top-level scalars such as "total_count" are kept
+ * and can be read once the response is complete.
+ */
+class JsonStream {
+public:
+    typedef std::function<void(const QJsonObject &)> ItemHandler;
+
+    /**
+     * @param on_item called once for every complete element of "items"
+     */
+    explicit JsonStream(const ItemHandler &on_item);
+
+    /**
+     * Parse the next chunk of the body
+     */
+    void feed(const char *data, std::size_t size);
+
+    void feed(const std::string &chunk) {
+        feed(chunk.data(), chunk.size());
+    }
+
+    /**
+     * Forget the body fed so far, to parse another one from the start.
+     * The count of errors is kept.
+     */
+    void reset();
+
+    /**
+     * Whether the top-level object has been closed
+     */
+    bool complete() const;
+
+    /**
+     * The raw text of a top-level scalar, or an empty string
+     */
+    std::string field(const std::string &key) const;
+
+    /**
+     * The number of elements of "items" that were not valid JSON objects
+     */
+    std::size_t errors() const {
+        return errors_;
+    }
+
+private:
+    ItemHandler on_item_;
+
+    int depth_ = 0;
+    bool in_string_ = false;
+    bool escaped_ = false;
+    bool complete_ = false;
+
+    // Tracking of the current top-level key and value
+    std::string token_;
+    std::string key_;
+    bool after_colon_ = false;
+
+    // The element of "items" being accumulated
+    bool in_items_ = false;
+    std::string item_;
+    std::size_t errors_ = 0;
+
+    std::map<std::string, std::string> fields_;
+};
+
+}
+
+#endif // API_JSON_STREAM_H_
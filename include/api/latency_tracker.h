@@ -0,0 +1,91 @@
+#ifndef API_LATENCY_TRACKER_H_
+#define API_LATENCY_TRACKER_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace api {
+
+/**
+ * Keeps the recent response times of the API, to decide when a request
+ * is slow enough to be worth sending a second time.
+ *
+ * Only the latest samples are kept, so the percentiles follow the network
+ * the device is on right now.
+ */
+class LatencyTracker {
+public:
+    typedef std::shared_ptr<LatencyTracker> Ptr;
+
+    typedef std::chrono::steady_clock::duration Duration;
+
+    /**
+     * Counters for measuring how often hedging and retries kick in
+     */
+    struct Stats {
+        /**
+         * Response times recorded so far
+         */
+        std::uint64_t samples;
+
+        /**
+         * Duplicate requests sent because the first one was slow
+         */
+        std::uint64_t hedges;
+
+        /**
+         * Duplicate requests that answered before the original
+         */
+        std::uint64_t hedge_wins;
+
+        /**
+         * Requests sent again after a transient failure
+         */
+        std::uint64_t retries;
+    };
+
+    /**
+     * @param capacity how many of the latest samples are kept
+     * @param min_samples how many samples are needed before percentiles are given
+     */
+    explicit LatencyTracker(std::size_t capacity = 256, std::size_t min_samples = 20);
+
+    /**
+     * Record the time it took a request to start answering
+     */
+    void record(Duration latency);
+
+    /**
+     * The given percentile (between 0 and 1) of the recent samples, or
+     * zero if there are not enough of them yet
+     */
+    Duration percentile(double p) const;
+
+    void hedged();
+
+    void hedge_won();
+
+    void retried();
+
+    Stats stats() const;
+
+private:
+    const std::size_t min_samples_;
+
+    mutable std::mutex mutex_;
+    std::vector<Duration> samples_;
+    std::size_t next_;
+
+    std::atomic<std::uint64_t> recorded_;
+    std::atomic<std::uint64_t> hedges_;
+    std::atomic<std::uint64_t> hedge_wins_;
+    std::atomic<std::uint64_t> retries_;
+};
+
+}
+
+#endif // API_LATENCY_TRACKER_H_
@@ -0,0 +1,183 @@
+#ifndef API_METRICS_H_
+#define API_METRICS_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace api {
+
+/**
+ * Telemetry that is always on: latency histograms per API endpoint and
+ * for whole queries and previews, and counters of what the network and
+ * the caches did.
+ *
+ * Recording is a relaxed atomic increment or two and never takes a lock,
+ * so it can stay on in release builds. The scope writes a summary to its
+ * cache directory from time to time, to compare percentiles between
+ * releases without a profiler.
+ */
+class Metrics {
+public:
+    typedef std::shared_ptr<Metrics> Ptr;
+
+    typedef std::chrono::steady_clock Clock;
+
+    /**
+     * Latencies in microseconds, HDR style: every power of two is split
+     * into 16 linear buckets, so each value is known to within 1/16 of
+     * itself, from a microsecond up to several hours.
+     */
+    class Histogram {
+    public:
+        struct Summary {
+            std::uint64_t count;
+
+            /**
+             * Percentiles and maximum, in microseconds
+             */
+            std::uint64_t p50;
+            std::uint64_t p90;
+            std::uint64_t p99;
+            std::uint64_t max;
+        };
+
+        Histogram();
+
+        void record(Clock::duration latency);
+
+        Summary summary() const;
+
+    private:
+        static const std::size_t SUB_BUCKETS = 16;
+        static const std::size_t MAX_BITS = 36;
+        static const std::size_t BUCKETS = SUB_BUCKETS * (MAX_BITS - 3);
+
+        static std::size_t index(std::uint64_t value);
+
+        /**
+         * The largest value counted in a bucket
+         */
+        static std::uint64_t upper_bound(std::size_t index);
+
+        std::atomic<std::uint64_t> buckets_[BUCKETS];
+        std::atomic<std::uint64_t> max_;
+    };
+
+    /**
+     * Records the time from its creation to its destruction, unless
+     * dismissed. Does nothing without a histogram.
+     */
+    class Timer {
+    public:
+        explicit Timer(Histogram *histogram);
+
+        ~Timer();
+
+        Timer(const Timer &) = delete;
+        Timer &operator=(const Timer &) = delete;
+
+        /**
+         * Don't record this one, such as a cancelled request
+         */
+        void dismiss();
+
+    private:
+        Histogram *histogram_;
+        Clock::time_point begin_;
+    };
+
+    /**
+     * The API endpoints timed separately
+     */
+    enum class Endpoint {
+        search_repositories,
+        search_code,
+        search_users,
+        users,
+        repos,
+        graphql,
+        other
+    };
+
+    enum class Counter {
+        /**
+         * Response bytes received, before inflating
+         */
+        bytes_fetched,
+
+        /**
+         * Searches answered from the in-memory result cache, or not
+         */
+        result_cache_hits,
+        result_cache_misses,
+
+        /**
+         * Responses served from the on-disk response cache after a 304
+         */
+        response_cache_hits,
+
+        /**
+         * Cached responses served unconfirmed, because the rate limit was
+         * spent or the network failed
+         */
+        stale_responses,
+
+        /**
+         * Queries and previews cancelled by the shell
+         */
+        cancellations,
+
+        /**
+         * Requests that had to wait for the rate limit, or were refused
+         */
+        rate_limit_stalls,
+
+        /**
+         * Responses or search items that were not valid JSON
+         */
+        parse_errors
+    };
+
+    Metrics();
+
+    /**
+     * The endpoint of a request path, such as { "search", "code" }
+     */
+    static Endpoint endpoint(const std::vector<std::string> &path);
+
+    Histogram &latency(Endpoint endpoint);
+
+    /**
+     * End-to-end Query::run and Preview::run
+     */
+    Histogram query;
+    Histogram preview;
+
+    void add(Counter counter, std::uint64_t amount = 1);
+
+    std::uint64_t value(Counter counter) const;
+
+    /**
+     * Write a JSON summary of everything recorded since the start
+     */
+    bool write(const std::string &path) const;
+
+private:
+    static const std::size_t ENDPOINTS = static_cast<std::size_t>(Endpoint::other) + 1;
+    static const std::size_t COUNTERS = static_cast<std::size_t>(Counter::parse_errors) + 1;
+
+    const Clock::time_point started_;
+
+    Histogram endpoints_[ENDPOINTS];
+
+    std::atomic<std::uint64_t> counters_[COUNTERS];
+};
+
+}
+
+#endif // API_METRICS_H_
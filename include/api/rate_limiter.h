@@ -0,0 +1,136 @@
+#ifndef API_RATE_LIMITER_H_
+#define API_RATE_LIMITER_H_
+
+#include <api/cancellation.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace api {
+
+/**
+ * Schedules requests within GitHub's rate limits.
+ *
+ * The search API and the rest of the API ("core") have separate budgets,
+ * so each gets its own token bucket. The buckets refill at the documented
+ * rate and are corrected with the X-RateLimit-* and Retry-After headers of
+ * every response. User-facing requests may wait a little for a token;
+ * background work such as prefetching never waits and leaves a reserve
+ * untouched for the user.
+ */
+class RateLimiter {
+public:
+    typedef std::shared_ptr<RateLimiter> Ptr;
+
+    enum class Endpoint {
+        search,
+        core
+    };
+
+    enum class Priority {
+        /**
+         * Something the user is waiting for
+         */
+        user,
+
+        /**
+         * Speculative work, dropped first when the budget runs low
+         */
+        background
+    };
+
+    struct Stats {
+        /**
+         * Requests let through straight away
+         */
+        std::uint64_t granted;
+
+        /**
+         * User requests that had to wait for a token
+         */
+        std::uint64_t waited;
+
+        /**
+         * Background requests dropped to save budget
+         */
+        std::uint64_t dropped;
+
+        /**
+         * User requests refused because the budget was exhausted
+         */
+        std::uint64_t exhausted;
+    };
+
+    /**
+     * @param search_per_minute the search API budget
+     * @param core_per_hour the budget of the rest of the API
+     * @param max_wait the longest a user request may wait for a token
+     */
+    RateLimiter(double search_per_minute, double core_per_hour,
+                std::chrono::milliseconds max_wait);
+
+    /**
+     * The budget a request to this API path counts against
+     */
+    static Endpoint endpoint(const std::string &first_path_segment);
+
+    /**
+     * Take a token for a request.
+     *
+     * Returns false if the request should not be sent, either because it
+     * is background work and the budget is low, or because no token will
+     * be available within the maximum wait, or because it was cancelled.
+     */
+    bool acquire(Endpoint endpoint, Priority priority,
+                 const CancellationToken &token);
+
+    /**
+     * Correct a budget from the headers of a response.
+     *
+     * Empty strings stand for missing headers. reset is in seconds since
+     * the epoch, retry_after in seconds from now.
+     */
+    void update(Endpoint endpoint, const std::string &remaining,
+                const std::string &reset, const std::string &retry_after);
+
+    Stats stats() const;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Bucket {
+        double capacity;
+        double tokens;
+        double per_second;
+        Clock::time_point refilled;
+        Clock::time_point blocked_until;
+
+        /**
+         * When the server restores the whole budget, if it said so
+         */
+        Clock::time_point resets;
+    };
+
+    Bucket &bucket(Endpoint endpoint);
+
+    void refill(Bucket &bucket, Clock::time_point now);
+
+    const std::chrono::milliseconds max_wait_;
+
+    std::mutex mutex_;
+    Bucket search_;
+    Bucket core_;
+
+    std::atomic<std::uint64_t> granted_;
+    std::atomic<std::uint64_t> waited_;
+    std::atomic<std::uint64_t> dropped_;
+    std::atomic<std::uint64_t> exhausted_;
+};
+
+}
+
+#endif // API_RATE_LIMITER_H_
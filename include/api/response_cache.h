@@ -0,0 +1,130 @@
+#ifndef API_RESPONSE_CACHE_H_
+#define API_RESPONSE_CACHE_H_
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <api/disk_lru.h>
+
+#include <core/net/uri.h>
+
+namespace api {
+
+/**
+ * Disk-backed cache of API responses, revalidated with ETag/Last-Modified.
+ *
+ * GitHub answers a conditional request with "304 Not Modified" when the
+ * resource did not change, and 304s don't count against the rate limit.
+ * The cache keeps the validators next to each body so repeated requests
+ * can be revalidated instead of downloaded again.
+ *
+ * Every distinct request leaves an entry, so the least recently used
+ * ones are deleted once the directory grows past its budget.
+ */
+class ResponseCache {
+public:
+    typedef std::shared_ptr<ResponseCache> Ptr;
+
+    /**
+     * A cached response body and its validators
+     */
+    struct Entry {
+        std::string etag;
+        std::string last_modified;
+        std::string body;
+    };
+
+    /**
+     * Counters for measuring bandwidth and rate-limit savings
+     */
+    struct Stats {
+        /**
+         * Requests answered with 304 and served from the cache
+         */
+        std::uint64_t hits;
+
+        /**
+         * Requests for which nothing was cached
+         */
+        std::uint64_t misses;
+
+        /**
+         * Requests sent with validators from a cached entry
+         */
+        std::uint64_t revalidations;
+
+        /**
+         * Body bytes we didn't have to download thanks to a 304
+         */
+        std::uint64_t bytes_saved;
+
+        /**
+         * Requests answered with a cached body the server did not confirm,
+         * because the rate limit or the network let us down
+         */
+        std::uint64_t stale;
+
+        /**
+         * Entries deleted to stay within the budget
+         */
+        std::uint64_t evictions;
+    };
+
+    /**
+     * @param directory where the entries are stored, created if missing
+     * @param budget the number of bytes the entries may use on disk
+     */
+    ResponseCache(const std::string &directory,
+                  std::size_t budget = 16 * 1024 * 1024);
+
+    /**
+     * Build the canonical cache key of a request, with sorted parameters
+     */
+    static std::string key(const std::string &apiroot,
+                           const core::net::Uri::Path &path,
+                           const core::net::Uri::QueryParameters &parameters);
+
+    /**
+     * Look up an entry, counting a miss if there is none.
+     */
+    bool find(const std::string &key, Entry &entry);
+
+    /**
+     * Store an entry, replacing the previous one atomically
+     */
+    void store(const std::string &key, const Entry &entry);
+
+    /**
+     * Record that a cached entry was sent for revalidation
+     */
+    void revalidated();
+
+    /**
+     * Record that the server confirmed a cached entry of the given size
+     */
+    void hit(std::size_t bytes);
+
+    /**
+     * Record that a cached entry was served without being confirmed
+     */
+    void served_stale();
+
+    Stats stats() const;
+
+private:
+    std::mutex mutex_;
+    DiskLru files_;
+
+    std::atomic<std::uint64_t> hits_;
+    std::atomic<std::uint64_t> misses_;
+    std::atomic<std::uint64_t> revalidations_;
+    std::atomic<std::uint64_t> bytes_saved_;
+    std::atomic<std::uint64_t> stale_;
+};
+
+}
+
+#endif // API_RESPONSE_CACHE_H_
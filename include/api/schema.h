@@ -0,0 +1,147 @@
+#ifndef API_SCHEMA_H_
+#define API_SCHEMA_H_
+
+#include <api/client.h>
+
+namespace api {
+
+/**
+ * The fields of each API record type: their JSON key and their member.
+ *
+ * Schema<Record>::visit(visitor) calls visitor(key, member) for every
+ * field, in a fixed order. Visitors overload the call for the member types
+ * they handle (std::string, unsigned int, bool, and nested records), so
+ * code decoding, serializing or exporting records is written once per
+ * type of field rather than once per field. Adding a field only takes a
+ * line here.
+ *
+ * The order is part of the on-disk formats built from it: new fields go
+ * at the end.
+ */
+template<typename Record>
+struct Schema;
+
+template<>
+struct Schema<Client::Owner> {
+    typedef Client::Owner R;
+
+    template<typename Visitor>
+    static void visit(Visitor &visitor) {
+        visitor("login", &R::login);
+        visitor("id", &R::id);
+        visitor("avatar_url", &R::avatar_url);
+        visitor("html_url", &R::url);
+    }
+};
+
+template<>
+struct Schema<Client::Repository> {
+    typedef Client::Repository R;
+
+    template<typename Visitor>
+    static void visit(Visitor &visitor) {
+        visitor("owner", &R::owner);
+        visitor("name", &R::name);
+        visitor("full_name", &R::full_name);
+        visitor("description", &R::description);
+        visitor("private", &R::prvt);
+        visitor("fork", &R::fork);
+        visitor("html_url", &R::html_url);
+        visitor("language", &R::language);
+        visitor("forks_count", &R::forks_count);
+        visitor("stargazers_count", &R::stargazers_count);
+        visitor("watchers_count", &R::watchers_count);
+        visitor("open_issues_count", &R::open_issues_count);
+        visitor("created_at", &R::created_at);
+        visitor("pushed_at", &R::pushed_at);
+    }
+};
+
+template<>
+struct Schema<Client::Code> {
+    typedef Client::Code R;
+
+    template<typename Visitor>
+    static void visit(Visitor &visitor) {
+        visitor("name", &R::name);
+        visitor("path", &R::path);
+        visitor("html_url", &R::html_url);
+        visitor("repository", &R::repository);
+    }
+};
+
+template<>
+struct Schema<Client::User> {
+    typedef Client::User R;
+
+    template<typename Visitor>
+    static void visit(Visitor &visitor) {
+        visitor("login", &R::login);
+        visitor("id", &R::id);
+        visitor("avatar_url", &R::avatar_url);
+        visitor("html_url", &R::html_url);
+        visitor("followers_url", &R::followers_url);
+        visitor("following_url", &R::following_url);
+        visitor("gists_url", &R::gists_url);
+        visitor("starred_url", &R::starred_url);
+        visitor("organizations_url", &R::organizations_url);
+        visitor("repos_url", &R::repos_url);
+        visitor("name", &R::name);
+        visitor("company", &R::company);
+        visitor("blog", &R::blog);
+        visitor("location", &R::location);
+        visitor("email", &R::email);
+        visitor("hireable", &R::hireable);
+        visitor("bio", &R::bio);
+        visitor("public_repos", &R::public_repos);
+        visitor("public_gists", &R::public_gists);
+        visitor("followers", &R::followers);
+        visitor("following", &R::following);
+    }
+};
+
+/**
+ * Whether two records hold the same values in every field
+ */
+template<typename Record>
+bool same_fields(const Record &a, const Record &b);
+
+namespace detail {
+
+template<typename Record>
+struct Compare {
+    const Record &a;
+    const Record &b;
+    bool same;
+
+    template<typename Member>
+    void operator()(const char *, Member Record::*member) {
+        same = same && equal(a.*member, b.*member);
+    }
+
+    template<typename Value>
+    static bool equal(const Value &x, const Value &y) {
+        return x == y;
+    }
+
+    static bool equal(const Client::Owner &x, const Client::Owner &y) {
+        return same_fields(x, y);
+    }
+
+    static bool equal(const Client::Repository &x, const Client::Repository &y) {
+        return same_fields(x, y);
+    }
+};
+
+}
+
+template<typename Record>
+bool same_fields(const Record &a, const Record &b) {
+    detail::Compare<Record> compare { a, b, true };
+    Schema<Record>::visit(compare);
+    return compare.same;
+}
+
+}
+
+#endif // API_SCHEMA_H_
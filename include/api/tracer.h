@@ -0,0 +1,134 @@
+#ifndef API_TRACER_H_
+#define API_TRACER_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace api {
+
+/**
+ * Records where the time of searches and previews goes, as spans that
+ * can be opened in chrome://tracing or Perfetto.
+ *
+ * Each thread writes to a ring buffer of its own, so recording never
+ * waits on another thread and only the latest events of each thread are
+ * kept. Rings of threads that have exited are handed to new threads,
+ * which keeps the short-lived request threads from piling up buffers.
+ *
+ * Tracing is off unless the scope creates a Tracer: every call site
+ * holds a possibly empty pointer, and spans on an empty one do nothing.
+ */
+class Tracer {
+public:
+    typedef std::shared_ptr<Tracer> Ptr;
+
+    typedef std::chrono::steady_clock Clock;
+
+    /**
+     * A span from its creation to its destruction, or to end()
+     */
+    class Span {
+    public:
+        /**
+         * @param name a string literal, it is not copied
+         */
+        Span(const Ptr &tracer, const char *name);
+
+        ~Span();
+
+        Span(const Span &) = delete;
+        Span &operator=(const Span &) = delete;
+
+        /**
+         * Whether the span is recorded, to skip building its detail
+         */
+        bool active() const {
+            return tracer_ != nullptr;
+        }
+
+        /**
+         * Shown along with the span, such as the path of a request
+         */
+        void detail(const std::string &value);
+
+        /**
+         * Close the span before the end of its scope
+         */
+        void end();
+
+    private:
+        Tracer *tracer_;
+        const char *name_;
+        Clock::time_point begin_;
+        std::string detail_;
+    };
+
+    /**
+     * @param capacity how many of the latest events each thread keeps
+     */
+    explicit Tracer(std::size_t capacity = 1024);
+
+    /**
+     * Record a span that has already ended
+     */
+    void complete(const char *name, Clock::time_point begin, Clock::time_point end,
+                  const std::string &detail = std::string());
+
+    /**
+     * Record a point in time, such as the first byte of a response
+     */
+    void instant(const char *name, const std::string &detail = std::string());
+
+    /**
+     * Write every recorded event in the Chrome trace-event JSON format
+     */
+    bool write(const std::string &path) const;
+
+private:
+    struct Event {
+        const char *name;
+        bool instant;
+        std::int64_t begin;
+        std::int64_t duration;
+        std::string detail;
+    };
+
+    struct Ring {
+        std::mutex mutex;
+        std::vector<Event> events;
+        std::size_t next = 0;
+        std::size_t count = 0;
+        int thread;
+    };
+
+    struct Rings {
+        std::mutex mutex;
+        std::vector<std::shared_ptr<Ring>> all;
+        std::vector<std::shared_ptr<Ring>> free;
+    };
+
+    /**
+     * The ring of the calling thread
+     */
+    Ring &ring();
+
+    void record(const char *name, bool instant, Clock::time_point begin,
+                Clock::time_point end, const std::string &detail);
+
+    const std::size_t capacity_;
+
+    const std::uint64_t id_;
+
+    const Clock::time_point epoch_;
+
+    std::shared_ptr<Rings> rings_;
+};
+
+}
+
+#endif // API_TRACER_H_
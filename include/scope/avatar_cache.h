@@ -0,0 +1,119 @@
+#ifndef SCOPE_AVATAR_CACHE_H_
+#define SCOPE_AVATAR_CACHE_H_
+
+#include <api/client.h>
+#include <api/config.h>
+#include <api/disk_lru.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+namespace scope {
+
+/**
+ * Owner avatars, downscaled to the size of a result card and kept on disk.
+ *
+ * Results point at the local copy of an avatar when there is one, so the
+ * shell loads a small local file instead of the full size image over the
+ * network. Missing avatars are downloaded once, on a background thread,
+ * and are used from the next query on. The least recently used avatars
+ * are deleted once the directory grows past its budget.
+ *
+ * Avatars older than their maximum age are still shown, and revalidated
+ * in the background with the ETag they were downloaded with, so a changed
+ * avatar is picked up without downloading the unchanged ones again.
+ */
+class AvatarCache {
+public:
+    typedef std::shared_ptr<AvatarCache> Ptr;
+
+    struct Stats {
+        /**
+         * Results given a local avatar
+         */
+        std::uint64_t hits;
+
+        /**
+         * Results that still had to use the remote avatar
+         */
+        std::uint64_t misses;
+
+        /**
+         * Avatars downloaded
+         */
+        std::uint64_t downloads;
+
+        /**
+         * Avatars deleted to stay within the budget
+         */
+        std::uint64_t evictions;
+
+        /**
+         * Expired avatars the server confirmed unchanged
+         */
+        std::uint64_t revalidations;
+    };
+
+    /**
+     * @param config where to download from
+     * @param directory where the avatars are stored, created if missing
+     * @param budget the number of bytes the avatars may use on disk
+     * @param size the width and height of the stored avatars, in pixels
+     * @param max_age how long an avatar is used before it is revalidated
+     */
+    AvatarCache(api::Config::Ptr config, const std::string &directory,
+                std::size_t budget, int size,
+                std::chrono::seconds max_age = std::chrono::hours(24 * 7));
+
+    ~AvatarCache();
+
+    AvatarCache(const AvatarCache &) = delete;
+    AvatarCache &operator=(const AvatarCache &) = delete;
+
+    /**
+     * The URI to show for an owner's avatar: the local copy if we have it,
+     * otherwise the remote avatar, which is then fetched in the background
+     */
+    std::string art(const api::Client::Owner &owner);
+
+    Stats stats() const;
+
+private:
+    void work();
+
+    void download(unsigned int id, const std::string &url);
+
+    const api::Config::Ptr config_;
+    const int size_;
+    const std::chrono::seconds max_age_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+
+    // The modification time of each avatar is when it was last downloaded
+    // or revalidated
+    api::DiskLru files_;
+
+    std::deque<std::pair<unsigned int, std::string>> queue_;
+    std::set<unsigned int> queued_;
+    bool stopping_;
+
+    std::thread worker_;
+
+    std::atomic<std::uint64_t> hits_;
+    std::atomic<std::uint64_t> misses_;
+    std::atomic<std::uint64_t> downloads_;
+    std::atomic<std::uint64_t> revalidations_;
+};
+
+}
+
+#endif // SCOPE_AVATAR_CACHE_H_
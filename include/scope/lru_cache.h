@@ -0,0 +1,160 @@
+#ifndef SCOPE_LRU_CACHE_H_
+#define SCOPE_LRU_CACHE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace scope {
+
+/**
+ * A thread-safe, sharded LRU cache with a byte budget and a time to live.
+ *
+ * Values are kept behind shared pointers, so a hit costs a lock and a
+ * reference count increment. The key space is split over several shards,
+ * each with its own lock and its own slice of the budget, so concurrent
+ * queries rarely contend.
+ */
+template<typename Value>
+class LruCache {
+public:
+    typedef std::shared_ptr<const Value> ValuePtr;
+
+    /**
+     * Computes the approximate memory footprint of a value
+     */
+    typedef std::function<std::size_t(const Value &)> Sizer;
+
+    struct Stats {
+        std::uint64_t hits;
+        std::uint64_t misses;
+        std::uint64_t evictions;
+        std::uint64_t expirations;
+    };
+
+    /**
+     * @param budget the total number of bytes the cache may hold
+     * @param ttl how long an entry stays valid after being stored
+     * @param sizer computes the size of each value
+     * @param shards the number of independently locked shards
+     */
+    LruCache(std::size_t budget, std::chrono::seconds ttl, Sizer sizer,
+             std::size_t shards = 8) :
+        ttl_(ttl), sizer_(sizer), shards_(shards > 0 ? shards : 1),
+        hits_(0), misses_(0), evictions_(0), expirations_(0) {
+        for (Shard &shard : shards_) {
+            shard.budget = budget / shards_.size();
+        }
+    }
+
+    LruCache(const LruCache &) = delete;
+    LruCache &operator=(const LruCache &) = delete;
+
+    /**
+     * Look up a value, returning an empty pointer on a miss
+     */
+    ValuePtr get(const std::string &key) {
+        Shard &shard = shard_for(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        auto it = shard.index.find(key);
+        if (it == shard.index.end()) {
+            ++misses_;
+            return ValuePtr();
+        }
+
+        if (Clock::now() >= it->second->expires) {
+            shard.bytes -= it->second->bytes;
+            shard.entries.erase(it->second);
+            shard.index.erase(it);
+            ++expirations_;
+            ++misses_;
+            return ValuePtr();
+        }
+
+        // Move the entry to the front, it is now the most recently used
+        shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+        ++hits_;
+        return it->second->value;
+    }
+
+    /**
+     * Store a value, evicting the least recently used entries of its shard
+     * until the shard fits in its budget again
+     */
+    void put(const std::string &key, ValuePtr value) {
+        std::size_t bytes = key.size() + sizer_(*value);
+        Shard &shard = shard_for(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+
+        auto it = shard.index.find(key);
+        if (it != shard.index.end()) {
+            shard.bytes -= it->second->bytes;
+            shard.entries.erase(it->second);
+            shard.index.erase(it);
+        }
+
+        // Don't let a single huge value flush the whole shard
+        if (bytes > shard.budget) {
+            return;
+        }
+
+        shard.entries.push_front(Entry { key, value, bytes, Clock::now() + ttl_ });
+        shard.index[key] = shard.entries.begin();
+        shard.bytes += bytes;
+
+        while (shard.bytes > shard.budget) {
+            const Entry &last = shard.entries.back();
+            shard.bytes -= last.bytes;
+            shard.index.erase(last.key);
+            shard.entries.pop_back();
+            ++evictions_;
+        }
+    }
+
+    Stats stats() const {
+        return Stats { hits_, misses_, evictions_, expirations_ };
+    }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Entry {
+        std::string key;
+        ValuePtr value;
+        std::size_t bytes;
+        Clock::time_point expires;
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::list<Entry> entries;
+        std::unordered_map<std::string, typename std::list<Entry>::iterator> index;
+        std::size_t bytes = 0;
+        std::size_t budget = 0;
+    };
+
+    Shard &shard_for(const std::string &key) {
+        return shards_[std::hash<std::string>()(key) % shards_.size()];
+    }
+
+    const std::chrono::seconds ttl_;
+    const Sizer sizer_;
+    std::vector<Shard> shards_;
+
+    std::atomic<std::uint64_t> hits_;
+    std::atomic<std::uint64_t> misses_;
+    std::atomic<std::uint64_t> evictions_;
+    std::atomic<std::uint64_t> expirations_;
+};
+
+}
+
+#endif // SCOPE_LRU_CACHE_H_
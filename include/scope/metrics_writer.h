@@ -0,0 +1,56 @@
+#ifndef SCOPE_METRICS_WRITER_H_
+#define SCOPE_METRICS_WRITER_H_
+
+#include <api/cancellation.h>
+#include <api/metrics.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace scope {
+
+/**
+ * Writes the scope's metrics to a file every now and then, and once more
+ * when destroyed, so they survive the scope being killed and can be read
+ * while it runs.
+ */
+class MetricsWriter {
+public:
+    typedef std::shared_ptr<MetricsWriter> Ptr;
+
+    /**
+     * @param metrics what to write
+     * @param path the JSON file, replaced on every write
+     * @param interval the time between writes
+     */
+    MetricsWriter(api::Metrics::Ptr metrics, const std::string &path,
+                  std::chrono::seconds interval = std::chrono::seconds(60));
+
+    ~MetricsWriter();
+
+    MetricsWriter(const MetricsWriter &) = delete;
+    MetricsWriter &operator=(const MetricsWriter &) = delete;
+
+private:
+    void work();
+
+    const api::Metrics::Ptr metrics_;
+    const std::string path_;
+    const std::chrono::seconds interval_;
+
+    // Tripped on destruction
+    api::CancellationToken stop_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+
+    std::thread worker_;
+};
+
+}
+
+#endif // SCOPE_METRICS_WRITER_H_
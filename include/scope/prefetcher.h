@@ -0,0 +1,82 @@
+#ifndef SCOPE_PREFETCHER_H_
+#define SCOPE_PREFETCHER_H_
+
+#include <api/cancellation.h>
+#include <api/client.h>
+#include <scope/result_cache.h>
+#include <scope/work_queue.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace scope {
+
+/**
+ * Fetches the preview details of the top results before they are opened.
+ *
+ * Queries hand over the repositories they showed first; a background
+ * thread fetches their details into the shared ResultCache, so a preview
+ * can be rendered without waiting for the network. The requests are made
+ * at background priority, so the rate limiter drops them first when the
+ * budget runs low.
+ */
+class Prefetcher {
+public:
+    typedef std::shared_ptr<Prefetcher> Ptr;
+
+    struct Stats {
+        /**
+         * Repositories whose details were fetched
+         */
+        std::uint64_t fetched;
+
+        /**
+         * Repositories skipped because their details were already cached
+         */
+        std::uint64_t cached;
+
+        /**
+         * Repositories dropped because the queue was full
+         */
+        std::uint64_t dropped;
+    };
+
+    /**
+     * @param config the API configuration
+     * @param cache where the details go
+     * @param capacity the most repositories waiting at any time
+     */
+    Prefetcher(api::Config::Ptr config, ResultCache::Ptr cache,
+               std::size_t capacity = 32);
+
+    Prefetcher(const Prefetcher &) = delete;
+    Prefetcher &operator=(const Prefetcher &) = delete;
+
+    /**
+     * Queue repositories, given by full name, ahead of the ones already
+     * waiting: the latest query is the one the user is looking at
+     */
+    void prefetch(const std::vector<std::string> &full_names);
+
+    Stats stats() const;
+
+private:
+    void fetch(const std::string &full_name, const api::CancellationToken &stop);
+
+    const ResultCache::Ptr cache_;
+
+    api::Client::Ptr client_;
+
+    std::atomic<std::uint64_t> fetched_;
+    std::atomic<std::uint64_t> cached_;
+
+    // Last, so its worker is joined before anything it uses goes away
+    WorkQueue<std::string, std::string> queue_;
+};
+
+}
+
+#endif // SCOPE_PREFETCHER_H_
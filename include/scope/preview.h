@@ -1,8 +1,15 @@
 #ifndef SCOPE_PREVIEW_H_
 #define SCOPE_PREVIEW_H_
 
+#include <api/client.h>
+#include <scope/result_cache.h>
+
 #include <unity/scopes/PreviewQueryBase.h>
 
+#include <atomic>
+#include <future>
+#include <string>
+
 namespace unity {
 namespace scopes {
 class Result;
@@ -20,7 +27,8 @@ namespace scope {
 class Preview: public unity::scopes::PreviewQueryBase {
 public:
     Preview(const unity::scopes::Result &result,
-            const unity::scopes::ActionMetadata &metadata);
+            const unity::scopes::ActionMetadata &metadata,
+            api::Config::Ptr config);
 
     ~Preview() = default;
 
@@ -30,6 +38,41 @@ public:
      * Populates the reply object with preview information.
      */
     void run(unity::scopes::PreviewReplyProxy const& reply) override;
+
+    ResultCache::Ptr getResultCache() const;
+    void setResultCache(const ResultCache::Ptr &value);
+
+private:
+    api::Client::Ptr client_;
+
+    // Aborts the requests of this preview, when the shell cancels it or
+    // when the details miss their deadline
+    api::CancellationToken cancellation_;
+
+    // Whether the shell cancelled the preview, as opposed to a deadline
+    std::atomic<bool> cancelled_ { false };
+
+    // The details still being fetched, declared after client_ so they
+    // are waited for before it goes away
+    std::future<api::Client::Details> pending_;
+    std::future<api::Client::User> pending_profile_;
+
+    // Holds the prefetched details
+    ResultCache::Ptr resultCache;
+
+    /**
+     * Push the details of a repository: at once if they were prefetched,
+     * otherwise each part as it arrives, until the deadline
+     */
+    void pushRepositoryDetails(unity::scopes::PreviewReplyProxy const& reply,
+                               const std::string &full_name);
+
+    /**
+     * The full profile of a user: hydrated already if we are lucky,
+     * fetched now otherwise. Empty if it missed the deadline.
+     */
+    std::shared_ptr<const api::Client::User> userProfile(const std::string &login,
+                                                         const std::string &id);
 };
 
 }
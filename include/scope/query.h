@@ -2,12 +2,32 @@
 #define SCOPE_QUERY_H_
 
 #include <api/client.h>
-
+#include <scope/avatar_cache.h>
+#include <scope/prefetcher.h>
+#include <scope/renderers.h>
+#include <scope/repository_index.h>
+#include <scope/result_cache.h>
+#include <scope/settings_snapshot.h>
+#include <scope/single_flight.h>
+#include <scope/state_snapshot.h>
+#include <scope/user_hydrator.h>
+
+#include <unity/scopes/CategorisedResult.h>
 #include <unity/scopes/SearchQueryBase.h>
 #include <unity/scopes/ReplyProxyFwd.h>
 
 namespace scope {
 
+/**
+ * Repository searches in flight, shared by all the queries
+ */
+typedef SingleFlight<api::Client::RepositoryRes, api::Client::Repository> RepositoryFlights;
+
+/**
+ * Code searches in flight, shared by all the queries
+ */
+typedef SingleFlight<api::Client::CodeRes, api::Client::Code> CodeFlights;
+
 /**
  * Represents an individual query.
  *
@@ -26,11 +46,88 @@ public:
 
     void run(const unity::scopes::SearchReplyProxy &reply) override;
 
-    std::string getCachePath() const;
-    void setCachePath(const std::string &value);
+    StateSnapshot::Ptr getStateSnapshot() const;
+    void setStateSnapshot(const StateSnapshot::Ptr &value);
+
+    ResultCache::Ptr getResultCache() const;
+    void setResultCache(const ResultCache::Ptr &value);
+
+    RepositoryFlights::Ptr getRepositoryFlights() const;
+    void setRepositoryFlights(const RepositoryFlights::Ptr &value);
+
+    CodeFlights::Ptr getCodeFlights() const;
+    void setCodeFlights(const CodeFlights::Ptr &value);
+
+    RepositoryIndex::Ptr getRepositoryIndex() const;
+    void setRepositoryIndex(const RepositoryIndex::Ptr &value);
+
+    AvatarCache::Ptr getAvatarCache() const;
+    void setAvatarCache(const AvatarCache::Ptr &value);
+
+    Prefetcher::Ptr getPrefetcher() const;
+    void setPrefetcher(const Prefetcher::Ptr &value);
+
+    Renderers::Ptr getRenderers() const;
+    void setRenderers(const Renderers::Ptr &value);
+
+    SettingsSnapshot::Ptr getSettingsSnapshot() const;
+    void setSettingsSnapshot(const SettingsSnapshot::Ptr &value);
+
+    UserHydrator::Ptr getUserHydrator() const;
+    void setUserHydrator(const UserHydrator::Ptr &value);
 
 private:
-    api::Client client_;
+    api::Client::Ptr client_;
+
+    // Tripped when the query is cancelled, aborts all of its requests
+    api::CancellationToken cancellation_;
+
+    // Parsed results shared with the other queries
+    ResultCache::Ptr resultCache;
+
+    // Identical searches of other queries that we can attach to
+    RepositoryFlights::Ptr repositoryFlights;
+
+    // The same for code, so the code department reuses the search the
+    // root department started
+    CodeFlights::Ptr codeFlights;
+
+    // Every repository seen so far, searched locally while the network works
+    RepositoryIndex::Ptr repositoryIndex;
+
+    // Card-sized copies of the owners' avatars
+    AvatarCache::Ptr avatarCache;
+
+    // Fetches the previews of our first results in the background
+    Prefetcher::Ptr prefetcher;
+
+    // The category renderers, built by the scope
+    Renderers::Ptr renderers;
+
+    // The settings, parsed only when they change
+    SettingsSnapshot::Ptr settingsSnapshot;
+
+    // Fetches the full profiles of the users we show
+    UserHydrator::Ptr userHydrator;
+
+    std::shared_ptr<const api::Client::RepositoryRes> searchRepositories(
+            const std::string &query, const api::Client::RepositoryHandler &on_repository);
+
+    std::shared_ptr<const api::Client::CodeRes> searchCode(
+            const std::string &query, const api::Client::CodeHandler &on_code);
+
+    std::shared_ptr<const api::Client::UserRes> searchUsers(
+            const std::string &query, const api::Client::UserHandler &on_user);
+
+    unity::scopes::CategorisedResult repositoryResult(const unity::scopes::Category::SCPtr &category,
+                                                      const api::Client::Repository &repository);
+
+    unity::scopes::CategorisedResult codeResult(const unity::scopes::Category::SCPtr &category,
+                                                const api::Client::Code &code);
+
+    unity::scopes::CategorisedResult userResult(const unity::scopes::Category::SCPtr &category,
+                                                const api::Client::User &user,
+                                                const std::shared_ptr<const api::Client::User> &profile);
 
     std::string toStr(const int value);
 
@@ -39,11 +136,14 @@ private:
     bool s_name;
     bool s_description;
     bool s_readme;
+    std::size_t s_limit;
 
     // Cache informations
-    std::string cachePath;
+    StateSnapshot::Ptr stateSnapshot;
     std::string c_query;
+    std::string c_query_loaded;
     std::string c_repo;
+    api::Client::RepositoryList c_repositories;
     void loadCache();
     void updateCache();
 };
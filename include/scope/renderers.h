@@ -0,0 +1,40 @@
+#ifndef SCOPE_RENDERERS_H_
+#define SCOPE_RENDERERS_H_
+
+#include <unity/scopes/CategoryRenderer.h>
+
+#include <memory>
+#include <string>
+
+namespace scope {
+
+/**
+ * The category renderers of every result type.
+ *
+ * Building a renderer parses its JSON template, so the scope builds them
+ * once at start and every query registers its categories with the same
+ * ones.
+ */
+struct Renderers {
+    typedef std::shared_ptr<const Renderers> Ptr;
+
+    static const std::string REPOSITORY_TEMPLATE;
+    static const std::string CODE_TEMPLATE;
+    static const std::string USER_TEMPLATE;
+    static const std::string EMPTY_TEMPLATE;
+
+    Renderers();
+
+    const unity::scopes::CategoryRenderer repositories;
+    const unity::scopes::CategoryRenderer code;
+    const unity::scopes::CategoryRenderer users;
+
+    /**
+     * The "Nothing found" page
+     */
+    const unity::scopes::CategoryRenderer empty;
+};
+
+}
+
+#endif // SCOPE_RENDERERS_H_
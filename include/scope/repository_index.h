@@ -0,0 +1,171 @@
+#ifndef SCOPE_REPOSITORY_INDEX_H_
+#define SCOPE_REPOSITORY_INDEX_H_
+
+#include <api/client.h>
+
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace scope {
+
+/**
+ * Persistent inverted index of every repository the scope has fetched.
+ *
+ * The words of the full name, description, language and owner login of
+ * each repository point back to it, so a search is answered locally in a
+ * few milliseconds, before the network request returns or without any
+ * network at all. The last word of a search is matched as a prefix, since
+ * the user is usually still typing it.
+ *
+ * Repositories are appended to a log on disk as they arrive, and loaded
+ * back at start. Updated repositories leave their old version behind in
+ * the log, and so do the least recently fetched ones once the index is
+ * full; once there are enough of those the log is rewritten on a
+ * background thread.
+ */
+class RepositoryIndex {
+public:
+    typedef std::shared_ptr<RepositoryIndex> Ptr;
+
+    struct Stats {
+        /**
+         * Repositories in the index
+         */
+        std::uint64_t repositories;
+
+        /**
+         * Searches answered from the index
+         */
+        std::uint64_t searches;
+
+        /**
+         * Times the log was rewritten
+         */
+        std::uint64_t compactions;
+
+        /**
+         * Repositories dropped to stay within the capacity
+         */
+        std::uint64_t evictions;
+    };
+
+    /**
+     * @param path the log file, created if missing
+     * @param capacity the most repositories kept
+     */
+    explicit RepositoryIndex(const std::string &path, std::size_t capacity = 20000);
+
+    ~RepositoryIndex();
+
+    RepositoryIndex(const RepositoryIndex &) = delete;
+    RepositoryIndex &operator=(const RepositoryIndex &) = delete;
+
+    /**
+     * Add repositories, or update them if they are already known
+     */
+    void add(const api::Client::RepositoryList &repositories);
+
+    /**
+     * The repositories matching every word of the query, best first
+     */
+    api::Client::RepositoryList search(const std::string &query, std::size_t limit);
+
+    Stats stats() const;
+
+private:
+    /**
+     * A repository, dead once a newer version of it was added
+     */
+    struct Document {
+        api::Client::Repository repository;
+        bool live;
+    };
+
+    /**
+     * The fields of a document a word was found in
+     */
+    enum Field : std::uint8_t {
+        NAME = 1,
+        OWNER = 2,
+        LANGUAGE = 4,
+        DESCRIPTION = 8
+    };
+
+    /**
+     * How much a match in each field counts towards the rank
+     */
+    static const unsigned int NAME_WEIGHT = 4;
+    static const unsigned int OWNER_WEIGHT = 3;
+    static const unsigned int LANGUAGE_WEIGHT = 2;
+    static const unsigned int DESCRIPTION_WEIGHT = 1;
+
+    struct Posting {
+        std::uint32_t document;
+        std::uint8_t fields;
+    };
+
+    static std::vector<std::string> words(const std::string &text);
+
+    /**
+     * The rank of a match in the given Field flags
+     */
+    static unsigned int weight(std::uint8_t fields);
+
+    void load();
+
+    /**
+     * Put a repository in the in-memory index (call with mutex_ held)
+     */
+    void insert(const api::Client::Repository &repository);
+
+    /**
+     * Drop the oldest repositories beyond the capacity (call with mutex_
+     * held)
+     */
+    void evict();
+
+    /**
+     * Rebuild the in-memory index from the live documents only (call with
+     * mutex_ held)
+     */
+    void rebuild();
+
+    bool needs_compaction() const;
+
+    void compact();
+
+    const std::string path_;
+    const std::size_t capacity_;
+
+    mutable std::mutex mutex_;
+    std::vector<Document> documents_;
+
+    // Documents before this one are all dead
+    std::size_t oldest_;
+
+    std::unordered_map<std::string, std::uint32_t> by_name_;
+    std::map<std::string, std::vector<Posting>> postings_;
+    std::size_t dead_;
+    std::ofstream log_;
+
+    // Added while the log is being rewritten, to be carried over
+    bool compacting_;
+    api::Client::RepositoryList pending_;
+    std::thread compactor_;
+
+    std::atomic<std::uint64_t> searches_;
+    std::atomic<std::uint64_t> compactions_;
+    std::atomic<std::uint64_t> evictions_;
+};
+
+}
+
+#endif // SCOPE_REPOSITORY_INDEX_H_
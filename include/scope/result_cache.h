@@ -0,0 +1,63 @@
+#ifndef SCOPE_RESULT_CACHE_H_
+#define SCOPE_RESULT_CACHE_H_
+
+#include <api/client.h>
+#include <scope/lru_cache.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+namespace scope {
+
+/**
+ * Process-wide cache of already parsed search results.
+ *
+ * Owned by the Scope and shared by every Query, so a repeated search is
+ * answered without any HTTP or JSON work.
+ */
+class ResultCache {
+public:
+    typedef std::shared_ptr<ResultCache> Ptr;
+
+    /**
+     * @param budget the number of bytes each kind of result may use
+     * @param ttl how long a result is considered fresh
+     */
+    ResultCache(std::size_t budget, std::chrono::seconds ttl);
+
+    /**
+     * The key of a repository search, including the fields searched in
+     * and the number of results asked for
+     */
+    static std::string key(const std::string &query, bool name,
+                           bool description, bool readme, std::size_t limit);
+
+    /**
+     * The key of a code search
+     */
+    static std::string key(const std::string &query, const std::string &repo);
+
+    /**
+     * The key of a user search
+     */
+    static std::string key(const std::string &query);
+
+    LruCache<api::Client::RepositoryRes> repositories;
+    LruCache<api::Client::CodeRes> code;
+    LruCache<api::Client::UserRes> users;
+
+    /**
+     * Preview details, keyed by the repository's full name
+     */
+    LruCache<api::Client::Details> details;
+
+    /**
+     * Full user profiles, keyed by the user's id
+     */
+    LruCache<api::Client::User> profiles;
+};
+
+}
+
+#endif // SCOPE_RESULT_CACHE_H_
@@ -2,6 +2,16 @@
 #define SCOPE_SCOPE_H_
 
 #include <api/config.h>
+#include <scope/avatar_cache.h>
+#include <scope/metrics_writer.h>
+#include <scope/prefetcher.h>
+#include <scope/query.h>
+#include <scope/renderers.h>
+#include <scope/repository_index.h>
+#include <scope/result_cache.h>
+#include <scope/settings_snapshot.h>
+#include <scope/state_snapshot.h>
+#include <scope/user_hydrator.h>
 
 #include <unity/scopes/ScopeBase.h>
 #include <unity/scopes/QueryBase.h>
@@ -46,6 +56,76 @@ public:
 
 protected:
     api::Config::Ptr config_;
+
+    /**
+     * Parsed search results shared by all the queries
+     */
+    ResultCache::Ptr resultCache_;
+
+    /**
+     * Repository searches in flight, so identical ones are sent only once
+     */
+    RepositoryFlights::Ptr repositoryFlights_;
+
+    /**
+     * Code searches in flight, shared between the departments
+     */
+    CodeFlights::Ptr codeFlights_;
+
+    /**
+     * Every repository fetched so far, persisted in the cache directory
+     */
+    RepositoryIndex::Ptr repositoryIndex_;
+
+    /**
+     * Downscaled owner avatars, persisted in the cache directory
+     */
+    AvatarCache::Ptr avatarCache_;
+
+    /**
+     * Fetches the previews of the top results in the background
+     */
+    Prefetcher::Ptr prefetcher_;
+
+    /**
+     * Fetches the full profiles of the users found, a few at a time
+     */
+    UserHydrator::Ptr userHydrator_;
+
+    /**
+     * The last query and its results, persisted in the cache directory
+     */
+    StateSnapshot::Ptr stateSnapshot_;
+
+    /**
+     * The category renderers, parsed once
+     */
+    Renderers::Ptr renderers_;
+
+    /**
+     * The settings, parsed again only when they change
+     */
+    SettingsSnapshot::Ptr settingsSnapshot_;
+
+    /**
+     * Where the trace is written when the scope stops, if tracing is on
+     */
+    std::string tracePath_;
+
+    /**
+     * Writes the latency histograms and counters to the cache directory
+     */
+    MetricsWriter::Ptr metricsWriter_;
+
+    /**
+     * Whether to print the stats of every service when the scope stops
+     */
+    bool printStats_ = false;
+
+    /**
+     * Print what each cache and service did so far
+     */
+    void printStats() const;
 };
 
 }
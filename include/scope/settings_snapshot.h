@@ -0,0 +1,58 @@
+#ifndef SCOPE_SETTINGS_SNAPSHOT_H_
+#define SCOPE_SETTINGS_SNAPSHOT_H_
+
+#include <unity/scopes/Variant.h>
+
+#include <cstddef>
+#include <memory>
+
+namespace scope {
+
+/**
+ * The user's settings, parsed
+ */
+struct Settings {
+    bool name;
+    bool description;
+    bool readme;
+
+    /**
+     * Repositories per search
+     */
+    std::size_t limit;
+
+    static Settings parse(const unity::scopes::VariantMap &settings);
+};
+
+/**
+ * The current settings, shared by all the queries.
+ *
+ * Queries hand over the settings they were given; they are only parsed
+ * again when one of the values the scope reads differs from the current
+ * ones, so the rest of the map is never copied or compared. Only the
+ * current version is kept, and readers hold on to it by reference count.
+ */
+class SettingsSnapshot {
+public:
+    typedef std::shared_ptr<SettingsSnapshot> Ptr;
+
+    SettingsSnapshot() = default;
+
+    SettingsSnapshot(const SettingsSnapshot &) = delete;
+    SettingsSnapshot &operator=(const SettingsSnapshot &) = delete;
+
+    /**
+     * The settings for raw
+     */
+    std::shared_ptr<const Settings> get(const unity::scopes::VariantMap &raw);
+
+private:
+    struct Version;
+
+    // Read and replaced with the atomic shared_ptr functions
+    std::shared_ptr<const Version> current_;
+};
+
+}
+
+#endif // SCOPE_SETTINGS_SNAPSHOT_H_
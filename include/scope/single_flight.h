@@ -0,0 +1,220 @@
+#ifndef SCOPE_SINGLE_FLIGHT_H_
+#define SCOPE_SINGLE_FLIGHT_H_
+
+#include <api/cancellation.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace scope {
+
+/**
+ * Coalesces identical searches that are in flight at the same time.
+ *
+ * The first caller for a key starts the fetch on a background thread;
+ * later callers for the same key attach to it instead of sending their own
+ * request. Every caller receives the items already parsed, then the rest
+ * as they arrive, then the shared result. A caller that is cancelled just
+ * detaches; the fetch itself is only aborted when nobody waits for it.
+ */
+template<typename Value, typename Item>
+class SingleFlight {
+public:
+    typedef std::shared_ptr<SingleFlight> Ptr;
+
+    typedef std::shared_ptr<const Value> ValuePtr;
+
+    typedef std::function<void(const Item &)> ItemHandler;
+
+    /**
+     * Performs the actual request, reporting each item through emit
+     */
+    typedef std::function<Value(const api::CancellationToken &token,
+                                const ItemHandler &emit)> Fetch;
+
+    struct Stats {
+        /**
+         * Requests actually sent
+         */
+        std::uint64_t started;
+
+        /**
+         * Callers that attached to a request already in flight
+         */
+        std::uint64_t saved;
+
+        /**
+         * Requests aborted because all of their callers went away
+         */
+        std::uint64_t abandoned;
+    };
+
+    SingleFlight() :
+        flights_(std::make_shared<Flights>()) {
+    }
+
+    /**
+     * Get the value for key, fetching it only if nobody else already is.
+     *
+     * Returns an empty pointer if the caller's token is tripped before the
+     * value arrives. Exceptions thrown by the fetch reach every caller.
+     */
+    ValuePtr run(const std::string &key, const api::CancellationToken &caller,
+                 const ItemHandler &on_item, const Fetch &fetch) {
+        std::shared_ptr<Call> call;
+        bool leader = false;
+        {
+            std::lock_guard<std::mutex> lock(flights_->mutex);
+            auto it = flights_->calls.find(key);
+            if (it != flights_->calls.end()) {
+                call = it->second;
+                ++flights_->saved;
+            } else {
+                call = std::make_shared<Call>();
+                flights_->calls[key] = call;
+                ++flights_->started;
+                leader = true;
+            }
+            ++call->waiters;
+        }
+
+        // Catch up on what was parsed before we attached
+        typename std::list<ItemHandler>::iterator subscription;
+        {
+            std::lock_guard<std::mutex> lock(call->mutex);
+            if (on_item) {
+                for (const Item &item : call->emitted) {
+                    on_item(item);
+                }
+            }
+            subscription = call->subscribers.insert(call->subscribers.end(), on_item);
+        }
+
+        if (leader) {
+            start(key, call, fetch);
+        }
+
+        while (call->result.wait_for(std::chrono::milliseconds(50))
+               != std::future_status::ready) {
+            if (caller.cancelled()) {
+                leave(key, call, subscription);
+                return ValuePtr();
+            }
+        }
+
+        leave(key, call, subscription);
+        return call->result.get();
+    }
+
+    Stats stats() const {
+        return Stats { flights_->started, flights_->saved, flights_->abandoned };
+    }
+
+private:
+    struct Call {
+        Call() :
+            result(promise.get_future().share()) {
+        }
+
+        std::promise<ValuePtr> promise;
+        std::shared_future<ValuePtr> result;
+        api::CancellationToken token;
+
+        // Guarded by Flights::mutex
+        std::size_t waiters = 0;
+
+        // Guarded by mutex
+        std::mutex mutex;
+        std::vector<Item> emitted;
+        std::list<ItemHandler> subscribers;
+    };
+
+    /**
+     * State shared with the fetch threads, which may outlive this object
+     */
+    struct Flights {
+        std::mutex mutex;
+        std::map<std::string, std::shared_ptr<Call>> calls;
+
+        std::atomic<std::uint64_t> started { 0 };
+        std::atomic<std::uint64_t> saved { 0 };
+        std::atomic<std::uint64_t> abandoned { 0 };
+
+        /**
+         * Forget the call for key, unless it was already replaced
+         */
+        void forget(const std::string &key, const std::shared_ptr<Call> &call) {
+            auto it = calls.find(key);
+            if (it != calls.end() && it->second == call) {
+                calls.erase(it);
+            }
+        }
+    };
+
+    void start(const std::string &key, std::shared_ptr<Call> call, Fetch fetch) {
+        std::shared_ptr<Flights> flights = flights_;
+        std::thread([key, call, fetch, flights]() {
+            // Hand each item to whoever is attached at that moment
+            auto emit = [call](const Item &item) {
+                std::lock_guard<std::mutex> lock(call->mutex);
+                call->emitted.push_back(item);
+                for (const ItemHandler &handler : call->subscribers) {
+                    if (handler) {
+                        handler(item);
+                    }
+                }
+            };
+
+            try {
+                ValuePtr value = std::make_shared<Value>(fetch(call->token, emit));
+                {
+                    std::lock_guard<std::mutex> lock(flights->mutex);
+                    flights->forget(key, call);
+                }
+                call->promise.set_value(value);
+            } catch (...) {
+                {
+                    std::lock_guard<std::mutex> lock(flights->mutex);
+                    flights->forget(key, call);
+                }
+                call->promise.set_exception(std::current_exception());
+            }
+        }).detach();
+    }
+
+    void leave(const std::string &key, const std::shared_ptr<Call> &call,
+               typename std::list<ItemHandler>::iterator subscription) {
+        {
+            std::lock_guard<std::mutex> lock(flights_->mutex);
+            if (--call->waiters == 0
+                    && call->result.wait_for(std::chrono::seconds(0))
+                    != std::future_status::ready) {
+                // Nobody is interested any more: abort the request, and make
+                // sure no new caller attaches to it
+                call->token.cancel();
+                flights_->forget(key, call);
+                ++flights_->abandoned;
+            }
+        }
+
+        // Once this returns, our handler is never called again
+        std::lock_guard<std::mutex> lock(call->mutex);
+        call->subscribers.erase(subscription);
+    }
+
+    std::shared_ptr<Flights> flights_;
+};
+
+}
+
+#endif // SCOPE_SINGLE_FLIGHT_H_
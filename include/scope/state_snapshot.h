@@ -0,0 +1,93 @@
+#ifndef SCOPE_STATE_SNAPSHOT_H_
+#define SCOPE_STATE_SNAPSHOT_H_
+
+#include <api/client.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace scope {
+
+/**
+ * What the scope showed last, kept across runs.
+ *
+ * The state is a compact binary file, memory-mapped and decoded once when
+ * the scope starts; queries then read it from memory. Updates replace the
+ * whole file through a rename, so a crash leaves either the old or the
+ * new snapshot, never a mix. A missing or corrupt file reads as the
+ * default state.
+ *
+ * Queries update the state on every keystroke, so the file is written on
+ * a background thread once the updates settle down, and once more when
+ * the snapshot is destroyed.
+ */
+class StateSnapshot {
+public:
+    typedef std::shared_ptr<StateSnapshot> Ptr;
+
+    struct State {
+        /**
+         * The last query searched for
+         */
+        std::string query { "module" };
+
+        /**
+         * The repository code is searched in
+         */
+        std::string repo { "linux/linux" };
+
+        /**
+         * The repositories shown for the last query, in order
+         */
+        api::Client::RepositoryList repositories;
+    };
+
+    /**
+     * @param path the snapshot file, created on the first update
+     * @param delay how long the state has to stay the same to be written
+     */
+    explicit StateSnapshot(const std::string &path,
+                           std::chrono::milliseconds delay = std::chrono::milliseconds(2000));
+
+    ~StateSnapshot();
+
+    StateSnapshot(const StateSnapshot &) = delete;
+    StateSnapshot &operator=(const StateSnapshot &) = delete;
+
+    std::shared_ptr<const State> state() const;
+
+    /**
+     * Replace the state, writing it out later only if it changed
+     */
+    void update(const State &state);
+
+private:
+    void load();
+
+    void work();
+
+    bool save(const std::string &data) const;
+
+    const std::string path_;
+    const std::chrono::milliseconds delay_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    std::shared_ptr<const State> state_;
+
+    // The state as written to the file, to tell whether an update changes it
+    std::string encoded_;
+    bool dirty_;
+    std::chrono::steady_clock::time_point updated_;
+    bool stopping_;
+
+    std::thread worker_;
+};
+
+}
+
+#endif // SCOPE_STATE_SNAPSHOT_H_
@@ -0,0 +1,88 @@
+#ifndef SCOPE_USER_HYDRATOR_H_
+#define SCOPE_USER_HYDRATOR_H_
+
+#include <api/cancellation.h>
+#include <api/client.h>
+#include <scope/result_cache.h>
+#include <scope/work_queue.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace scope {
+
+/**
+ * Completes the users returned by a search with their full profiles.
+ *
+ * A user search only returns the login, the id and the URLs of each user;
+ * the company, bio and counters need one request per user. A few worker
+ * threads fetch them into the shared ResultCache, keyed by user id, so
+ * the following renders and previews show the full profile. The requests
+ * are made at background priority, so the rate limiter drops them first
+ * when the budget runs low.
+ */
+class UserHydrator {
+public:
+    typedef std::shared_ptr<UserHydrator> Ptr;
+
+    struct Stats {
+        /**
+         * Profiles fetched
+         */
+        std::uint64_t hydrated;
+
+        /**
+         * Users skipped because their profile was already cached
+         */
+        std::uint64_t cached;
+
+        /**
+         * Users dropped because the queue was full
+         */
+        std::uint64_t dropped;
+    };
+
+    /**
+     * @param config the API configuration
+     * @param cache where the profiles go
+     * @param parallelism the most profile requests in flight at any time
+     * @param capacity the most users waiting at any time
+     */
+    UserHydrator(api::Config::Ptr config, ResultCache::Ptr cache,
+                 std::size_t parallelism = 4, std::size_t capacity = 64);
+
+    UserHydrator(const UserHydrator &) = delete;
+    UserHydrator &operator=(const UserHydrator &) = delete;
+
+    /**
+     * The full profile of a user, if it has been fetched
+     */
+    std::shared_ptr<const api::Client::User> profile(unsigned int id) const;
+
+    /**
+     * Queue users ahead of the ones already waiting: the latest query is
+     * the one the user is looking at
+     */
+    void hydrate(const std::vector<api::Client::User> &stubs);
+
+    Stats stats() const;
+
+private:
+    void fetch(const api::Client::User &stub, const api::CancellationToken &stop);
+
+    const ResultCache::Ptr cache_;
+
+    api::Client::Ptr client_;
+
+    std::atomic<std::uint64_t> hydrated_;
+    std::atomic<std::uint64_t> cached_;
+
+    // Last, so its workers are joined before anything they use goes away
+    WorkQueue<api::Client::User, unsigned int> queue_;
+};
+
+}
+
+#endif // SCOPE_USER_HYDRATOR_H_
@@ -0,0 +1,140 @@
+#ifndef SCOPE_WORK_QUEUE_H_
+#define SCOPE_WORK_QUEUE_H_
+
+#include <api/cancellation.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+namespace scope {
+
+/**
+ * A bounded queue of background work, newest first.
+ *
+ * Worker threads take items from the front and hand them to the handler
+ * one at a time. New items go in front of the ones already waiting, since
+ * the latest query is the one the user is looking at; items already
+ * waiting are not queued twice, and when the queue is over capacity the
+ * oldest ones are dropped.
+ *
+ * Destroying the queue trips the token passed to the handler, so the
+ * requests in flight are aborted, and joins the workers. Anything the
+ * handler uses must therefore outlive the queue.
+ */
+template<typename Item, typename Key>
+class WorkQueue {
+public:
+    /**
+     * What tells two items apart, such as a repository's full name
+     */
+    typedef std::function<Key(const Item &)> KeyOf;
+
+    /**
+     * Does the work for an item, giving up once stop is tripped
+     */
+    typedef std::function<void(const Item &item,
+                               const api::CancellationToken &stop)> Handler;
+
+    /**
+     * @param capacity the most items waiting at any time
+     * @param parallelism the number of worker threads
+     */
+    WorkQueue(std::size_t capacity, std::size_t parallelism,
+              const KeyOf &key_of, const Handler &handler) :
+        capacity_(capacity), key_of_(key_of), handler_(handler), dropped_(0) {
+        for (std::size_t i = 0; i < parallelism; ++i) {
+            workers_.emplace_back(&WorkQueue::work, this);
+        }
+    }
+
+    ~WorkQueue() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_.cancel();
+        }
+        wake_.notify_all();
+        for (auto &worker : workers_) {
+            worker.join();
+        }
+    }
+
+    WorkQueue(const WorkQueue &) = delete;
+    WorkQueue &operator=(const WorkQueue &) = delete;
+
+    /**
+     * Queue items, best first, ahead of the ones already waiting
+     */
+    void push(const std::vector<Item> &items) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            // Walk backwards so the best item ends up at the front
+            for (auto it = items.rbegin(); it != items.rend(); ++it) {
+                if (!queued_.insert(key_of_(*it)).second) {
+                    continue;
+                }
+                queue_.push_front(*it);
+            }
+
+            // What was queued for older queries goes first
+            while (queue_.size() > capacity_) {
+                queued_.erase(key_of_(queue_.back()));
+                queue_.pop_back();
+                ++dropped_;
+            }
+        }
+        wake_.notify_all();
+    }
+
+    /**
+     * Items dropped because the queue was full
+     */
+    std::uint64_t dropped() const {
+        return dropped_;
+    }
+
+private:
+    void work() {
+        for (;;) {
+            Item item;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, [this]() { return stop_.cancelled() || !queue_.empty(); });
+                if (stop_.cancelled()) {
+                    return;
+                }
+                item = queue_.front();
+                queue_.pop_front();
+                queued_.erase(key_of_(item));
+            }
+            handler_(item, stop_);
+        }
+    }
+
+    const std::size_t capacity_;
+    const KeyOf key_of_;
+    const Handler handler_;
+
+    // Tripped on destruction, to abort the work in flight
+    api::CancellationToken stop_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<Item> queue_;
+    std::set<Key> queued_;
+
+    std::vector<std::thread> workers_;
+
+    std::atomic<std::uint64_t> dropped_;
+};
+
+}
+
+#endif // SCOPE_WORK_QUEUE_H_
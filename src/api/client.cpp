@@ -1,10 +1,38 @@
 #include <api/client.h>
+#include <api/connection_pool.h>
+#include <api/decoder.h>
+#include <api/graphql_client.h>
+#include <api/inflater.h>
+#include <api/json_stream.h>
+#include <api/latency_tracker.h>
+#include <api/metrics.h>
+#include <api/response_cache.h>
+#include <api/tracer.h>
 
 #include <core/net/error.h>
 #include <core/net/http/client.h>
 #include <core/net/http/content_type.h>
 #include <core/net/http/response.h>
-#include <QVariantMap>
+#include <core/net/http/streaming_client.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <random>
+#include <set>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include <strings.h>
+
+#include <QByteArray>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonParseError>
 
 namespace http = core::net::http;
 namespace net = core::net;
@@ -12,15 +40,501 @@ namespace net = core::net;
 using namespace api;
 using namespace std;
 
+namespace {
+
+/**
+ * A request path as shown in traces
+ */
+string joined(const net::Uri::Path &path) {
+    string result;
+    for (const auto &segment : path) {
+        result += "/" + segment;
+    }
+    return result;
+}
+
+/**
+ * The total_count of a search, known only once the whole response arrived
+ */
+unsigned int total_count(const JsonStream &stream) {
+    if (!stream.complete()) {
+        return 0;
+    }
+    return strtoul(stream.field("total_count").c_str(), nullptr, 10);
+}
+
+/**
+ * Count something, if the scope keeps metrics
+ */
+void count(const Config &config, Metrics::Counter counter, uint64_t amount = 1) {
+    if (config.metrics && amount > 0) {
+        config.metrics->add(counter, amount);
+    }
+}
+
+/**
+ * The latency histogram of a request path, if the scope keeps metrics
+ */
+Metrics::Histogram *latency_of(const Config &config, const net::Uri::Path &path) {
+    return config.metrics ? &config.metrics->latency(Metrics::endpoint(path)) : nullptr;
+}
+
+/**
+ * Wait for our turn within the rate limit, counting the requests that
+ * had to wait for it or were turned away
+ */
+bool acquire(const Config &config, RateLimiter::Endpoint endpoint,
+             RateLimiter::Priority priority, const CancellationToken &token) {
+    if (!config.rate_limiter) {
+        return true;
+    }
+    auto asked = chrono::steady_clock::now();
+    bool allowed = config.rate_limiter->acquire(endpoint, priority, token);
+    if ((!allowed && !token.cancelled())
+            || chrono::steady_clock::now() - asked >= chrono::milliseconds(1)) {
+        count(config, Metrics::Counter::rate_limit_stalls);
+    }
+    return allowed;
+}
+
+/**
+ * Copies of one request racing each other, for hedging.
+ *
+ * Each attempt runs on its own thread. The first one to start answering
+ * wins and streams its body to the caller; the others abort as soon as
+ * they notice. The state is shared with the threads, since a losing
+ * attempt may still be running when the caller is done.
+ */
+class Race: public enable_shared_from_this<Race> {
+public:
+    struct Attempt {
+        bool done = false;
+        http::Response response;
+        string body;
+        exception_ptr error;
+    };
+
+    Race(Config::Ptr config, const http::Request::Configuration &configuration,
+         RateLimiter::Endpoint endpoint, const CancellationToken &token,
+         const function<void(const string &)> &on_data) :
+        config_(config), configuration_(configuration), endpoint_(endpoint),
+        token_(token), on_data_(&on_data), winner_(UNDECIDED), forwarded_(false),
+        launched_(0) {
+    }
+
+    /**
+     * Send the original request, on a connection the caller already has
+     */
+    void start(shared_ptr<ConnectionPool::Lease> lease,
+               shared_ptr<http::StreamingClient> client) {
+        launch(lease, client);
+    }
+
+    /**
+     * Wait for an attempt to answer, hedging if the original is slow.
+     *
+     * Returns the winning attempt, or nullptr if the token was tripped
+     * before anyone answered. If every attempt failed, the first error is
+     * rethrown.
+     */
+    const Attempt *finish() {
+        // Hedge only once we know what a normal response time is
+        auto hedge_at = chrono::steady_clock::time_point::max();
+        if (config_->latency && config_->hedge_percentile > 0) {
+            auto delay = config_->latency->percentile(config_->hedge_percentile);
+            if (delay > LatencyTracker::Duration::zero()) {
+                hedge_at = chrono::steady_clock::now()
+                        + max<LatencyTracker::Duration>(delay, config_->min_hedge_delay);
+            }
+        }
+
+        unique_lock<mutex> lock(mutex_);
+        for (;;) {
+            int winner = winner_;
+            if (winner >= 0 && attempts_[winner].done) {
+                if (attempts_[winner].error) {
+                    // The winner broke off in the middle of its body
+                    rethrow_exception(attempts_[winner].error);
+                }
+                if (winner > 0 && config_->latency) {
+                    config_->latency->hedge_won();
+                }
+                return &attempts_[winner];
+            }
+
+            bool all_done = true;
+            for (size_t i = 0; i < launched_; ++i) {
+                all_done = all_done && attempts_[i].done;
+            }
+            if (all_done && winner < 0) {
+                // Nobody answered: every attempt failed
+                for (size_t i = 0; i < launched_; ++i) {
+                    if (attempts_[i].error) {
+                        rethrow_exception(attempts_[i].error);
+                    }
+                }
+                throw domain_error("No response from " + configuration_.uri);
+            }
+
+            if (token_.cancelled()) {
+                // Stop anyone from claiming the caller now. If an attempt is
+                // already streaming, wait for it to notice the cancellation.
+                int expected = UNDECIDED;
+                if (winner_.compare_exchange_strong(expected, CLOSED)
+                        || expected == CLOSED) {
+                    return nullptr;
+                }
+            }
+
+            auto now = chrono::steady_clock::now();
+            if (winner_ == UNDECIDED && launched_ < MAX_ATTEMPTS && now >= hedge_at) {
+                hedge_at = chrono::steady_clock::time_point::max();
+
+                // A hedge is speculative, so it only goes out if a connection
+                // is free and the budget can spare it
+                lock.unlock();
+                shared_ptr<ConnectionPool::Lease> lease;
+                if (config_->pool) {
+                    lease = config_->pool->try_acquire(config_->apiroot);
+                }
+                bool allowed = (!config_->pool || lease)
+                        && (!config_->rate_limiter
+                            || config_->rate_limiter->acquire(endpoint_,
+                                                              RateLimiter::Priority::background,
+                                                              token_));
+                lock.lock();
+                if (allowed && winner_ == UNDECIDED) {
+                    if (config_->latency) {
+                        config_->latency->hedged();
+                    }
+                    launch(lease, lease ? lease->client() : nullptr);
+                }
+                continue;
+            }
+
+            // Check the token regularly, like the progress callbacks do
+            changed_.wait_until(lock, min(hedge_at, now + chrono::milliseconds(50)));
+        }
+    }
+
+    /**
+     * Whether any part of a body reached the caller
+     */
+    bool forwarded() const {
+        return forwarded_;
+    }
+
+private:
+    static const int UNDECIDED = -1;
+    static const int CLOSED = -2;
+    static const size_t MAX_ATTEMPTS = 2;
+
+    /**
+     * Start the next attempt, on its own thread (call with mutex_ held or
+     * before any attempt runs)
+     */
+    void launch(shared_ptr<ConnectionPool::Lease> lease,
+                shared_ptr<http::StreamingClient> client) {
+        int me = launched_++;
+        shared_ptr<Race> self = shared_from_this();
+        thread([self, me, lease, client]() {
+            self->run(me, lease, client);
+        }).detach();
+    }
+
+    /**
+     * Make this attempt the one streaming to the caller, if no other is
+     */
+    bool claim(int me, chrono::steady_clock::time_point sent) {
+        int expected = UNDECIDED;
+        if (winner_.compare_exchange_strong(expected, me)) {
+            if (config_->latency) {
+                config_->latency->record(chrono::steady_clock::now() - sent);
+            }
+            return true;
+        }
+        return expected == me;
+    }
+
+    void run(int me, shared_ptr<ConnectionPool::Lease> lease,
+             shared_ptr<http::StreamingClient> client) {
+        Tracer::Span span(config_->tracer, me ? "hedge" : "attempt");
+        auto sent = chrono::steady_clock::now();
+        auto first_byte = chrono::steady_clock::time_point();
+        http::Response response;
+        string body;
+        exception_ptr error;
+        bool mine = false;
+
+        // Nothing may be thrown through net-cpp, so a corrupt body or a
+        // failing caller is kept here and the transfer aborted
+        exception_ptr broken;
+
+        // Only the winner may touch the caller's handler. Compressed bodies
+        // are inflated on the way, a block at a time.
+        Inflater inflater([&](const string &block) {
+            body += block;
+            if (mine) {
+                forwarded_ = true;
+                (*on_data_)(block);
+            }
+        });
+        auto data_handler = [&](const string &chunk) {
+            if (first_byte == chrono::steady_clock::time_point()) {
+                first_byte = chrono::steady_clock::now();
+                if (config_->tracer) {
+                    config_->tracer->instant("first byte");
+                }
+            }
+            count(*config_, Metrics::Counter::bytes_fetched, chunk.size());
+            if (!mine) {
+                mine = claim(me, sent);
+            }
+
+            // Inflating, parsing and whatever the caller does with the results
+            Tracer::Span handling(config_->tracer, "chunk");
+            if (broken) {
+                return;
+            }
+            try {
+                inflater.feed(chunk);
+            } catch (...) {
+                broken = current_exception();
+            }
+        };
+
+        // Give up when the query is cancelled, another attempt won or the
+        // body can't be used
+        auto progress = [this, me, &broken](const http::Request::Progress &) {
+            int winner = winner_;
+            return token_.cancelled() || broken || (winner != UNDECIDED && winner != me) ?
+                        http::Request::Progress::Next::abort_operation :
+                        http::Request::Progress::Next::continue_operation;
+        };
+
+        try {
+            if (!client) {
+                client = http::make_streaming_client();
+            }
+            if (lease) {
+                response = lease->execute(configuration_, progress, data_handler);
+            } else {
+                // Build a HTTP request object from our configuration
+                auto request = client->streaming_head(configuration_);
+                response = request->execute(progress, data_handler);
+            }
+            if (broken) {
+                rethrow_exception(broken);
+            }
+            inflater.finish(Client::header_value(response.header, "Content-Encoding"));
+
+            // Responses without a body, such as 304s, win when they complete
+            if (!mine) {
+                claim(me, sent);
+            }
+            if (config_->tracer && first_byte != chrono::steady_clock::time_point()) {
+                config_->tracer->complete("download", first_byte, chrono::steady_clock::now());
+            }
+        } catch (...) {
+            // An aborted transfer fails too, but that's not the reason
+            error = broken ? broken : current_exception();
+        }
+
+        {
+            lock_guard<mutex> lock(mutex_);
+            Attempt &attempt = attempts_[me];
+            attempt.response = response;
+            attempt.body = move(body);
+            attempt.error = error;
+            attempt.done = true;
+        }
+        changed_.notify_all();
+    }
+
+    const Config::Ptr config_;
+    const http::Request::Configuration configuration_;
+    const RateLimiter::Endpoint endpoint_;
+    const CancellationToken token_;
+
+    // Only dereferenced by the winner, which the caller waits for
+    const function<void(const string &)> *on_data_;
+
+    atomic<int> winner_;
+    atomic<bool> forwarded_;
+
+    mutex mutex_;
+    condition_variable changed_;
+    Attempt attempts_[MAX_ATTEMPTS];
+    size_t launched_;
+};
+
+/**
+ * The longest README excerpt shown in a preview, in bytes
+ */
+const size_t README_EXCERPT = 600;
+
+/**
+ * The number of contributors shown in a preview
+ */
+const size_t TOP_CONTRIBUTORS = 5;
+
+/**
+ * Parse a whole JSON object response
+ */
+QJsonObject parse_object(const string &body, const Config &config) {
+    QJsonParseError error;
+    QJsonDocument document = QJsonDocument::fromJson(QByteArray(body.data(), body.size()),
+                                                     &error);
+
+    // No body at all means no response, not a broken one
+    if (error.error != QJsonParseError::NoError && !body.empty()) {
+        count(config, Metrics::Counter::parse_errors);
+    }
+    return document.object();
+}
+
+/**
+ * The README of a repository, as returned by the API
+ */
+string readme_text(const QJsonObject &readme) {
+    // The contents come base64 encoded, with line breaks
+    QByteArray content = QByteArray::fromBase64(
+                readme.value(QLatin1String("content")).toString().toUtf8());
+    return string(content.constData(), content.size());
+}
+
+/**
+ * Split "owner/name" into the path of a repository resource
+ */
+net::Uri::Path repository_path(const string &full_name, const string &resource) {
+    size_t slash = full_name.find('/');
+    net::Uri::Path path { "repos", full_name.substr(0, slash) };
+    if (slash != string::npos) {
+        path.push_back(full_name.substr(slash + 1));
+    }
+    path.push_back(resource);
+    return path;
+}
+
+/**
+ * Joins a set of threads when leaving the scope, even on exceptions
+ */
+class Joiner {
+public:
+    explicit Joiner(vector<thread> &threads) :
+        threads_(threads) {
+    }
+
+    ~Joiner() {
+        for (thread &t : threads_) {
+            if (t.joinable()) {
+                t.join();
+            }
+        }
+    }
+
+private:
+    vector<thread> &threads_;
+};
+
+}
+
 Client::Client(Config::Ptr config) :
-    config_(config), cancelled_(false) {
+    config_(config) {
+}
+
+Client::Ptr Client::create(Config::Ptr config) {
+    switch (config->backend) {
+    case Config::Backend::graphql:
+        return make_shared<GraphQLClient>(config);
+    case Config::Backend::rest:
+        break;
+    }
+    return make_shared<Client>(config);
+}
+
+string Client::header_value(const http::Header &header, const string &name) {
+    string result;
+    header.enumerate([&](const string &key, const set<string> &values) {
+        if (!values.empty() && strcasecmp(key.c_str(), name.c_str()) == 0) {
+            result = *values.begin();
+        }
+    });
+    return result;
+}
+
+bool Client::searches_return_profiles() const {
+    return false;
+}
+
+Client::Tracked::Tracked(Client &client, const CancellationToken &token) :
+    client_(client) {
+    lock_guard<mutex> lock(client_.active_mutex_);
+    position_ = client_.active_.insert(client_.active_.end(), token);
+}
+
+Client::Tracked::~Tracked() {
+    lock_guard<mutex> lock(client_.active_mutex_);
+    client_.active_.erase(position_);
 }
 
 
 void Client::get(const net::Uri::Path &path,
-                 const net::Uri::QueryParameters &parameters, QJsonDocument &root) {
-    // Create a new HTTP client
-    auto client = http::make_client();
+                 const net::Uri::QueryParameters &parameters,
+                 const CancellationToken &token,
+                 const DataHandler &on_data,
+                 const ResetHandler &on_reset) {
+    Tracer::Span span(config_->tracer, "request");
+    if (span.active()) {
+        span.detail(joined(path));
+    }
+    Metrics::Timer timer(latency_of(*config_, path));
+
+    // Look up our copy of the response first, we may have to fall back on it
+    string cache_key;
+    ResponseCache::Entry cached;
+    bool have_cached = false;
+    if (config_->response_cache) {
+        cache_key = ResponseCache::key(config_->apiroot, path, parameters);
+        have_cached = config_->response_cache->find(cache_key, cached);
+    }
+    auto fall_back = [&]() {
+        if (have_cached && !token.cancelled()) {
+            config_->response_cache->served_stale();
+            count(*config_, Metrics::Counter::stale_responses);
+            on_data(cached.body);
+        }
+    };
+
+    // Wait for our turn within the rate limit. If the budget is spent, stale
+    // data is better than an error.
+    RateLimiter::Endpoint endpoint = RateLimiter::endpoint(path.empty() ? string() : path.front());
+    Tracer::Span waiting(config_->tracer, "rate limit");
+    bool allowed = acquire(*config_, endpoint, priority, token);
+    waiting.end();
+    if (!allowed) {
+        timer.dismiss();
+        fall_back();
+        return;
+    }
+
+    // Borrow a warm connection from the shared pool if the scope set one up,
+    // otherwise create a new HTTP client just for this request
+    Tracer::Span connecting(config_->tracer, "connection");
+    shared_ptr<ConnectionPool::Lease> lease;
+    shared_ptr<http::StreamingClient> client;
+    if (config_->pool) {
+        lease = config_->pool->acquire(config_->apiroot, token);
+        if (!lease) {
+            timer.dismiss();
+            fall_back();
+            return;
+        }
+        client = lease->client();
+    } else {
+        client = http::make_streaming_client();
+    }
+    connecting.end();
 
     // Start building the request configuration
     http::Request::Configuration configuration;
@@ -32,97 +546,473 @@ void Client::get(const net::Uri::Path &path,
     // Give out a user agent string
     configuration.header.add("User-Agent", config_->user_agent);
 
-    // Build a HTTP request object from our configuration
-    auto request = client->head(configuration);
+    // Authenticated requests get a much larger budget
+    if (!config_->access_token.empty()) {
+        configuration.header.add("Authorization", "token " + config_->access_token);
+    }
+
+    // Search results are very repetitive JSON, and shrink a lot
+    if (config_->compression) {
+        configuration.header.add("Accept-Encoding", "gzip, deflate");
+    }
+
+    // If we have seen this request before, ask the server whether our copy
+    // is still good instead of downloading it again
+    if (have_cached) {
+        if (!cached.etag.empty()) {
+            configuration.header.add("If-None-Match", cached.etag);
+        }
+        if (!cached.last_modified.empty()) {
+            configuration.header.add("If-Modified-Since", cached.last_modified);
+        }
+        config_->response_cache->revalidated();
+    }
+
+    // Send the request, hedged if it is slow and retried if it fails for a
+    // reason that may go away. Each chunk of the body is handed to on_data
+    // as soon as it arrives.
+    http::Response response;
+    string body;
+    bool forwarded = false;
+    for (size_t attempt = 1;; ++attempt) {
+        auto race = make_shared<Race>(config_, configuration, endpoint, token, on_data);
+        race->start(lease, client);
+        lease.reset();
+        client.reset();
 
-    try {
-        // Synchronously make the HTTP request
-        // We bind the cancellable callback to #progress_report
-        auto response = request->execute(
-                    bind(&Client::progress_report, this, placeholders::_1));
+        const Race::Attempt *answer = nullptr;
+        try {
+            answer = race->finish();
+        } catch (net::Error &) {
+            // Once part of a body went out, starting over would repeat it
+            if (race->forwarded() || !retry(attempt, endpoint, token)) {
+                if (!race->forwarded()) {
+                    fall_back();
+                }
+                return;
+            }
+            continue;
+        }
+        if (!answer) {
+            // Cancelled
+            timer.dismiss();
+            return;
+        }
 
+        // Whatever the outcome, the server told us where the budget stands
+        if (config_->rate_limiter) {
+            config_->rate_limiter->update(endpoint,
+                                          header_value(answer->response.header, "X-RateLimit-Remaining"),
+                                          header_value(answer->response.header, "X-RateLimit-Reset"),
+                                          header_value(answer->response.header, "Retry-After"));
+        }
+
+        // Server errors are usually transient. Their bodies hold no results,
+        // but the caller may have collected them, so it starts over.
+        int status = static_cast<int>(answer->response.status);
+        if (status >= 500 && retry(attempt, endpoint, token)) {
+            if (race->forwarded()) {
+                on_reset();
+            }
+            continue;
+        }
+
+        response = answer->response;
+        body = answer->body;
+        forwarded = race->forwarded();
+        break;
+    }
+
+    // GitHub answers 403 when the primary limit is spent, and 429 for
+    // the secondary limits
+    bool rate_limited = response.status == static_cast<http::Status>(429)
+            || (response.status == http::Status::forbidden
+                && header_value(response.header, "X-RateLimit-Remaining") == "0");
+
+    if (have_cached && response.status == http::Status::not_modified) {
+        // Our copy is still current
+        config_->response_cache->hit(cached.body.size());
+        count(*config_, Metrics::Counter::response_cache_hits);
+        on_data(cached.body);
+    } else if (have_cached && rate_limited) {
+        // Better than nothing, but the error body went out first
+        if (forwarded) {
+            on_reset();
+        }
+        fall_back();
+    } else if (response.status != http::Status::ok) {
         // Check that we got a sensible HTTP status code
+        throw domain_error(body);
+    } else if (config_->response_cache) {
+        // Keep the body for next time if the server gave us validators
+        ResponseCache::Entry entry {
+            header_value(response.header, "ETag"),
+            header_value(response.header, "Last-Modified"),
+            body
+        };
+        if (!entry.etag.empty() || !entry.last_modified.empty()) {
+            config_->response_cache->store(cache_key, entry);
+        }
+    }
+}
+
+string Client::post(const net::Uri::Path &path, const string &payload,
+                    const CancellationToken &token) {
+    Tracer::Span span(config_->tracer, "request");
+    if (span.active()) {
+        span.detail(joined(path));
+    }
+    Metrics::Timer timer(latency_of(*config_, path));
+
+    RateLimiter::Endpoint endpoint = RateLimiter::endpoint(path.empty() ? string() : path.front());
+    Tracer::Span waiting(config_->tracer, "rate limit");
+    bool allowed = acquire(*config_, endpoint, priority, token);
+    waiting.end();
+    if (!allowed) {
+        timer.dismiss();
+        return string();
+    }
+
+    // Queries are not cached, but the connection is still worth reusing
+    shared_ptr<ConnectionPool::Lease> lease;
+    shared_ptr<http::StreamingClient> client;
+    if (config_->pool) {
+        lease = config_->pool->acquire(config_->apiroot, token);
+        if (!lease) {
+            timer.dismiss();
+            return string();
+        }
+        client = lease->client();
+    } else {
+        client = http::make_streaming_client();
+    }
+
+    http::Request::Configuration configuration;
+    configuration.uri = client->uri_to_string(net::make_uri(config_->apiroot, path, { }));
+    configuration.header.add("User-Agent", config_->user_agent);
+    if (config_->compression) {
+        configuration.header.add("Accept-Encoding", "gzip, deflate");
+    }
+    if (!config_->access_token.empty()) {
+        configuration.header.add("Authorization", "bearer " + config_->access_token);
+    }
+
+    // Not hedged: the body is only parsed once complete, so a duplicate
+    // would gain little. Failures are retried like GETs.
+    for (size_t attempt = 1;; ++attempt) {
+        string body;
+        Inflater inflater([&body](const string &block) { body += block; });
+
+        Tracer::Span attempting(config_->tracer, "attempt");
+        bool first_byte = true;
+        http::Response response;
+        exception_ptr broken;
+        try {
+            auto request = client->streaming_post(configuration, payload, "application/json");
+            response = request->execute([&](const http::Request::Progress &progress) {
+                return broken ? http::Request::Progress::Next::abort_operation :
+                                progress_report(progress, token);
+            }, [&](const string &chunk) {
+                if (first_byte && config_->tracer) {
+                    config_->tracer->instant("first byte");
+                }
+                first_byte = false;
+                count(*config_, Metrics::Counter::bytes_fetched, chunk.size());
+                if (broken) {
+                    return;
+                }
+                try {
+                    inflater.feed(chunk);
+                } catch (...) {
+                    broken = current_exception();
+                }
+            });
+        } catch (net::Error &) {
+            if (broken) {
+                rethrow_exception(broken);
+            }
+            if (!retry(attempt, endpoint, token)) {
+                if (token.cancelled()) {
+                    timer.dismiss();
+                }
+                return string();
+            }
+            continue;
+        }
+        if (broken) {
+            rethrow_exception(broken);
+        }
+        inflater.finish(header_value(response.header, "Content-Encoding"));
+
+        if (config_->rate_limiter) {
+            config_->rate_limiter->update(endpoint,
+                                          header_value(response.header, "X-RateLimit-Remaining"),
+                                          header_value(response.header, "X-RateLimit-Reset"),
+                                          header_value(response.header, "Retry-After"));
+        }
+        int status = static_cast<int>(response.status);
+        if (status >= 500 && retry(attempt, endpoint, token)) {
+            continue;
+        }
         if (response.status != http::Status::ok) {
-            throw domain_error(response.body);
+            throw domain_error(body);
+        }
+        return body;
+    }
+}
+
+string Client::readme_excerpt(const string &text) {
+    if (text.size() <= README_EXCERPT) {
+        return text;
+    }
+
+    size_t end = text.find_last_of(" \n", README_EXCERPT);
+    if (end == string::npos || end < README_EXCERPT / 2) {
+        // No good place to cut, but don't split a UTF-8 character
+        end = README_EXCERPT;
+        while (end > 0 && (static_cast<unsigned char>(text[end]) & 0xC0) == 0x80) {
+            --end;
         }
-        // Parse the JSON from the response
-        root = QJsonDocument::fromJson(response.body.c_str());
+    }
+    return text.substr(0, end) + "...";
+}
+
+bool Client::retry(size_t attempt, RateLimiter::Endpoint endpoint,
+                   const CancellationToken &token) {
+    if (attempt >= config_->max_attempts || token.cancelled()) {
+        return false;
+    }
 
-        // Open weather map API error code can either be a string or int
-        QVariant cod = root.toVariant().toMap()["cod"];
-        if ((cod.canConvert<QString>() && cod.toString() != "200")
-                || (cod.canConvert<unsigned int>() && cod.toUInt() != 200)) {
-            throw domain_error(root.toVariant().toMap()["message"].toString().toStdString());
+    // Exponential backoff with full jitter, so that clients which failed
+    // together don't retry together
+    Tracer::Span span(config_->tracer, "backoff");
+    static thread_local minstd_rand engine(random_device{}());
+    auto ceiling = config_->retry_backoff * (1 << min<size_t>(attempt - 1, 10));
+    uniform_int_distribution<chrono::milliseconds::rep> distribution(0, ceiling.count());
+    auto until = chrono::steady_clock::now() + chrono::milliseconds(distribution(engine));
+    while (chrono::steady_clock::now() < until) {
+        if (token.cancelled()) {
+            return false;
         }
-    } catch (net::Error &) {
+        this_thread::sleep_for(min<chrono::steady_clock::duration>(
+                                   until - chrono::steady_clock::now(),
+                                   chrono::milliseconds(50)));
     }
+
+    // A retry costs as much budget as the original request
+    if (!acquire(*config_, endpoint, priority, token)) {
+        return false;
+    }
+    if (config_->latency) {
+        config_->latency->retried();
+    }
+    return true;
+}
+
+Client::UserRes Client::users(const string& query, const UserHandler &on_user) {
+    return users(query, CancellationToken(), on_user);
+}
+
+Client::UserRes Client::users(const string &query,
+                              const CancellationToken &token,
+                              const UserHandler &on_user) {
+    Tracked tracked(*this, token);
+    return fetch_users(query, token, on_user);
 }
 
-Client::UserRes Client::users(const string& query) {
+future<Client::UserRes> Client::users_async(const string &query,
+                                            const CancellationToken &token,
+                                            const UserHandler &on_user) {
+    return async(launch::async, [this, query, token, on_user]() {
+        Tracked tracked(*this, token);
+        return fetch_users(query, token, on_user);
+    });
+}
+
+Client::UserRes Client::fetch_users(const string& query,
+                                    const CancellationToken &token,
+                                    const UserHandler &on_user) {
     // This is the method that we will call from the Query class.
     // It connects to an HTTP source and returns the results.
 
+    UserRes result;
 
-    // In this case we are going to retrieve JSON data.
-    QJsonDocument root;
+    // Each user is read as soon as its JSON object is complete
+    JsonStream stream([&](const QJsonObject &object) {
+        if (token.cancelled()) {
+            return;
+        }
+        result.users.emplace_back();
+        decode(object, result.users.back());
+        if (on_user) {
+            on_user(result.users.back());
+        }
+    });
 
-    // Build a URI and get the contents.
+    // Build a URI and stream the contents through the parser.
     // The fist parameter forms the path part of the URI.
     // The second parameter forms the CGI parameters.
     get(
     { "search", "users" },
     { { "q", query } },
-                root);
-    // e.g. http://api.openweathermap.org/data/2.5/weather?q=QUERY&units=metric
+                token,
+                [&stream](const string &chunk) { stream.feed(chunk); },
+                [&stream]() { stream.reset(); });
 
-    UserRes result;
+    result.total_count = total_count(stream);
+    count(*config_, Metrics::Counter::parse_errors, stream.errors());
+    return result;
+}
+
+Client::RepositoryRes Client::repositories(const string& query,
+                                           bool name, bool description, bool readme,
+                                           const RepositoryHandler &on_repository) {
+    CancellationToken token;
+    Tracked tracked(*this, token);
+    return repositories_page(query, name, description, readme, 0, 0, token, on_repository);
+}
+
+Client::RepositoryRes Client::repositories(const string &query,
+                                           bool name, bool description, bool readme,
+                                           size_t limit,
+                                           const RepositoryHandler &on_repository) {
+    return repositories(query, name, description, readme, limit, CancellationToken(),
+                        on_repository);
+}
+
+Client::RepositoryRes Client::repositories(const string &query,
+                                           bool name, bool description, bool readme,
+                                           size_t limit,
+                                           const CancellationToken &token,
+                                           const RepositoryHandler &on_repository) {
+    Tracked tracked(*this, token);
+    return fetch_repositories(query, name, description, readme, limit, token, on_repository);
+}
+
+future<Client::RepositoryRes> Client::repositories_async(const string &query,
+                                                         bool name, bool description, bool readme,
+                                                         size_t limit,
+                                                         const CancellationToken &token,
+                                                         const RepositoryHandler &on_repository) {
+    return async(launch::async, [=]() {
+        Tracked tracked(*this, token);
+        return fetch_repositories(query, name, description, readme, limit, token, on_repository);
+    });
+}
 
-    // Read out the city we found
-    QVariantMap variant = root.toVariant().toMap();
-    result.total_count = variant["total_count"].toUInt();
-
-    // Read the Users
-    QVariantList items = variant["items"].toList();//.first().toMap();
-    for (const QVariant &i : items) {
-        QVariantMap item = i.toMap();
-        result.users.emplace_back(
-                    User {
-                        item["id"].toUInt(),
-                        item["avatar_url"].toString().toStdString(),
-                        item["html_url"].toString().toStdString(),
-                        item["followers_url"].toString().toStdString(),
-                        item["following_url"].toString().toStdString(),
-                        item["gists_url"].toString().toStdString(),
-                        item["starred_url"].toString().toStdString(),
-                        item["organizations_url"].toString().toStdString(),
-                        item["repos_url"].toString().toStdString(),
-                        item["name"].toString().toStdString(),
-                        item["company"].toString().toStdString(),
-                        item["blog"].toString().toStdString(),
-                        item["location"].toString().toStdString(),
-                        item["email"].toString().toStdString(),
-                        item["hireable"].toBool(),
-                        item["bio"].toString().toStdString(),
-                        item["public_repos"].toUInt(),
-                        item["public_gists"].toUInt(),
-                        item["followers"].toUInt(),
-                        item["following"].toUInt()
+Client::RepositoryRes Client::fetch_repositories(const string &query,
+                                                 bool name, bool description, bool readme,
+                                                 size_t limit,
+                                                 const CancellationToken &token,
+                                                 const RepositoryHandler &on_repository) {
+    const size_t per_page = min<size_t>(max<size_t>(limit, 1), 100);
+    const size_t pages = (max<size_t>(limit, 1) + per_page - 1) / per_page;
+
+    // Results are handed out in rank order, skipping any repository that
+    // moved from one page to the next while we were fetching them
+    RepositoryRes result;
+    result.total_count = 0;
+    unordered_set<string> seen;
+    auto deliver = [&](const Repository &repository) {
+        if (result.repositories.size() >= limit
+                || !seen.insert(repository.full_name).second) {
+            return;
+        }
+        result.repositories.emplace_back(repository);
+        if (on_repository) {
+            on_repository(result.repositories.back());
+        }
+    };
+
+    // The pages after the first are fetched in the background while the
+    // first one streams in on this thread
+    struct Page {
+        bool done = false;
+        RepositoryRes result;
+        exception_ptr error;
+    };
+    vector<Page> later(pages - 1);
+    mutex pages_mutex;
+    condition_variable page_done;
+    atomic<size_t> next_page(2);
+    atomic<size_t> last_page(pages);
+
+    size_t workers = min(max<size_t>(config_->max_parallel_pages, 2) - 1, pages - 1);
+    vector<thread> threads;
+    Joiner joiner(threads);
+    for (size_t i = 0; i < workers; ++i) {
+        threads.emplace_back([&]() {
+            for (size_t page = next_page++; page <= pages; page = next_page++) {
+                Page fetched;
+                try {
+                    // Don't bother with pages past the end of the results
+                    if (page <= last_page) {
+                        fetched.result = repositories_page(query, name, description, readme,
+                                                           page, per_page, token,
+                                                           RepositoryHandler());
                     }
-                    );
+                } catch (...) {
+                    fetched.error = current_exception();
+                }
+                fetched.done = true;
+                {
+                    lock_guard<mutex> lock(pages_mutex);
+                    later[page - 2] = move(fetched);
+                }
+                page_done.notify_all();
+            }
+        });
+    }
+
+    RepositoryRes first = repositories_page(query, name, description, readme,
+                                            1, per_page, token, deliver);
+    result.total_count = first.total_count;
+    if (first.total_count > 0) {
+        size_t wanted = min<size_t>(first.total_count, limit);
+        last_page = (wanted + per_page - 1) / per_page;
     }
+
+    for (size_t page = 2; page <= min<size_t>(pages, last_page)
+         && result.repositories.size() < limit; ++page) {
+        unique_lock<mutex> lock(pages_mutex);
+        page_done.wait(lock, [&]() { return later[page - 2].done; });
+        Page fetched = move(later[page - 2]);
+        lock.unlock();
+
+        if (fetched.error) {
+            rethrow_exception(fetched.error);
+        }
+        for (const Repository &repository : fetched.result.repositories) {
+            deliver(repository);
+        }
+    }
+
     return result;
 }
 
-Client::RepositoryRes Client::repositories(const string& query,
-                                           bool name, bool description, bool readme) {
+Client::RepositoryRes Client::repositories_page(const string &query,
+                                                bool name, bool description, bool readme,
+                                                size_t page, size_t per_page,
+                                                const CancellationToken &token,
+                                                const RepositoryHandler &on_repository) {
     // This is the method that we will call from the Query class.
     // It connects to an HTTP source and returns the results.
 
+    RepositoryRes result;
 
-    // In this case we are going to retrieve JSON data.
-    QJsonDocument root;
+    // Each repository is read as soon as its JSON object is complete
+    JsonStream stream([&](const QJsonObject &object) {
+        if (token.cancelled()) {
+            return;
+        }
+        result.repositories.emplace_back();
+        decode(object, result.repositories.back());
+        if (on_repository) {
+            on_repository(result.repositories.back());
+        }
+    });
 
-    // Build a URI and get the contents.
+    // Build a URI and stream the contents through the parser.
     // The fist parameter forms the path part of the URI.
     // The second parameter forms the CGI parameters.
     std::string in = "+in:";
@@ -130,115 +1020,271 @@ Client::RepositoryRes Client::repositories(const string& query,
     if(description) in += "description,";
     if(readme) in += "readme,";
     in = in.substr(0, in.size()-1);
+    net::Uri::QueryParameters parameters { { "q", query + in } };
+    if (page > 0) {
+        parameters.emplace_back("per_page", to_string(per_page));
+        parameters.emplace_back("page", to_string(page));
+    }
     get(
     { "search", "repositories" },
-    { { "q", query + in } },
-                root);
-    // e.g. http://api.openweathermap.org/data/2.5/weather?q=QUERY&units=metric
+    parameters,
+                token,
+                [&stream](const string &chunk) { stream.feed(chunk); },
+                [&stream]() { stream.reset(); });
 
-    RepositoryRes result;
-
-    // Read out the city we found
-    QVariantMap variant = root.toVariant().toMap();
-    result.total_count = variant["total_count"].toUInt();
-
-    // Read the Users
-    QVariantList items = variant["items"].toList();
-    for (const QVariant &i : items) {
-        QVariantMap item = i.toMap();
-        QVariantMap owner = item["owner"].toMap();
-        result.repositories.emplace_back(
-                    Repository {
-                        Owner {
-                            owner["login"].toString().toStdString(),
-                            owner["id"].toUInt(),
-                            owner["avatar_url"].toString().toStdString(),
-                            owner["html_url"].toString().toStdString()
-                        },
-                        item["name"].toString().toStdString(),
-                        item["full_name"].toString().toStdString(),
-                        item["description"].toString().toStdString(),
-                        item["private"].toBool(),
-                        item["fork"].toBool(),
-                        item["html_url"].toString().toStdString(),
-                        item["language"].toString().toStdString(),
-                        item["forks_count"].toUInt(),
-                        item["stargazers_count"].toUInt(),
-                        item["watchers_count"].toUInt(),
-                        item["open_issues_count"].toUInt(),
-                        item["created_at"].toString().toStdString(),
-                        item["pushed_at"].toString().toStdString()
-                    }
-                    );
-    }
+    result.total_count = total_count(stream);
+    count(*config_, Metrics::Counter::parse_errors, stream.errors());
     return result;
 }
 
-Client::CodeRes Client::code(const string &query, const string &repo = NULL)
+Client::CodeRes Client::code(const string &query, const string &repo,
+                             const CodeHandler &on_code)
+{
+    return code(query, repo, CancellationToken(), on_code);
+}
+
+Client::CodeRes Client::code(const string &query, const string &repo,
+                             const CancellationToken &token,
+                             const CodeHandler &on_code) {
+    Tracked tracked(*this, token);
+    return fetch_code(query, repo, token, on_code);
+}
+
+future<Client::CodeRes> Client::code_async(const string &query, const string &repo,
+                                           const CancellationToken &token,
+                                           const CodeHandler &on_code) {
+    return async(launch::async, [this, query, repo, token, on_code]() {
+        Tracked tracked(*this, token);
+        return fetch_code(query, repo, token, on_code);
+    });
+}
+
+Client::CodeRes Client::fetch_code(const string &query, const string &repo,
+                                   const CancellationToken &token,
+                                   const CodeHandler &on_code)
 {
     // This is the method that we will call from the Query class.
     // It connects to an HTTP source and returns the results.
 
-    // In this case we are going to retrieve JSON data.
-    QJsonDocument root;
+    CodeRes result;
+
+    // Each code result is read as soon as its JSON object is complete
+    JsonStream stream([&](const QJsonObject &object) {
+        if (token.cancelled()) {
+            return;
+        }
+        result.codes.emplace_back();
+        decode(object, result.codes.back());
+        if (on_code) {
+            on_code(result.codes.back());
+        }
+    });
 
-    // Build a URI and get the contents.
+    // Build a URI and stream the contents through the parser.
     // The fist parameter forms the path part of the URI.
     // The second parameter forms the CGI parameters.
     get(
     { "search", "code" },
     { { "q", query + "+repo:" + repo } },
-                root);
-    // e.g. http://api.openweathermap.org/data/2.5/weather?q=QUERY&units=metric
+                token,
+                [&stream](const string &chunk) { stream.feed(chunk); },
+                [&stream]() { stream.reset(); });
 
-    CodeRes result;
+    result.total_count = total_count(stream);
+    count(*config_, Metrics::Counter::parse_errors, stream.errors());
+    return result;
+}
 
-    // Read out the city we found
-    QVariantMap variant = root.toVariant().toMap();
-    result.total_count = variant["total_count"].toUInt();
-
-    // Read the Users
-    QVariantList items = variant["items"].toList();
-    for (const QVariant &i : items) {
-        QVariantMap item = i.toMap();
-        QVariantMap repository = item["repository"].toMap();
-        QVariantMap owner = repository["owner"].toMap();
-        result.codes.emplace_back(
-                    Code {
-                        item["name"].toString().toStdString(),
-                        item["path"].toString().toStdString(),
-                        item["html_url"].toString().toStdString(),
-                        Repository {
-                            Owner {
-                                owner["login"].toString().toStdString(),
-                                owner["id"].toUInt(),
-                                owner["avatar_url"].toString().toStdString(),
-                                owner["html_url"].toString().toStdString()
-                            },
-                            repository["name"].toString().toStdString(),
-                            repository["full_name"].toString().toStdString(),
-                            repository["description"].toString().toStdString(),
-                            repository["private"].toBool(),
-                            repository["fork"].toBool(),
-                            repository["html_url"].toString().toStdString(),
-                            repository["language"].toString().toStdString(),
-                            repository["forks_count"].toUInt(),
-                            repository["stargazers_count"].toUInt(),
-                            repository["watchers_count"].toUInt(),
-                            repository["open_issues_count"].toUInt(),
-                            repository["created_at"].toString().toStdString(),
-                            repository["pushed_at"].toString().toStdString()
-                        }
-                    }
-                    );
+Client::User Client::user(const string &login) {
+    return user(login, CancellationToken());
+}
+
+Client::User Client::user(const string &login, const CancellationToken &token) {
+    Tracked tracked(*this, token);
+    return fetch_user(login, token);
+}
+
+future<Client::User> Client::user_async(const string &login,
+                                        const CancellationToken &token) {
+    return async(launch::async, [this, login, token]() {
+        Tracked tracked(*this, token);
+        return fetch_user(login, token);
+    });
+}
+
+Client::User Client::fetch_user(const string &login,
+                                const CancellationToken &token) {
+    string body;
+    get({ "users", login }, { }, token,
+        [&body](const string &chunk) { body += chunk; },
+        [&body]() { body.clear(); });
+
+    User result;
+    decode(parse_object(body, *config_), result);
+    return result;
+}
+
+Client::Details Client::details(const string &full_name,
+                                const DetailsHandler &on_part) {
+    return details(full_name, CancellationToken(), on_part);
+}
+
+Client::Details Client::details(const string &full_name,
+                                const CancellationToken &token,
+                                const DetailsHandler &on_part) {
+    Tracked tracked(*this, token);
+    return fetch_details(full_name, token, on_part);
+}
+
+future<Client::Details> Client::details_async(const string &full_name,
+                                              const CancellationToken &token,
+                                              const DetailsHandler &on_part) {
+    return async(launch::async, [this, full_name, token, on_part]() {
+        Tracked tracked(*this, token);
+        return fetch_details(full_name, token, on_part);
+    });
+}
+
+Client::Details Client::fetch_details(const string &full_name,
+                                      const CancellationToken &token,
+                                      const DetailsHandler &on_part) {
+    // These are small JSON objects, so they are parsed once complete
+    auto fetch_body = [this, &token](const net::Uri::Path &path,
+            const net::Uri::QueryParameters &parameters) {
+        string body;
+        get(path, parameters, token, [&body](const string &chunk) { body += chunk; },
+            [&body]() { body.clear(); });
+        return body;
+    };
+
+    net::Uri::Path latest_release = repository_path(full_name, "releases");
+    latest_release.push_back("latest");
+
+    return fetch_parts({
+        [&]() {
+            Details part;
+            part.readme = readme_excerpt(readme_text(parse_object(
+                                             fetch_body(repository_path(full_name, "readme"), { }),
+                                             *config_)));
+            return part;
+        },
+        [&]() {
+            Details part;
+            QJsonObject languages = parse_object(
+                        fetch_body(repository_path(full_name, "languages"), { }), *config_);
+            for (auto it = languages.begin(); it != languages.end(); ++it) {
+                part.languages.emplace_back(it.key().toStdString(),
+                                            static_cast<unsigned int>(it.value().toDouble()));
+            }
+            sort(part.languages.begin(), part.languages.end(),
+                 [](const pair<string, unsigned int> &a, const pair<string, unsigned int> &b) {
+                return a.second > b.second;
+            });
+            return part;
+        },
+        [&]() {
+            Details part;
+            part.latest_release = parse_object(fetch_body(latest_release, { }), *config_)
+                    .value(QLatin1String("tag_name")).toString().toStdString();
+            return part;
+        },
+        [&]() {
+            return fetch_contributors(full_name, token);
+        }
+    }, token, on_part);
+}
+
+Client::Details Client::fetch_contributors(const string &full_name,
+                                           const CancellationToken &token) {
+    string body;
+    get(repository_path(full_name, "contributors"),
+    { { "per_page", to_string(TOP_CONTRIBUTORS) } },
+                token,
+                [&body](const string &chunk) { body += chunk; },
+                [&body]() { body.clear(); });
+
+    // Contributors come most active first
+    Details part;
+    QJsonParseError error;
+    QJsonArray contributors = QJsonDocument::fromJson(
+                QByteArray(body.data(), body.size()), &error).array();
+    if (error.error != QJsonParseError::NoError && !body.empty()) {
+        count(*config_, Metrics::Counter::parse_errors);
+    }
+    for (const QJsonValue &contributor : contributors) {
+        QJsonObject object = contributor.toObject();
+        part.contributors.emplace_back(
+                    object.value(QLatin1String("login")).toString().toStdString(),
+                    static_cast<unsigned int>(
+                        object.value(QLatin1String("contributions")).toDouble()));
     }
+    return part;
+}
+
+Client::Details Client::fetch_parts(const vector<function<Details()>> &fetches,
+                                    const CancellationToken &token,
+                                    const DetailsHandler &on_part) {
+    Details result;
+    mutex result_mutex;
+
+    // Every part is requested at once. A repository without a README or a
+    // release answers 404, which just leaves that part empty. The parts
+    // are merged, and reported, one at a time.
+    vector<future<void>> parts;
+    for (const auto &fetch : fetches) {
+        parts.emplace_back(async(launch::async, [&, fetch]() {
+            Details part;
+            try {
+                part = fetch();
+            } catch (domain_error &) {
+                return;
+            }
+            if (token.cancelled()) {
+                return;
+            }
+
+            lock_guard<mutex> lock(result_mutex);
+            if (!part.readme.empty()) {
+                result.readme = part.readme;
+            }
+            if (!part.languages.empty()) {
+                result.languages = part.languages;
+            }
+            if (!part.latest_release.empty()) {
+                result.latest_release = part.latest_release;
+            }
+            if (!part.contributors.empty()) {
+                result.contributors = part.contributors;
+            }
+            if (on_part) {
+                on_part(part);
+            }
+        }));
+    }
+
+    // Wait for every part, as they all refer to this frame, before
+    // passing on the first failure
+    exception_ptr error;
+    for (auto &part : parts) {
+        try {
+            part.get();
+        } catch (...) {
+            if (!error) {
+                error = current_exception();
+            }
+        }
+    }
+    if (error) {
+        rethrow_exception(error);
+    }
+
     return result;
 }
 
 http::Request::Progress::Next Client::progress_report(
-        const http::Request::Progress&) {
+        const http::Request::Progress&, const CancellationToken &token) {
 
-    return cancelled_ ?
+    return token.cancelled() ?
                 http::Request::Progress::Next::abort_operation :
                 http::Request::Progress::Next::continue_operation;
 }
@@ -253,9 +1299,23 @@ void Client::setRepo(const std::string &value)
     repo = value;
 }
 
+RateLimiter::Priority Client::getPriority() const
+{
+    return priority;
+}
+
+void Client::setPriority(RateLimiter::Priority value)
+{
+    priority = value;
+}
+
 
 void Client::cancel() {
-    cancelled_ = true;
+    // Only the requests running now are affected, later ones get new tokens
+    lock_guard<mutex> lock(active_mutex_);
+    for (const CancellationToken &token : active_) {
+        token.cancel();
+    }
 }
 
 Config::Ptr Client::config() {
@@ -0,0 +1,170 @@
+#include <api/connection_pool.h>
+
+#include <core/net/error.h>
+
+#include <future>
+#include <thread>
+
+namespace http = core::net::http;
+namespace net = core::net;
+
+using namespace api;
+using namespace std;
+
+/**
+ * One keep-alive connection: a net-cpp client and the thread running its loop
+ */
+struct ConnectionPool::Connection {
+    Connection() :
+        client(http::make_streaming_client()) {
+        auto c = client;
+        worker = thread([c]() {
+            c->run();
+        });
+    }
+
+    ~Connection() {
+        client->stop();
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+
+    shared_ptr<http::StreamingClient> client;
+    thread worker;
+    chrono::steady_clock::time_point last_used;
+};
+
+ConnectionPool::Lease::Lease(shared_ptr<ConnectionPool> pool, const string &host,
+                             shared_ptr<Connection> connection) :
+    pool_(pool), host_(host), connection_(connection) {
+}
+
+ConnectionPool::Lease::Lease(Lease &&other) :
+    pool_(move(other.pool_)), host_(move(other.host_)),
+    connection_(move(other.connection_)) {
+}
+
+ConnectionPool::Lease::~Lease() {
+    if (pool_ && connection_) {
+        pool_->release(host_, connection_);
+    }
+}
+
+shared_ptr<http::StreamingClient> ConnectionPool::Lease::client() const {
+    return connection_->client;
+}
+
+http::Response ConnectionPool::Lease::execute(
+        const http::Request::Configuration &configuration,
+        const http::Request::ProgressHandler &progress,
+        const http::StreamingRequest::DataHandler &data) {
+    // The handlers may outlive this call if curl reports twice,
+    // so they share ownership of the promise
+    auto promise = make_shared<std::promise<http::Response>>();
+    auto done = make_shared<atomic<bool>>(false);
+    auto response = promise->get_future();
+
+    http::Request::Handler handler;
+    handler.on_progress(progress);
+    handler.on_response([promise, done](const http::Response &r) {
+        if (!done->exchange(true)) {
+            promise->set_value(r);
+        }
+    });
+    handler.on_error([promise, done](const net::Error &e) {
+        if (!done->exchange(true)) {
+            promise->set_exception(make_exception_ptr(e));
+        }
+    });
+
+    auto request = connection_->client->streaming_head(configuration);
+    request->async_execute(handler, data);
+
+    return response.get();
+}
+
+ConnectionPool::ConnectionPool(size_t max_per_host, chrono::seconds keep_alive) :
+    max_per_host_(max_per_host > 0 ? max_per_host : 1), keep_alive_(keep_alive),
+    stats_ { 0, 0, 0 } {
+}
+
+ConnectionPool::~ConnectionPool() {
+    // Outstanding leases keep the pool alive, so only idle connections remain
+    hosts_.clear();
+}
+
+unique_ptr<ConnectionPool::Lease> ConnectionPool::acquire(const string &host,
+                                                         const CancellationToken &token) {
+    unique_lock<mutex> lock(mutex_);
+    Host &h = hosts_[host];
+
+    bool waited = false;
+    while (h.idle.empty() && h.open >= max_per_host_) {
+        if (token.cancelled()) {
+            return nullptr;
+        }
+        if (!waited) {
+            ++stats_.waits;
+            waited = true;
+        }
+
+        // Wake up now and then, so a cancelled query doesn't hang around
+        available_.wait_for(lock, chrono::milliseconds(50));
+    }
+    return unique_ptr<Lease>(new Lease(lend(lock, h, host)));
+}
+
+unique_ptr<ConnectionPool::Lease> ConnectionPool::try_acquire(const string &host) {
+    unique_lock<mutex> lock(mutex_);
+    Host &h = hosts_[host];
+    if (h.idle.empty() && h.open >= max_per_host_) {
+        return nullptr;
+    }
+    return unique_ptr<Lease>(new Lease(lend(lock, h, host)));
+}
+
+ConnectionPool::Lease ConnectionPool::lend(unique_lock<mutex> &lock, Host &h,
+                                           const string &host) {
+    if (!h.idle.empty()) {
+        // Take the most recently used connection, it is the most likely
+        // to still be open on the server side
+        shared_ptr<Connection> connection = h.idle.back();
+        h.idle.pop_back();
+
+        if (chrono::steady_clock::now() - connection->last_used > keep_alive_) {
+            ++stats_.estimated_handshakes;
+        } else {
+            ++stats_.estimated_reuses;
+        }
+        return Lease(shared_from_this(), host, connection);
+    }
+
+    ++h.open;
+    ++stats_.estimated_handshakes;
+    lock.unlock();
+
+    try {
+        return Lease(shared_from_this(), host, make_shared<Connection>());
+    } catch (...) {
+        lock.lock();
+        --h.open;
+        lock.unlock();
+        available_.notify_one();
+        throw;
+    }
+}
+
+void ConnectionPool::release(const string &host, shared_ptr<Connection> connection) {
+    connection->last_used = chrono::steady_clock::now();
+    {
+        lock_guard<mutex> lock(mutex_);
+        hosts_[host].idle.emplace_back(connection);
+    }
+    available_.notify_one();
+}
+
+ConnectionPool::Stats ConnectionPool::stats() const {
+    lock_guard<mutex> lock(mutex_);
+    return stats_;
+}
@@ -0,0 +1,74 @@
+#include <api/decoder.h>
+#include <api/schema.h>
+
+#include <QByteArray>
+#include <QJsonValue>
+#include <QLatin1String>
+#include <QString>
+
+using namespace api;
+using namespace std;
+
+namespace {
+
+/**
+ * Stores the value of each schema field found in an object
+ */
+template<typename Record>
+struct Decoder {
+    const QJsonObject &object;
+    Record &record;
+
+    template<typename Member>
+    void operator()(const char *key, Member Record::*member) {
+        QJsonValue value = object.value(QLatin1String(key));
+        if (!value.isUndefined() && !value.isNull()) {
+            store(value, record.*member);
+        }
+    }
+
+    static void store(const QJsonValue &value, string &member) {
+        // Reuse the member's buffer rather than going through toStdString()
+        QByteArray utf8 = value.toString().toUtf8();
+        member.assign(utf8.constData(), utf8.size());
+    }
+
+    static void store(const QJsonValue &value, unsigned int &member) {
+        member = static_cast<unsigned int>(value.toDouble());
+    }
+
+    static void store(const QJsonValue &value, bool &member) {
+        member = value.toBool();
+    }
+
+    template<typename Nested>
+    static void store(const QJsonValue &value, Nested &member) {
+        decode(value.toObject(), member);
+    }
+};
+
+template<typename Record>
+void decode_record(const QJsonObject &object, Record &record) {
+    // Start from a value-initialised record, so missing keys read as 0/false
+    record = Record();
+    Decoder<Record> decoder { object, record };
+    Schema<Record>::visit(decoder);
+}
+
+}
+
+void api::decode(const QJsonObject &object, Client::Owner &owner) {
+    decode_record(object, owner);
+}
+
+void api::decode(const QJsonObject &object, Client::Repository &repository) {
+    decode_record(object, repository);
+}
+
+void api::decode(const QJsonObject &object, Client::Code &code) {
+    decode_record(object, code);
+}
+
+void api::decode(const QJsonObject &object, Client::User &user) {
+    decode_record(object, user);
+}
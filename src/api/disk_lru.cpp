@@ -0,0 +1,96 @@
+#include <api/disk_lru.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <tuple>
+#include <vector>
+
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+using namespace api;
+using namespace std;
+
+DiskLru::DiskLru(const string &directory, size_t budget, const Filter &is_entry) :
+    directory_(directory), budget_(budget), bytes_(0), clock_(0), evictions_(0) {
+    mkdir(directory_.c_str(), 0700);
+
+    // Pick up the files of previous runs, oldest first
+    vector<tuple<time_t, string, size_t>> found;
+    DIR *dir = opendir(directory_.c_str());
+    if (!dir) {
+        return;
+    }
+    while (dirent *entry = readdir(dir)) {
+        struct stat st;
+        if (!is_entry(entry->d_name) || stat(path(entry->d_name).c_str(), &st) != 0) {
+            continue;
+        }
+        found.emplace_back(st.st_mtime, entry->d_name, st.st_size);
+    }
+    closedir(dir);
+    sort(found.begin(), found.end());
+
+    for (const auto &file : found) {
+        insert(get<1>(file), get<2>(file), get<0>(file));
+    }
+    evict();
+}
+
+const string &DiskLru::directory() const {
+    return directory_;
+}
+
+string DiskLru::path(const string &name) const {
+    return directory_ + "/" + name;
+}
+
+DiskLru::File *DiskLru::use(const string &name) {
+    auto it = files_.find(name);
+    if (it == files_.end()) {
+        return nullptr;
+    }
+    order_.erase(it->second.used);
+    it->second.used = ++clock_;
+    order_[it->second.used] = name;
+    return &it->second.file;
+}
+
+bool DiskLru::stored(const string &name) {
+    struct stat st;
+    if (stat(path(name).c_str(), &st) != 0) {
+        return false;
+    }
+    insert(name, st.st_size, st.st_mtime);
+    evict();
+    return true;
+}
+
+uint64_t DiskLru::evictions() const {
+    return evictions_;
+}
+
+void DiskLru::insert(const string &name, size_t size, time_t modified) {
+    auto it = files_.find(name);
+    if (it != files_.end()) {
+        bytes_ -= it->second.file.size;
+        order_.erase(it->second.used);
+    }
+    Entry &entry = files_[name];
+    entry.file = File { size, modified };
+    entry.used = ++clock_;
+    order_[entry.used] = name;
+    bytes_ += size;
+}
+
+void DiskLru::evict() {
+    while (bytes_ > budget_ && !order_.empty()) {
+        auto oldest = files_.find(order_.begin()->second);
+        remove(path(oldest->first).c_str());
+        bytes_ -= oldest->second.file.size;
+        order_.erase(order_.begin());
+        files_.erase(oldest);
+        ++evictions_;
+    }
+}
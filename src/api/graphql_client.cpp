@@ -0,0 +1,296 @@
+#include <api/decoder.h>
+#include <api/graphql_client.h>
+#include <api/metrics.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include <QByteArray>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonParseError>
+#include <QJsonValue>
+#include <QString>
+
+using namespace api;
+using namespace std;
+
+namespace {
+
+/**
+ * The repository fields the scope shows. Aliases give them their REST
+ * names, so the records are decoded by the same field tables; the few
+ * nested ones are picked up afterwards.
+ */
+const char *const REPOSITORY_FIELDS = R"(
+    name
+    full_name: nameWithOwner
+    description
+    private: isPrivate
+    fork: isFork
+    html_url: url
+    forks_count: forkCount
+    stargazers_count: stargazerCount
+    created_at: createdAt
+    pushed_at: pushedAt
+    primaryLanguage { name }
+    watchers { totalCount }
+    issues(states: OPEN) { totalCount }
+    owner {
+        login
+        avatar_url: avatarUrl
+        html_url: url
+        ... on User { id: databaseId }
+        ... on Organization { id: databaseId }
+    }
+)";
+
+/**
+ * The user fields the scope shows, under their REST names as well
+ */
+const char *const USER_FIELDS = R"(
+    id: databaseId
+    login
+    avatar_url: avatarUrl
+    html_url: url
+    name
+    company
+    blog: websiteUrl
+    location
+    email
+    hireable: isHireable
+    bio
+    followers { totalCount }
+    following { totalCount }
+    repositories(privacy: PUBLIC) { totalCount }
+    gists(privacy: PUBLIC) { totalCount }
+)";
+
+/**
+ * GraphQL pages are limited to 100 nodes
+ */
+const size_t MAX_PAGE = 100;
+
+/**
+ * The number of languages shown in a preview
+ */
+const size_t TOP_LANGUAGES = 10;
+
+/**
+ * The "data" object of a response
+ */
+QJsonObject data_of(const string &body, const Config &config) {
+    QJsonParseError error;
+    QJsonObject response = QJsonDocument::fromJson(
+                QByteArray(body.data(), body.size()), &error).object();
+    if (error.error != QJsonParseError::NoError && !body.empty() && config.metrics) {
+        config.metrics->add(Metrics::Counter::parse_errors);
+    }
+
+    // GraphQL reports errors with a 200 status
+    QJsonArray errors = response.value(QLatin1String("errors")).toArray();
+    if (!errors.isEmpty() && response.value(QLatin1String("data")).toObject().isEmpty()) {
+        throw domain_error(errors.first().toObject().value(QLatin1String("message"))
+                           .toString().toStdString());
+    }
+    return response.value(QLatin1String("data")).toObject();
+}
+
+string payload(const string &query, const QJsonObject &variables) {
+    QJsonObject request;
+    request.insert(QLatin1String("query"), QString::fromStdString(query));
+    request.insert(QLatin1String("variables"), variables);
+    QByteArray json = QJsonDocument(request).toJson(QJsonDocument::Compact);
+    return string(json.constData(), json.size());
+}
+
+unsigned int total_count(const QJsonObject &object, const char *key) {
+    return static_cast<unsigned int>(object.value(QLatin1String(key)).toObject()
+                                     .value(QLatin1String("totalCount")).toDouble());
+}
+
+void decode_repository(const QJsonObject &node, Client::Repository &repository) {
+    decode(node, repository);
+    repository.language = node.value(QLatin1String("primaryLanguage")).toObject()
+            .value(QLatin1String("name")).toString().toStdString();
+    repository.watchers_count = total_count(node, "watchers");
+    repository.open_issues_count = total_count(node, "issues");
+}
+
+void decode_user(const QJsonObject &node, Client::User &user) {
+    decode(node, user);
+    user.followers = total_count(node, "followers");
+    user.following = total_count(node, "following");
+    user.public_repos = total_count(node, "repositories");
+    user.public_gists = total_count(node, "gists");
+}
+
+}
+
+GraphQLClient::GraphQLClient(Config::Ptr config) :
+    Client(config) {
+}
+
+bool GraphQLClient::searches_return_profiles() const {
+    return true;
+}
+
+Client::UserRes GraphQLClient::fetch_users(const string &query,
+                                           const CancellationToken &token,
+                                           const UserHandler &on_user) {
+    // Same page size as the REST search
+    QJsonObject variables;
+    variables.insert(QLatin1String("q"), QString::fromStdString(query));
+    variables.insert(QLatin1String("first"), 30);
+
+    QJsonObject search = data_of(post(
+    { "graphql" },
+                                     payload(string("query($q: String!, $first: Int!) {"
+                                                    " search(query: $q, type: USER, first: $first) {"
+                                                    " userCount nodes { ... on User {")
+                                             + USER_FIELDS + "} } } }", variables),
+                                     token), *config_).value(QLatin1String("search")).toObject();
+
+    UserRes result;
+    result.total_count = static_cast<int>(search.value(QLatin1String("userCount")).toDouble());
+    for (const QJsonValue &node : search.value(QLatin1String("nodes")).toArray()) {
+        if (token.cancelled()) {
+            break;
+        }
+
+        // Organizations match too, but come back without any field
+        QJsonObject object = node.toObject();
+        if (object.isEmpty()) {
+            continue;
+        }
+        result.users.emplace_back();
+        decode_user(object, result.users.back());
+        if (on_user) {
+            on_user(result.users.back());
+        }
+    }
+    return result;
+}
+
+Client::RepositoryRes GraphQLClient::fetch_repositories(const string &query,
+                                                        bool name, bool description, bool readme,
+                                                        size_t limit,
+                                                        const CancellationToken &token,
+                                                        const RepositoryHandler &on_repository) {
+    string in = " in:";
+    if(name) in += "name,";
+    if(description) in += "description,";
+    if(readme) in += "readme,";
+    in = in.substr(0, in.size()-1);
+
+    const string search_query = string("query($q: String!, $first: Int!, $after: String) {"
+                                       " search(query: $q, type: REPOSITORY, first: $first, after: $after) {"
+                                       " repositoryCount pageInfo { hasNextPage endCursor }"
+                                       " nodes { ... on Repository {")
+            + REPOSITORY_FIELDS + "} } } }";
+
+    // Cursors can only be followed one page after the other, but most
+    // searches fit in the first one
+    RepositoryRes result;
+    result.total_count = 0;
+    QJsonValue after;
+    while (result.repositories.size() < max<size_t>(limit, 1) && !token.cancelled()) {
+        QJsonObject variables;
+        variables.insert(QLatin1String("q"), QString::fromStdString(query + in));
+        variables.insert(QLatin1String("first"), static_cast<int>(
+                             min(max<size_t>(limit, 1) - result.repositories.size(), MAX_PAGE)));
+        variables.insert(QLatin1String("after"), after);
+
+        QJsonObject search = data_of(post({ "graphql" }, payload(search_query, variables), token), *config_)
+                .value(QLatin1String("search")).toObject();
+        QJsonArray nodes = search.value(QLatin1String("nodes")).toArray();
+        if (nodes.isEmpty()) {
+            break;
+        }
+        for (const QJsonValue &node : nodes) {
+            if (token.cancelled()) {
+                break;
+            }
+            result.repositories.emplace_back();
+            decode_repository(node.toObject(), result.repositories.back());
+            if (on_repository) {
+                on_repository(result.repositories.back());
+            }
+        }
+
+        // Only report a count for complete results, like the REST search
+        QJsonObject page_info = search.value(QLatin1String("pageInfo")).toObject();
+        result.total_count = static_cast<unsigned int>(
+                    search.value(QLatin1String("repositoryCount")).toDouble());
+        if (!page_info.value(QLatin1String("hasNextPage")).toBool()) {
+            break;
+        }
+        after = page_info.value(QLatin1String("endCursor"));
+    }
+    if (token.cancelled()) {
+        result.total_count = 0;
+    }
+    return result;
+}
+
+Client::User GraphQLClient::fetch_user(const string &login,
+                                       const CancellationToken &token) {
+    QJsonObject variables;
+    variables.insert(QLatin1String("login"), QString::fromStdString(login));
+
+    QJsonObject user = data_of(post(
+    { "graphql" },
+                                   payload(string("query($login: String!) { user(login: $login) {")
+                                           + USER_FIELDS + "} }", variables),
+                                   token), *config_).value(QLatin1String("user")).toObject();
+
+    User result;
+    decode_user(user, result);
+    return result;
+}
+
+Client::Details GraphQLClient::fetch_details(const string &full_name,
+                                             const CancellationToken &token,
+                                             const DetailsHandler &on_part) {
+    size_t slash = full_name.find('/');
+    QJsonObject variables;
+    variables.insert(QLatin1String("owner"), QString::fromStdString(full_name.substr(0, slash)));
+    variables.insert(QLatin1String("name"), QString::fromStdString(
+                         slash == string::npos ? string() : full_name.substr(slash + 1)));
+    variables.insert(QLatin1String("languages"), static_cast<int>(TOP_LANGUAGES));
+
+    // The README, languages and release in one request, the contributors
+    // from the REST API alongside it
+    return fetch_parts({
+        [&]() {
+            QJsonObject repository = data_of(post(
+            { "graphql" },
+                                                 payload("query($owner: String!, $name: String!, $languages: Int!) {"
+                                                         " repository(owner: $owner, name: $name) {"
+                                                         " readme: object(expression: \"HEAD:README.md\") { ... on Blob { text } }"
+                                                         " languages(first: $languages, orderBy: { field: SIZE, direction: DESC }) {"
+                                                         " edges { size node { name } } }"
+                                                         " latestRelease { tagName } } }", variables),
+                                                 token), *config_).value(QLatin1String("repository")).toObject();
+
+            Details part;
+            part.readme = readme_excerpt(repository.value(QLatin1String("readme")).toObject()
+                                         .value(QLatin1String("text")).toString().toStdString());
+            for (const QJsonValue &edge : repository.value(QLatin1String("languages")).toObject()
+                 .value(QLatin1String("edges")).toArray()) {
+                QJsonObject object = edge.toObject();
+                part.languages.emplace_back(
+                            object.value(QLatin1String("node")).toObject()
+                            .value(QLatin1String("name")).toString().toStdString(),
+                            static_cast<unsigned int>(object.value(QLatin1String("size")).toDouble()));
+            }
+            part.latest_release = repository.value(QLatin1String("latestRelease")).toObject()
+                    .value(QLatin1String("tagName")).toString().toStdString();
+            return part;
+        },
+        [&]() {
+            return fetch_contributors(full_name, token);
+        }
+    }, token, on_part);
+}
@@ -0,0 +1,164 @@
+#include <api/inflater.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <stdexcept>
+
+using namespace api;
+using namespace std;
+
+namespace {
+
+/**
+ * The size of the blocks handed out, about what curl delivers at a time
+ */
+const size_t BLOCK_SIZE = 16 * 1024;
+
+bool is_gzip(const string &head) {
+    return static_cast<unsigned char>(head[0]) == 0x1f
+            && static_cast<unsigned char>(head[1]) == 0x8b;
+}
+
+bool is_zlib(const string &head) {
+    // Deflate with a 32K window, and a valid header checksum
+    unsigned int cmf = static_cast<unsigned char>(head[0]);
+    unsigned int flg = static_cast<unsigned char>(head[1]);
+    return cmf == 0x78 && ((cmf << 8) | flg) % 31 == 0;
+}
+
+/**
+ * A Content-Encoding value, trimmed and in lower case
+ */
+string normalised(const string &encoding) {
+    size_t begin = encoding.find_first_not_of(" \t");
+    size_t end = encoding.find_last_not_of(" \t");
+    string result = begin == string::npos ? string() : encoding.substr(begin, end - begin + 1);
+    transform(result.begin(), result.end(), result.begin(),
+              [](unsigned char c) { return tolower(c); });
+    return result;
+}
+
+bool is_text(const string &head) {
+    // What JSON and HTML bodies start with
+    char c = head[0];
+    return c == '{' || c == '[' || c == '"' || c == '<' || c == ' ' || c == '\t'
+            || c == '\r' || c == '\n';
+}
+
+}
+
+Inflater::Inflater(const DataHandler &on_data) :
+    on_data_(on_data), mode_(Mode::unknown), finished_(false),
+    buffer_(BLOCK_SIZE, '\0') {
+    memset(&stream_, 0, sizeof(stream_));
+}
+
+Inflater::~Inflater() {
+    if (mode_ == Mode::inflate) {
+        inflateEnd(&stream_);
+    }
+}
+
+void Inflater::feed(const string &chunk) {
+    switch (mode_) {
+    case Mode::unknown:
+        start(chunk);
+        break;
+    case Mode::identity:
+        on_data_(chunk);
+        break;
+    case Mode::inflate:
+        inflate(chunk.data(), chunk.size());
+        break;
+    case Mode::deferred:
+        head_ += chunk;
+        break;
+    }
+}
+
+void Inflater::finish(const string &content_encoding) {
+    if (mode_ == Mode::unknown || mode_ == Mode::deferred) {
+        decide(content_encoding);
+    }
+    if (mode_ == Mode::inflate && !finished_) {
+        throw domain_error("Truncated compressed response");
+    }
+}
+
+bool Inflater::compressed() const {
+    return mode_ == Mode::inflate;
+}
+
+void Inflater::start(const string &chunk) {
+    head_ += chunk;
+    if (head_.size() < 2) {
+        return;
+    }
+    recognise();
+}
+
+void Inflater::recognise() {
+    if (is_text(head_)) {
+        mode_ = Mode::identity;
+        on_data_(head_);
+    } else if (is_gzip(head_) || is_zlib(head_)) {
+        // 32 lets zlib tell gzip and zlib headers apart by itself
+        begin_inflate(15 + 32);
+    } else {
+        mode_ = Mode::deferred;
+        return;
+    }
+    string().swap(head_);
+}
+
+void Inflater::decide(const string &content_encoding) {
+    // Such as a 304, which may still name the encoding of what it stands for
+    string encoding = head_.empty() ? string() : normalised(content_encoding);
+    if (encoding == "gzip" || encoding == "x-gzip") {
+        begin_inflate(15 + 32);
+    } else if (encoding == "deflate") {
+        // Meant to be zlib, but a negative size is for servers sending
+        // a raw stream with no header at all
+        begin_inflate(head_.size() >= 2 && is_zlib(head_) ? 15 + 32 : -15);
+    } else {
+        mode_ = Mode::identity;
+        if (!head_.empty()) {
+            on_data_(head_);
+        }
+    }
+    string().swap(head_);
+}
+
+void Inflater::begin_inflate(int window_bits) {
+    if (inflateInit2(&stream_, window_bits) != Z_OK) {
+        throw domain_error("Could not set up decompression");
+    }
+    mode_ = Mode::inflate;
+    inflate(head_.data(), head_.size());
+}
+
+void Inflater::inflate(const char *data, size_t size) {
+    stream_.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    stream_.avail_in = size;
+
+    // Keep going while there is input, or while the last block came out
+    // full and zlib may be holding back more output
+    do {
+        stream_.next_out = reinterpret_cast<Bytef *>(&buffer_[0]);
+        stream_.avail_out = buffer_.size();
+
+        int result = ::inflate(&stream_, Z_NO_FLUSH);
+        if (result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR) {
+            throw domain_error(stream_.msg ? stream_.msg : "Corrupt compressed response");
+        }
+        finished_ = result == Z_STREAM_END;
+
+        size_t produced = buffer_.size() - stream_.avail_out;
+        if (produced == 0) {
+            break;
+        }
+        block_.assign(buffer_.data(), produced);
+        on_data_(block_);
+    } while (!finished_ && (stream_.avail_in > 0 || stream_.avail_out == 0));
+}
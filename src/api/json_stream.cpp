@@ -0,0 +1,135 @@
+#include <api/json_stream.h>
+
+#include <cctype>
+
+#include <QByteArray>
+#include <QJsonDocument>
+
+using namespace api;
+using namespace std;
+
+namespace {
+
+string unquote(const string &token) {
+    if (token.size() >= 2 && token.front() == '"' && token.back() == '"') {
+        return token.substr(1, token.size() - 2);
+    }
+    return token;
+}
+
+}
+
+JsonStream::JsonStream(const ItemHandler &on_item) :
+    on_item_(on_item) {
+}
+
+void JsonStream::feed(const char *data, size_t size) {
+    for (size_t i = 0; i < size; ++i) {
+        char c = data[i];
+
+        // Everything inside an element of "items" is kept verbatim
+        if (in_items_ && depth_ >= 3) {
+            item_ += c;
+        }
+
+        if (in_string_) {
+            if (escaped_) {
+                escaped_ = false;
+            } else if (c == '\\') {
+                escaped_ = true;
+            } else if (c == '"') {
+                in_string_ = false;
+            }
+            if (depth_ == 1) {
+                token_ += c;
+            }
+            continue;
+        }
+
+        switch (c) {
+        case '"':
+            in_string_ = true;
+            if (depth_ == 1) {
+                token_ += c;
+            }
+            break;
+        case '{':
+        case '[':
+            if (depth_ == 1) {
+                // A container value at the top level: only "items" matters
+                in_items_ = (c == '[' && key_ == "items");
+                token_.clear();
+            } else if (depth_ == 2 && in_items_ && c == '{') {
+                item_.assign(1, c);
+            }
+            ++depth_;
+            break;
+        case '}':
+        case ']':
+            --depth_;
+            if (depth_ == 2 && in_items_ && c == '}') {
+                // An element just closed, hand it out right away
+                QJsonDocument item = QJsonDocument::fromJson(
+                            QByteArray(item_.data(), item_.size()));
+                item_.clear();
+                if (item.isObject()) {
+                    on_item_(item.object());
+                } else {
+                    ++errors_;
+                }
+            } else if (depth_ == 1 && c == ']') {
+                in_items_ = false;
+            } else if (depth_ == 0) {
+                if (after_colon_ && !token_.empty()) {
+                    fields_[key_] = token_;
+                }
+                token_.clear();
+                complete_ = true;
+            }
+            break;
+        case ':':
+            if (depth_ == 1) {
+                key_ = unquote(token_);
+                token_.clear();
+                after_colon_ = true;
+            }
+            break;
+        case ',':
+            if (depth_ == 1) {
+                if (after_colon_ && !token_.empty()) {
+                    fields_[key_] = token_;
+                }
+                token_.clear();
+                after_colon_ = false;
+            }
+            break;
+        default:
+            if (depth_ == 1 && !isspace(static_cast<unsigned char>(c))) {
+                token_ += c;
+            }
+            break;
+        }
+    }
+}
+
+void JsonStream::reset() {
+    depth_ = 0;
+    in_string_ = false;
+    escaped_ = false;
+    complete_ = false;
+    token_.clear();
+    key_.clear();
+    after_colon_ = false;
+    in_items_ = false;
+    item_.clear();
+    fields_.clear();
+}
+
+bool JsonStream::complete() const {
+    return complete_;
+}
+
+string JsonStream::field(const string &key) const {
+    auto it = fields_.find(key);
+    return it == fields_.end() ? string() : it->second;
+}
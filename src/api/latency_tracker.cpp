@@ -0,0 +1,56 @@
+#include <api/latency_tracker.h>
+
+#include <algorithm>
+
+using namespace api;
+using namespace std;
+
+LatencyTracker::LatencyTracker(size_t capacity, size_t min_samples) :
+    min_samples_(min_samples), next_(0), recorded_(0), hedges_(0),
+    hedge_wins_(0), retries_(0) {
+    samples_.reserve(capacity);
+}
+
+void LatencyTracker::record(Duration latency) {
+    lock_guard<mutex> lock(mutex_);
+    if (samples_.size() < samples_.capacity()) {
+        samples_.push_back(latency);
+    } else {
+        // Overwrite the oldest sample
+        samples_[next_] = latency;
+        next_ = (next_ + 1) % samples_.size();
+    }
+    ++recorded_;
+}
+
+LatencyTracker::Duration LatencyTracker::percentile(double p) const {
+    vector<Duration> sorted;
+    {
+        lock_guard<mutex> lock(mutex_);
+        if (samples_.empty() || samples_.size() < min_samples_) {
+            return Duration::zero();
+        }
+        sorted = samples_;
+    }
+
+    size_t rank = min(sorted.size() - 1,
+                      static_cast<size_t>(max(0.0, min(p, 1.0)) * sorted.size()));
+    nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+    return sorted[rank];
+}
+
+void LatencyTracker::hedged() {
+    ++hedges_;
+}
+
+void LatencyTracker::hedge_won() {
+    ++hedge_wins_;
+}
+
+void LatencyTracker::retried() {
+    ++retries_;
+}
+
+LatencyTracker::Stats LatencyTracker::stats() const {
+    return Stats { recorded_, hedges_, hedge_wins_, retries_ };
+}
@@ -0,0 +1,209 @@
+#include <api/metrics.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+
+using namespace api;
+using namespace std;
+
+namespace {
+
+const char *const ENDPOINT_NAMES[] = {
+    "search/repositories",
+    "search/code",
+    "search/users",
+    "users",
+    "repos",
+    "graphql",
+    "other"
+};
+
+const char *const COUNTER_NAMES[] = {
+    "bytes_fetched",
+    "result_cache_hits",
+    "result_cache_misses",
+    "response_cache_hits",
+    "stale_responses",
+    "cancellations",
+    "rate_limit_stalls",
+    "parse_errors"
+};
+
+/**
+ * The number of significant bits of a value
+ */
+size_t bits(uint64_t value) {
+    size_t result = 0;
+    while (value) {
+        ++result;
+        value >>= 1;
+    }
+    return result;
+}
+
+void write_summary(ostream &out, const char *name, const Metrics::Histogram &histogram) {
+    Metrics::Histogram::Summary summary = histogram.summary();
+    out << "    \"" << name << "\": {\"count\": " << summary.count
+        << ", \"p50_us\": " << summary.p50 << ", \"p90_us\": " << summary.p90
+        << ", \"p99_us\": " << summary.p99 << ", \"max_us\": " << summary.max << "}";
+}
+
+}
+
+Metrics::Histogram::Histogram() :
+    max_(0) {
+    for (auto &bucket : buckets_) {
+        bucket = 0;
+    }
+}
+
+size_t Metrics::Histogram::index(uint64_t value) {
+    // Below 16 every value has a bucket of its own, above the top 5 bits
+    // of the value pick it
+    value = min<uint64_t>(value, (uint64_t(1) << MAX_BITS) - 1);
+    if (value < SUB_BUCKETS) {
+        return value;
+    }
+    size_t shift = bits(value) - 5;
+    return SUB_BUCKETS * (shift + 1) + (value >> shift) - SUB_BUCKETS;
+}
+
+uint64_t Metrics::Histogram::upper_bound(size_t index) {
+    if (index < SUB_BUCKETS) {
+        return index;
+    }
+    size_t shift = index / SUB_BUCKETS - 1;
+    uint64_t sub = index % SUB_BUCKETS + SUB_BUCKETS;
+    return ((sub + 1) << shift) - 1;
+}
+
+void Metrics::Histogram::record(Clock::duration latency) {
+    uint64_t value = max<int64_t>(
+                chrono::duration_cast<chrono::microseconds>(latency).count(), 0);
+    buckets_[index(value)].fetch_add(1, memory_order_relaxed);
+
+    uint64_t seen = max_.load(memory_order_relaxed);
+    while (value > seen && !max_.compare_exchange_weak(seen, value, memory_order_relaxed)) {
+    }
+}
+
+Metrics::Histogram::Summary Metrics::Histogram::summary() const {
+    // Buckets keep being written to, so take a copy to walk consistently
+    uint64_t counts[BUCKETS];
+    Summary result { 0, 0, 0, 0, max_.load(memory_order_relaxed) };
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        counts[i] = buckets_[i].load(memory_order_relaxed);
+        result.count += counts[i];
+    }
+
+    auto percentile = [&](double p) -> uint64_t {
+        uint64_t rank = max<uint64_t>(1, static_cast<uint64_t>(p * result.count + 0.5));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKETS; ++i) {
+            seen += counts[i];
+            if (seen >= rank) {
+                return min(upper_bound(i), result.max);
+            }
+        }
+        return result.max;
+    };
+    if (result.count > 0) {
+        result.p50 = percentile(0.5);
+        result.p90 = percentile(0.9);
+        result.p99 = percentile(0.99);
+    }
+    return result;
+}
+
+Metrics::Timer::Timer(Histogram *histogram) :
+    histogram_(histogram) {
+    if (histogram_) {
+        begin_ = Clock::now();
+    }
+}
+
+Metrics::Timer::~Timer() {
+    if (histogram_) {
+        histogram_->record(Clock::now() - begin_);
+    }
+}
+
+void Metrics::Timer::dismiss() {
+    histogram_ = nullptr;
+}
+
+Metrics::Metrics() :
+    started_(Clock::now()) {
+    for (auto &counter : counters_) {
+        counter = 0;
+    }
+}
+
+Metrics::Endpoint Metrics::endpoint(const vector<string> &path) {
+    const string first = path.empty() ? string() : path[0];
+    const string second = path.size() < 2 ? string() : path[1];
+    if (first == "search") {
+        if (second == "repositories") {
+            return Endpoint::search_repositories;
+        }
+        if (second == "code") {
+            return Endpoint::search_code;
+        }
+        if (second == "users") {
+            return Endpoint::search_users;
+        }
+    } else if (first == "users") {
+        return Endpoint::users;
+    } else if (first == "repos") {
+        return Endpoint::repos;
+    } else if (first == "graphql") {
+        return Endpoint::graphql;
+    }
+    return Endpoint::other;
+}
+
+Metrics::Histogram &Metrics::latency(Endpoint endpoint) {
+    return endpoints_[static_cast<size_t>(endpoint)];
+}
+
+void Metrics::add(Counter counter, uint64_t amount) {
+    counters_[static_cast<size_t>(counter)].fetch_add(amount, memory_order_relaxed);
+}
+
+uint64_t Metrics::value(Counter counter) const {
+    return counters_[static_cast<size_t>(counter)].load(memory_order_relaxed);
+}
+
+bool Metrics::write(const string &path) const {
+    // Write next to the final file, so readers never see half of it
+    string temporary = path + ".tmp";
+    {
+        ofstream out(temporary, ios::out | ios::trunc);
+        out << "{\n  \"uptime_s\": "
+            << chrono::duration_cast<chrono::seconds>(Clock::now() - started_).count()
+            << ",\n  \"latency\": {\n";
+        for (size_t i = 0; i < ENDPOINTS; ++i) {
+            write_summary(out, ENDPOINT_NAMES[i], endpoints_[i]);
+            out << ",\n";
+        }
+        write_summary(out, "query", query);
+        out << ",\n";
+        write_summary(out, "preview", preview);
+        out << "\n  },\n  \"counters\": {\n";
+        for (size_t i = 0; i < COUNTERS; ++i) {
+            out << "    \"" << COUNTER_NAMES[i] << "\": "
+                << counters_[i].load(memory_order_relaxed) << (i + 1 < COUNTERS ? ",\n" : "\n");
+        }
+        out << "  }\n}\n";
+        if (!out.flush()) {
+            remove(temporary.c_str());
+            return false;
+        }
+    }
+    if (rename(temporary.c_str(), path.c_str()) != 0) {
+        remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
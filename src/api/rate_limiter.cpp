@@ -0,0 +1,133 @@
+#include <api/rate_limiter.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <thread>
+
+using namespace api;
+using namespace std;
+
+namespace {
+
+/**
+ * The share of each budget that background work may never use
+ */
+const double BACKGROUND_RESERVE = 0.3;
+
+}
+
+RateLimiter::RateLimiter(double search_per_minute, double core_per_hour,
+                         chrono::milliseconds max_wait) :
+    max_wait_(max_wait), granted_(0), waited_(0), dropped_(0), exhausted_(0) {
+    Clock::time_point now = Clock::now();
+    search_ = Bucket { search_per_minute, search_per_minute,
+                       search_per_minute / 60.0, now, now, Clock::time_point() };
+    core_ = Bucket { core_per_hour, core_per_hour,
+                     core_per_hour / 3600.0, now, now, Clock::time_point() };
+}
+
+RateLimiter::Endpoint RateLimiter::endpoint(const string &first_path_segment) {
+    return first_path_segment == "search" ? Endpoint::search : Endpoint::core;
+}
+
+RateLimiter::Bucket &RateLimiter::bucket(Endpoint endpoint) {
+    return endpoint == Endpoint::search ? search_ : core_;
+}
+
+void RateLimiter::refill(Bucket &bucket, Clock::time_point now) {
+    chrono::duration<double> elapsed = now - bucket.refilled;
+    bucket.tokens = min(bucket.capacity, bucket.tokens + elapsed.count() * bucket.per_second);
+    bucket.refilled = now;
+
+    // The window the server told us about is over, and so is the shortage
+    if (bucket.resets != Clock::time_point() && now >= bucket.resets) {
+        bucket.tokens = bucket.capacity;
+        bucket.resets = Clock::time_point();
+    }
+}
+
+bool RateLimiter::acquire(Endpoint endpoint, Priority priority,
+                          const CancellationToken &token) {
+    Clock::time_point deadline = Clock::now() + max_wait_;
+    bool waited = false;
+
+    while (!token.cancelled()) {
+        Clock::duration wait;
+        {
+            lock_guard<mutex> lock(mutex_);
+            Bucket &b = bucket(endpoint);
+            Clock::time_point now = Clock::now();
+            refill(b, now);
+
+            double needed = 1.0;
+            if (priority == Priority::background) {
+                needed += max(1.0, b.capacity * BACKGROUND_RESERVE);
+            }
+
+            if (now >= b.blocked_until && b.tokens >= needed) {
+                b.tokens -= 1.0;
+                if (waited) {
+                    ++waited_;
+                } else {
+                    ++granted_;
+                }
+                return true;
+            }
+
+            if (priority == Priority::background) {
+                ++dropped_;
+                return false;
+            }
+
+            // How long until the next token, or until the server lets us in
+            if (now < b.blocked_until) {
+                wait = b.blocked_until - now;
+            } else {
+                wait = chrono::duration_cast<Clock::duration>(
+                            chrono::duration<double>((needed - b.tokens) / b.per_second));
+            }
+            if (now + wait > deadline) {
+                ++exhausted_;
+                return false;
+            }
+        }
+
+        // Sleep in short steps, so a cancelled query doesn't hang around
+        waited = true;
+        this_thread::sleep_for(min<Clock::duration>(wait, chrono::milliseconds(50)));
+    }
+    return false;
+}
+
+void RateLimiter::update(Endpoint endpoint, const string &remaining,
+                         const string &reset, const string &retry_after) {
+    lock_guard<mutex> lock(mutex_);
+    Bucket &b = bucket(endpoint);
+    Clock::time_point now = Clock::now();
+    refill(b, now);
+
+    // The server knows better than our estimate
+    if (!remaining.empty()) {
+        b.tokens = min(b.tokens, strtod(remaining.c_str(), nullptr));
+    }
+
+    if (!remaining.empty() && strtol(remaining.c_str(), nullptr, 10) == 0
+            && !reset.empty()) {
+        chrono::system_clock::time_point reset_at(
+                    chrono::seconds(strtoll(reset.c_str(), nullptr, 10)));
+        auto until_reset = reset_at - chrono::system_clock::now();
+        if (until_reset > chrono::system_clock::duration::zero()) {
+            b.resets = now + chrono::duration_cast<Clock::duration>(until_reset);
+            b.blocked_until = max(b.blocked_until, b.resets);
+        }
+    }
+
+    if (!retry_after.empty()) {
+        b.blocked_until = max(b.blocked_until,
+                              now + chrono::seconds(strtol(retry_after.c_str(), nullptr, 10)));
+    }
+}
+
+RateLimiter::Stats RateLimiter::stats() const {
+    return Stats { granted_, waited_, dropped_, exhausted_ };
+}
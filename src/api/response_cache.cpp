@@ -0,0 +1,127 @@
+#include <api/response_cache.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+
+using namespace api;
+using namespace std;
+
+namespace {
+
+/**
+ * 64-bit FNV-1a, stable across runs so it can name files on disk
+ */
+uint64_t fnv1a(const string &s) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : s) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+/**
+ * Entries are named after the hash of their key
+ */
+string file_name(const string &key) {
+    ostringstream oss;
+    oss << hex << setw(16) << setfill('0') << fnv1a(key);
+    return oss.str();
+}
+
+/**
+ * Anything else in the directory is a temporary file
+ */
+bool is_entry(const string &name) {
+    return name.size() == 16 && name.find_first_not_of("0123456789abcdef") == string::npos;
+}
+
+}
+
+ResponseCache::ResponseCache(const string &directory, size_t budget) :
+    files_(directory, budget, is_entry), hits_(0), misses_(0), revalidations_(0),
+    bytes_saved_(0), stale_(0) {
+}
+
+string ResponseCache::key(const string &apiroot,
+                          const core::net::Uri::Path &path,
+                          const core::net::Uri::QueryParameters &parameters) {
+    core::net::Uri::QueryParameters sorted(parameters);
+    sort(sorted.begin(), sorted.end());
+
+    string result = apiroot;
+    for (const string &segment : path) {
+        result += "/" + segment;
+    }
+    char separator = '?';
+    for (const auto &parameter : sorted) {
+        result += separator + parameter.first + "=" + parameter.second;
+        separator = '&';
+    }
+    return result;
+}
+
+bool ResponseCache::find(const string &key, Entry &entry) {
+    string name = file_name(key);
+    ifstream in(files_.path(name), ios::binary);
+
+    // The first line holds the key itself, to rule out hash collisions
+    string stored_key;
+    if (!in || !getline(in, stored_key) || stored_key != key
+            || !getline(in, entry.etag) || !getline(in, entry.last_modified)) {
+        ++misses_;
+        return false;
+    }
+
+    entry.body.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+
+    lock_guard<mutex> lock(mutex_);
+    files_.use(name);
+    return true;
+}
+
+void ResponseCache::store(const string &key, const Entry &entry) {
+    string name = file_name(key);
+    string target = files_.path(name);
+
+    // Write to a private file first, so readers never see a partial entry
+    ostringstream tmp;
+    tmp << target << ".tmp." << this_thread::get_id();
+    {
+        ofstream out(tmp.str(), ios::binary | ios::trunc);
+        out << key << '\n' << entry.etag << '\n' << entry.last_modified << '\n'
+            << entry.body;
+        if (!out) {
+            remove(tmp.str().c_str());
+            return;
+        }
+    }
+    if (rename(tmp.str().c_str(), target.c_str()) != 0) {
+        remove(tmp.str().c_str());
+        return;
+    }
+
+    lock_guard<mutex> lock(mutex_);
+    files_.stored(name);
+}
+
+void ResponseCache::revalidated() {
+    ++revalidations_;
+}
+
+void ResponseCache::hit(size_t bytes) {
+    ++hits_;
+    bytes_saved_ += bytes;
+}
+
+void ResponseCache::served_stale() {
+    ++stale_;
+}
+
+ResponseCache::Stats ResponseCache::stats() const {
+    return Stats { hits_, misses_, revalidations_, bytes_saved_, stale_, files_.evictions() };
+}
@@ -0,0 +1,172 @@
+#include <api/tracer.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+
+using namespace api;
+using namespace std;
+
+namespace {
+
+/**
+ * Tells tracers apart in the thread-local cache, even at the same address
+ */
+atomic<uint64_t> next_id(1);
+
+int64_t microseconds(Tracer::Clock::duration duration) {
+    return chrono::duration_cast<chrono::microseconds>(duration).count();
+}
+
+void write_escaped(ostream &out, const string &value) {
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out << escaped;
+        } else {
+            out << c;
+        }
+    }
+}
+
+}
+
+Tracer::Span::Span(const Ptr &tracer, const char *name) :
+    tracer_(tracer.get()), name_(name) {
+    if (tracer_) {
+        begin_ = Clock::now();
+    }
+}
+
+Tracer::Span::~Span() {
+    end();
+}
+
+void Tracer::Span::detail(const string &value) {
+    if (tracer_) {
+        detail_ = value;
+    }
+}
+
+void Tracer::Span::end() {
+    if (tracer_) {
+        tracer_->complete(name_, begin_, Clock::now(), detail_);
+        tracer_ = nullptr;
+    }
+}
+
+Tracer::Tracer(size_t capacity) :
+    capacity_(max<size_t>(capacity, 1)), id_(next_id++), epoch_(Clock::now()),
+    rings_(make_shared<Rings>()) {
+}
+
+void Tracer::complete(const char *name, Clock::time_point begin, Clock::time_point end,
+                      const string &detail) {
+    record(name, false, begin, end, detail);
+}
+
+void Tracer::instant(const char *name, const string &detail) {
+    auto now = Clock::now();
+    record(name, true, now, now, detail);
+}
+
+Tracer::Ring &Tracer::ring() {
+    // Gives the ring back when the thread exits, if the tracer is still there
+    struct Slot {
+        uint64_t tracer = 0;
+        weak_ptr<Rings> owner;
+        shared_ptr<Ring> ring;
+
+        ~Slot() {
+            release();
+        }
+
+        void release() {
+            auto rings = owner.lock();
+            if (rings && ring) {
+                lock_guard<mutex> lock(rings->mutex);
+                rings->free.push_back(ring);
+            }
+            ring.reset();
+        }
+    };
+    static thread_local Slot slot;
+
+    if (slot.tracer != id_) {
+        slot.release();
+
+        lock_guard<mutex> lock(rings_->mutex);
+        if (rings_->free.empty()) {
+            auto ring = make_shared<Ring>();
+            ring->events.resize(capacity_);
+            ring->thread = rings_->all.size() + 1;
+            rings_->all.push_back(ring);
+            slot.ring = ring;
+        } else {
+            slot.ring = rings_->free.back();
+            rings_->free.pop_back();
+        }
+        slot.tracer = id_;
+        slot.owner = rings_;
+    }
+    return *slot.ring;
+}
+
+void Tracer::record(const char *name, bool instant, Clock::time_point begin,
+                    Clock::time_point end, const string &detail) {
+    Ring &ring = this->ring();
+
+    // Only contended while the trace is being written
+    lock_guard<mutex> lock(ring.mutex);
+    Event &event = ring.events[ring.next];
+    event.name = name;
+    event.instant = instant;
+    event.begin = microseconds(begin - epoch_);
+    event.duration = microseconds(end - begin);
+    event.detail = detail;
+    ring.next = (ring.next + 1) % ring.events.size();
+    ring.count = min(ring.count + 1, ring.events.size());
+}
+
+bool Tracer::write(const string &path) const {
+    vector<shared_ptr<Ring>> rings;
+    {
+        lock_guard<mutex> lock(rings_->mutex);
+        rings = rings_->all;
+    }
+
+    ofstream out(path, ios::out | ios::trunc);
+    out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+    bool first = true;
+    for (const auto &ring : rings) {
+        lock_guard<mutex> lock(ring->mutex);
+
+        // Oldest first
+        size_t size = ring->events.size();
+        for (size_t i = 0; i < ring->count; ++i) {
+            const Event &event = ring->events[(ring->next + size - ring->count + i) % size];
+            out << (first ? "\n" : ",\n") << "{\"name\": \"";
+            write_escaped(out, event.name);
+            out << "\", \"cat\": \"scope\", \"pid\": 1, \"tid\": " << ring->thread
+                << ", \"ts\": " << event.begin;
+            if (event.instant) {
+                out << ", \"ph\": \"i\", \"s\": \"t\"";
+            } else {
+                out << ", \"ph\": \"X\", \"dur\": " << event.duration;
+            }
+            if (!event.detail.empty()) {
+                out << ", \"args\": {\"detail\": \"";
+                write_escaped(out, event.detail);
+                out << "\"}";
+            }
+            out << "}";
+            first = false;
+        }
+    }
+    out << "\n]}\n";
+    return static_cast<bool>(out.flush());
+}
@@ -0,0 +1,189 @@
+#include <scope/avatar_cache.h>
+
+#include <core/net/error.h>
+#include <core/net/http/client.h>
+#include <core/net/http/request.h>
+#include <core/net/http/response.h>
+#include <core/net/http/status.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+#include <QImage>
+#include <QImageReader>
+#include <QString>
+
+#include <sys/time.h>
+
+namespace http = core::net::http;
+namespace net = core::net;
+
+using namespace std;
+using namespace api;
+using namespace scope;
+
+namespace {
+
+/**
+ * Owners waiting for their avatar beyond this are dropped, they will be
+ * asked for again the next time they show up
+ */
+const size_t MAX_QUEUED = 256;
+
+/**
+ * The PNG text chunk holding the ETag an avatar was downloaded with
+ */
+const char *const ETAG_KEY = "ETag";
+
+string file_name(unsigned int id) {
+    return to_string(id) + ".png";
+}
+
+/**
+ * Avatars are named after their owner, anything else is a temporary file
+ */
+bool is_entry(const string &name) {
+    char *end = nullptr;
+    strtoul(name.c_str(), &end, 10);
+    return end != name.c_str() && string(end) == ".png";
+}
+
+}
+
+AvatarCache::AvatarCache(Config::Ptr config, const string &directory,
+                         size_t budget, int size, chrono::seconds max_age) :
+    config_(config), size_(size), max_age_(max_age),
+    files_(directory, budget, is_entry), stopping_(false), hits_(0), misses_(0),
+    downloads_(0), revalidations_(0) {
+    worker_ = thread(&AvatarCache::work, this);
+}
+
+AvatarCache::~AvatarCache() {
+    {
+        lock_guard<mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    worker_.join();
+}
+
+string AvatarCache::art(const Client::Owner &owner) {
+    if (owner.avatar_url.empty()) {
+        return owner.avatar_url;
+    }
+
+    lock_guard<mutex> lock(mutex_);
+    auto enqueue = [&]() {
+        if (queue_.size() < MAX_QUEUED && queued_.insert(owner.id).second) {
+            queue_.emplace_back(owner.id, owner.avatar_url);
+            wake_.notify_one();
+        }
+    };
+
+    string name = file_name(owner.id);
+    DiskLru::File *file = files_.use(name);
+    if (file) {
+        ++hits_;
+
+        // Ask at most once per max_age, even if that request fails: the
+        // copy we have is still better than the remote one
+        time_t now = time(nullptr);
+        if (now - file->modified >= max_age_.count()) {
+            file->modified = now;
+            enqueue();
+        }
+        return "file://" + files_.path(name);
+    }
+
+    ++misses_;
+    enqueue();
+    return owner.avatar_url;
+}
+
+void AvatarCache::work() {
+    for (;;) {
+        pair<unsigned int, string> next;
+        {
+            unique_lock<mutex> lock(mutex_);
+            wake_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+            if (stopping_) {
+                return;
+            }
+            next = queue_.front();
+            queue_.pop_front();
+        }
+
+        download(next.first, next.second);
+
+        lock_guard<mutex> lock(mutex_);
+        queued_.erase(next.first);
+    }
+}
+
+void AvatarCache::download(unsigned int id, const string &url) {
+    http::Request::Configuration configuration;
+
+    // GitHub scales avatars on the server if asked to, which saves most
+    // of the download
+    configuration.uri = url + (url.find('?') == string::npos ? "?" : "&")
+            + "s=" + to_string(size_);
+    configuration.header.add("User-Agent", config_->user_agent);
+
+    // Revalidate the avatar we have rather than download it again
+    string name = file_name(id);
+    string final_path = files_.path(name);
+    QString etag = QImageReader(QString::fromStdString(final_path)).text(ETAG_KEY);
+    if (!etag.isEmpty()) {
+        configuration.header.add("If-None-Match", etag.toStdString());
+    }
+
+    http::Response response;
+    try {
+        auto client = http::make_client();
+        response = client->get(configuration)->execute(
+                    [this](const http::Request::Progress &) {
+            lock_guard<mutex> lock(mutex_);
+            return stopping_ ?
+                        http::Request::Progress::Next::abort_operation :
+                        http::Request::Progress::Next::continue_operation;
+        });
+    } catch (net::Error &) {
+        return;
+    }
+    if (response.status == http::Status::not_modified) {
+        // Good for another max_age, after a restart too
+        utimes(final_path.c_str(), nullptr);
+        ++revalidations_;
+        return;
+    }
+    if (response.status != http::Status::ok) {
+        return;
+    }
+
+    QImage image;
+    if (!image.loadFromData(reinterpret_cast<const unsigned char *>(response.body.data()),
+                            response.body.size())) {
+        return;
+    }
+    if (image.width() > size_ || image.height() > size_) {
+        image = image.scaled(size_, size_, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+    }
+    image.setText(ETAG_KEY, QString::fromStdString(Client::header_value(response.header, "ETag")));
+
+    // Write next to the final file, so the shell never sees half an image
+    string temporary = final_path + ".tmp";
+    if (!image.save(QString::fromStdString(temporary), "PNG")
+            || rename(temporary.c_str(), final_path.c_str()) != 0) {
+        remove(temporary.c_str());
+        return;
+    }
+    ++downloads_;
+
+    lock_guard<mutex> lock(mutex_);
+    files_.stored(name);
+}
+
+AvatarCache::Stats AvatarCache::stats() const {
+    return Stats { hits_, misses_, downloads_, files_.evictions(), revalidations_ };
+}
@@ -0,0 +1,32 @@
+#include <scope/metrics_writer.h>
+
+using namespace std;
+using namespace api;
+using namespace scope;
+
+MetricsWriter::MetricsWriter(Metrics::Ptr metrics, const string &path,
+                             chrono::seconds interval) :
+    metrics_(metrics), path_(path), interval_(interval) {
+    worker_ = thread(&MetricsWriter::work, this);
+}
+
+MetricsWriter::~MetricsWriter() {
+    {
+        lock_guard<mutex> lock(mutex_);
+        stop_.cancel();
+    }
+    wake_.notify_all();
+    worker_.join();
+
+    // Whatever happened since the last write
+    metrics_->write(path_);
+}
+
+void MetricsWriter::work() {
+    unique_lock<mutex> lock(mutex_);
+    while (!wake_.wait_for(lock, interval_, [this]() { return stop_.cancelled(); })) {
+        lock.unlock();
+        metrics_->write(path_);
+        lock.lock();
+    }
+}
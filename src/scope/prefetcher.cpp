@@ -0,0 +1,45 @@
+#include <scope/prefetcher.h>
+
+using namespace std;
+using namespace api;
+using namespace scope;
+
+Prefetcher::Prefetcher(Config::Ptr config, ResultCache::Ptr cache, size_t capacity) :
+    cache_(cache), client_(Client::create(config)), fetched_(0), cached_(0),
+    queue_(capacity, 1,
+           [](const string &full_name) { return full_name; },
+           [this](const string &full_name, const CancellationToken &stop) {
+               fetch(full_name, stop);
+           }) {
+    client_->setPriority(RateLimiter::Priority::background);
+}
+
+void Prefetcher::prefetch(const vector<string> &full_names) {
+    queue_.push(full_names);
+}
+
+void Prefetcher::fetch(const string &full_name, const CancellationToken &stop) {
+    if (cache_->details.get(full_name)) {
+        ++cached_;
+        return;
+    }
+
+    try {
+        auto details = client_->details(full_name, stop);
+
+        // Nothing at all usually means the rate limiter held us back,
+        // let a live fetch try again later
+        if (!stop.cancelled() && (!details.readme.empty() || !details.languages.empty()
+                                  || !details.latest_release.empty()
+                                  || !details.contributors.empty())) {
+            cache_->details.put(full_name, make_shared<Client::Details>(move(details)));
+            ++fetched_;
+        }
+    } catch (exception &) {
+        // Prefetching is best effort
+    }
+}
+
+Prefetcher::Stats Prefetcher::stats() const {
+    return Stats { fetched_, cached_, queue_.dropped() };
+}
@@ -1,3 +1,5 @@
+#include <api/metrics.h>
+#include <api/tracer.h>
 #include <scope/preview.h>
 
 #include <unity/scopes/ColumnLayout.h>
@@ -6,22 +8,140 @@
 #include <unity/scopes/Result.h>
 #include <unity/scopes/VariantBuilder.h>
 
+#include <chrono>
 #include <iostream>
+#include <mutex>
+#include <sstream>
 
 namespace sc = unity::scopes;
 
 using namespace std;
+using namespace api;
 using namespace scope;
 
-Preview::Preview(const sc::Result &result, const sc::ActionMetadata &metadata) :
-    sc::PreviewQueryBase(result, metadata) {
+namespace {
+
+/**
+ * "C++ 80%, Python 20%"
+ */
+string languages_summary(const Client::Details &details) {
+    double total = 0;
+    for (const auto &language : details.languages) {
+        total += language.second;
+    }
+
+    ostringstream oss;
+    for (const auto &language : details.languages) {
+        int percent = static_cast<int>(100 * language.second / total + 0.5);
+        if (percent == 0) {
+            break;
+        }
+        oss << (oss.tellp() > 0 ? ", " : "") << language.first << " " << percent << "%";
+    }
+    return oss.str();
+}
+
+/**
+ * "alice (120), bob (45)"
+ */
+string contributors_summary(const Client::Details &details) {
+    ostringstream oss;
+    for (const auto &contributor : details.contributors) {
+        oss << (oss.tellp() > 0 ? ", " : "") << contributor.first
+            << " (" << contributor.second << ")";
+    }
+    return oss.str();
+}
+
+/**
+ * A text widget for each part of the details that is set
+ */
+sc::PreviewWidgetList details_widgets(const Client::Details &details) {
+    sc::PreviewWidgetList widgets;
+    if (!details.latest_release.empty()) {
+        sc::PreviewWidget release("release", "text");
+        release.add_attribute_value("title", sc::Variant("Latest release"));
+        release.add_attribute_value("text", sc::Variant(details.latest_release));
+        widgets.push_back(release);
+    }
+    if (!details.languages.empty()) {
+        sc::PreviewWidget languages("languages", "text");
+        languages.add_attribute_value("title", sc::Variant("Languages"));
+        languages.add_attribute_value("text", sc::Variant(languages_summary(details)));
+        widgets.push_back(languages);
+    }
+    if (!details.contributors.empty()) {
+        sc::PreviewWidget contributors("contributors", "text");
+        contributors.add_attribute_value("title", sc::Variant("Contributors"));
+        contributors.add_attribute_value("text", sc::Variant(contributors_summary(details)));
+        widgets.push_back(contributors);
+    }
+    if (!details.readme.empty()) {
+        sc::PreviewWidget readme("readme", "text");
+        readme.add_attribute_value("title", sc::Variant("README"));
+        readme.add_attribute_value("text", sc::Variant(details.readme));
+        widgets.push_back(readme);
+    }
+    return widgets;
+}
+
+/**
+ * The profile of a user, one line per field that is set
+ */
+string profile_summary(const Client::User &user) {
+    ostringstream oss;
+    auto line = [&oss](const string &label, const string &value) {
+        if (!value.empty()) {
+            oss << (oss.tellp() > 0 ? "\n" : "") << label << value;
+        }
+    };
+    line("", user.name);
+    line("", user.bio);
+    line("Company: ", user.company);
+    line("Location: ", user.location);
+    line("Blog: ", user.blog);
+    oss << (oss.tellp() > 0 ? "\n\n" : "") << user.followers << " followers, "
+        << user.following << " following, " << user.public_repos << " public repositories";
+    return oss.str();
+}
+
+/**
+ * Details not fetched by then are left out of the preview
+ */
+const chrono::milliseconds DETAILS_DEADLINE(1500);
+
+/**
+ * Shared with the details callbacks, which may still run once the
+ * preview is over
+ */
+struct Stream {
+    mutex guard;
+    bool open = true;
+};
+
+}
+
+Preview::Preview(const sc::Result &result, const sc::ActionMetadata &metadata,
+                 Config::Ptr config) :
+    sc::PreviewQueryBase(result, metadata), client_(Client::create(config)) {
 }
 
 void Preview::cancelled() {
+    cancelled_ = true;
+    cancellation_.cancel();
+    if (client_->config()->metrics) {
+        client_->config()->metrics->add(Metrics::Counter::cancellations);
+    }
 }
 
 void Preview::run(sc::PreviewReplyProxy const& reply) {
+    Tracer::Span span(client_->config()->tracer, "preview");
+    Metrics::Ptr metrics = client_->config()->metrics;
+    Metrics::Timer timer(metrics ? &metrics->preview : nullptr);
     sc::Result result = PreviewQueryBase::result();
+    if (span.active()) {
+        span.detail(result["type"].get_string() + ": " + result.uri());
+    }
 
     sc::ColumnLayout layout1col(1), layout2col(2), layout3col(3);
 
@@ -48,16 +168,17 @@ void Preview::run(sc::PreviewReplyProxy const& reply) {
       */
     else if(result["type"].get_string() == "repository") {
         // Single column layout
-        layout1col.add_column( { "image", "header", "actions" });
+        layout1col.add_column( { "image", "header", "actions", "release", "languages",
+                                 "contributors", "readme" });
 
         // Two column layout
-        layout2col.add_column( { "image" });
-        layout2col.add_column( { "header", "actions" });
+        layout2col.add_column( { "image", "release", "languages", "contributors" });
+        layout2col.add_column( { "header", "actions", "readme" });
 
         // Three cokumn layout
-        layout3col.add_column( { "image" });
-        layout3col.add_column( { "header" });
-        layout3col.add_column( { "actions" });
+        layout3col.add_column( { "image", "release", "contributors" });
+        layout3col.add_column( { "header", "languages" });
+        layout3col.add_column( { "actions", "readme" });
 
         // Register the layouts we just created
         reply->register_layout( { layout1col, layout2col, layout3col });
@@ -100,6 +221,55 @@ void Preview::run(sc::PreviewReplyProxy const& reply) {
 
         // Push each of the sections
         reply->push( { image, header, actions });
+
+        // Then whatever we know beyond the search result
+        pushRepositoryDetails(reply, result["full_name"].get_string());
+    }
+    /**
+      * User preview
+      */
+    else if(result["type"].get_string() == "user") {
+        // Single column layout
+        layout1col.add_column( { "image", "header", "actions", "profile" });
+
+        // Two column layout
+        layout2col.add_column( { "image" });
+        layout2col.add_column( { "header", "actions", "profile" });
+
+        // Register the layouts we just created
+        reply->register_layout( { layout1col, layout2col });
+
+        // Define the header section
+        sc::PreviewWidget header("header", "header");
+        header.add_attribute_mapping("title", "title");
+        header.add_attribute_mapping("subtitle", "description");
+
+        // Define the image section
+        sc::PreviewWidget image("image", "image");
+        image.add_attribute_mapping("source", "art");
+
+        // Define the actions section
+        sc::PreviewWidget actions("actions", "actions");
+        sc::VariantBuilder builder;
+        builder.add_tuple({
+                              {"id", sc::Variant("open")},
+                              {"label", sc::Variant("View Profile")},
+                              {"uri", result["uri"]}
+                          });
+        actions.add_attribute_value("actions", builder.end());
+
+        // Push each of the sections
+        reply->push( { image, header, actions });
+
+        // Then the profile, which searches do not return
+        auto profile = userProfile(result["login"].get_string(),
+                                   to_string(result["id"].get_int()));
+        if (profile) {
+            sc::PreviewWidget text("profile", "text");
+            text.add_attribute_value("title", sc::Variant("Profile"));
+            text.add_attribute_value("text", sc::Variant(profile_summary(*profile)));
+            reply->push( { text });
+        }
     }
     /**
       * Code result
@@ -140,5 +310,105 @@ void Preview::run(sc::PreviewReplyProxy const& reply) {
         // Push each of the sections
         reply->push( { header, actions });
     }
+
+    // Previews that missed the details deadline are the tail we want to
+    // see, only those the shell gave up on are left out
+    if (cancelled_) {
+        timer.dismiss();
+    }
 }
 
+
+void Preview::pushRepositoryDetails(sc::PreviewReplyProxy const& reply,
+                                    const string &full_name) {
+    Tracer::Span span(client_->config()->tracer, "details");
+    shared_ptr<const Client::Details> details;
+    if (resultCache) {
+        details = resultCache->details.get(full_name);
+    }
+    if (details) {
+        auto widgets = details_widgets(*details);
+        if (!widgets.empty()) {
+            reply->push(widgets);
+        }
+        return;
+    }
+
+    // All the parts are requested at once, and each widget is pushed as
+    // soon as its part arrives
+    auto stream = make_shared<Stream>();
+    pending_ = client_->details_async(full_name, cancellation_,
+                                     [stream, reply](const Client::Details &part) {
+        lock_guard<mutex> lock(stream->guard);
+        if (!stream->open) {
+            return;
+        }
+        auto widgets = details_widgets(part);
+        if (!widgets.empty()) {
+            reply->push(widgets);
+        }
+    });
+
+    if (pending_.wait_for(DETAILS_DEADLINE) == future_status::ready) {
+        try {
+            auto fetched = make_shared<Client::Details>(pending_.get());
+            if (resultCache && !cancelled_) {
+                resultCache->details.put(full_name, fetched);
+            }
+        } catch (exception &e) {
+            cerr << "Repository details: " << e.what() << endl;
+        }
+        return;
+    }
+
+    // Too late: skip what is missing and abort its requests. The
+    // destructor waits for them to wind down.
+    {
+        lock_guard<mutex> lock(stream->guard);
+        stream->open = false;
+    }
+    cancellation_.cancel();
+}
+
+shared_ptr<const Client::User> Preview::userProfile(const string &login,
+                                                   const string &id) {
+    Tracer::Span span(client_->config()->tracer, "profile");
+    shared_ptr<const Client::User> profile;
+    if (resultCache) {
+        profile = resultCache->profiles.get(id);
+    }
+    if (profile) {
+        return profile;
+    }
+
+    // Not hydrated yet, so fetch it now under the same deadline as the
+    // repository details
+    pending_profile_ = client_->user_async(login, cancellation_);
+    if (pending_profile_.wait_for(DETAILS_DEADLINE) != future_status::ready) {
+        cancellation_.cancel();
+        return profile;
+    }
+    try {
+        auto fetched = make_shared<Client::User>(pending_profile_.get());
+        if (fetched->login.empty()) {
+            return profile;
+        }
+        if (resultCache && !cancelled_) {
+            resultCache->profiles.put(id, fetched);
+        }
+        profile = fetched;
+    } catch (exception &e) {
+        cerr << "User profile: " << e.what() << endl;
+    }
+    return profile;
+}
+
+ResultCache::Ptr Preview::getResultCache() const
+{
+    return resultCache;
+}
+
+void Preview::setResultCache(const ResultCache::Ptr &value)
+{
+    resultCache = value;
+}
@@ -1,21 +1,27 @@
 #include <boost/algorithm/string/trim.hpp>
 
+#include <api/metrics.h>
+#include <api/schema.h>
+#include <api/tracer.h>
 #include <scope/localization.h>
 #include <scope/query.h>
 
 #include <unity/scopes/Annotation.h>
 #include <unity/scopes/CategorisedResult.h>
-#include <unity/scopes/CategoryRenderer.h>
 #include <unity/scopes/QueryBase.h>
 #include <unity/scopes/SearchReply.h>
 #include <unity/scopes/Department.h>
 #include <unity/scopes/OptionSelectorFilter.h>
 
 #include <QDate>
-#include <QSettings>
 
+#include <cctype>
+#include <future>
 #include <iomanip>
+#include <mutex>
 #include <sstream>
+#include <unordered_set>
+#include <vector>
 
 namespace sc = unity::scopes;
 namespace alg = boost::algorithm;
@@ -25,77 +31,118 @@ using namespace api;
 using namespace scope;
 
 /**
- * Repository result template
+ * How many of the first results get their preview prefetched
  */
-const static string REPOSITORY_TEMPLATE =
-        R"(
-{
-        "schema-version": 1,
-        "template": {
-        "category-layout": "grid",
-        "card-size": "medium",
-        "overlay": true
-        },
-        "components": {
-        "title": "title",
-        "art" : {
-        "field": "art"
-        },
-        "overlay-color": "overlay"
-        }
-        }
-        )";
+const static size_t PREFETCH_COUNT = 3;
 
 /**
- * Code result remplate
+ * The shortest query the root department searches code for, unless it
+ * names the repository. The code search budget is a fraction of the
+ * repository one, and the first letters typed rarely find any code.
  */
-const static string CODE_TEMPLATE =
-        R"(
-{
-        "schema-version": 1,
-        "template": {
-        "category-layout": "vertical-journal",
-        "card-size": 32
-        },
-        "components": {
-        "title": "title",
-        "summary":"summary",
-        "type":"type"
-        }
-        }
-        )";
+const static size_t CODE_SEARCH_MIN_LENGTH = 4;
+
+namespace {
 
 /**
- * 404 page - Nothing return from the query
+ * Copies every field of a record's schema into result attributes named
+ * after their JSON keys, nested records prefixed with their own key
+ * ("owner_login"). Attributes composed for display are set on top.
  */
-const static string EMPTY_TEMPLATE =
-        R"(
-{
-        "schema-version": 1,
-        "template": {
-        "category-layout": "grid",
-        "card-size": "large"
-        },
-        "components": {
-        "title": "title",
-        "summary": "summary",
-        "type": "type"
-        }
-        }
-        )";
+template<typename Record>
+struct ResultAttributes {
+    sc::Result &res;
+    const Record &record;
+    string prefix;
+
+    template<typename Member>
+    void operator()(const char *key, Member Record::*member) {
+        set(prefix + key, record.*member);
+    }
+
+    void set(const string &name, const string &value) {
+        res[name] = value;
+    }
+
+    void set(const string &name, unsigned int value) {
+        res[name] = sc::Variant(static_cast<int>(value));
+    }
+
+    void set(const string &name, bool value) {
+        res[name] = sc::Variant(value);
+    }
+
+    template<typename Nested>
+    void set(const string &name, const Nested &value) {
+        ResultAttributes<Nested> nested { res, value, name + "_" };
+        api::Schema<Nested>::visit(nested);
+    }
+};
+
+template<typename Record>
+void set_attributes(sc::Result &res, const Record &record) {
+    ResultAttributes<Record> attributes { res, record, string() };
+    api::Schema<Record>::visit(attributes);
+}
+
+/**
+ * Take a "repo:owner/name" qualifier out of a query, and return the
+ * repository it names, or an empty string if there is none
+ */
+string take_repo(string &query) {
+    const string qualifier = "repo:";
+    size_t start = query.find(qualifier);
+    while (start != string::npos && start > 0
+           && !isspace(static_cast<unsigned char>(query[start - 1]))) {
+        start = query.find(qualifier, start + 1);
+    }
+    if (start == string::npos) {
+        return string();
+    }
+
+    size_t end = query.find_first_of(" \t", start);
+    string repo = query.substr(start + qualifier.size(),
+                               end == string::npos ? string::npos : end - start - qualifier.size());
+    end = query.find_first_not_of(" \t", end);
+    query.erase(start, end == string::npos ? string::npos : end - start);
+    alg::trim(query);
+    return repo;
+}
+
+/**
+ * Count a search answered from the result cache, or not
+ */
+void count_lookup(const Config &config, bool hit) {
+    if (config.metrics) {
+        config.metrics->add(hit ? Metrics::Counter::result_cache_hits :
+                                  Metrics::Counter::result_cache_misses);
+    }
+}
+
+}
 
 Query::Query(const sc::CannedQuery &query, const sc::SearchMetadata &metadata,
              Config::Ptr config) :
-    sc::SearchQueryBase(query, metadata), client_(config) {
+    sc::SearchQueryBase(query, metadata), client_(Client::create(config)) {
 
 }
 
 void Query::cancelled() {
-    client_.cancel();
+    // Abort every request this query has in flight
+    cancellation_.cancel();
+    if (client_->config()->metrics) {
+        client_->config()->metrics->add(Metrics::Counter::cancellations);
+    }
 }
 
 
 void Query::run(sc::SearchReplyProxy const& reply) {
+    Tracer::Ptr tracer = client_->config()->tracer;
+    Tracer::Span span(tracer, "query");
+
+    // Cancelled queries end early, they would flatter the percentiles
+    Metrics::Ptr metrics = client_->config()->metrics;
+    Metrics::Timer timer(metrics ? &metrics->query : nullptr);
     try {
         initScope();
         loadCache();
@@ -114,27 +161,35 @@ void Query::run(sc::SearchReplyProxy const& reply) {
         optionsFilter->add_option("tv", _("TV-series"));
         optionsFilter->active_options(query.filter_state());
         filters.push_back(optionsFilter);
-        reply->push(filters, query.filter_state());
+        reply->push(filters, query.filter_state());*/
+
+        // An empty query shows the last search again
+        string search = query_string.empty() ? c_query : query_string;
+        bool root = query.department_id() == "";
+
+        // Code is searched for the rest of the query, in the repository it
+        // names or else in the last one
+        string code_search = search;
+        string repo = take_repo(code_search);
+        if (!repo.empty()) {
+            c_repo = repo;
+        }
 
         // Create the root department with an empty string for the 'id' parameter (the first one)
-        sc::Department::SPtr all_depts = sc::Department::create("", query, "Repositories");
+        sc::Department::SPtr all_depts = sc::Department::create("", query, _("Repositories"));
 
         // Create new departments
         sc::Department::SPtr code_department;
-        code_department = sc::Department::create("code", query, "Code in " + c_repo);
+        code_department = sc::Department::create("code", query, _("Code in ") + c_repo);
+
+        sc::Department::SPtr users_department;
+        users_department = sc::Department::create("users", query, _("Users"));
 
         // Register them as subdepartments of the root
-        all_depts->set_subdepartments({code_department});
+        all_depts->set_subdepartments({code_department, users_department});
 
         // Register the root department on the reply
         reply->register_departments(all_depts);
-*/
-        // the Client is the helper class that provides the results
-        // without mixing APIs and scopes code.
-        // Add your code to retreive xml, json, or any other kind of result
-        // in the client.
-        Client::RepositoryRes repositories;
-        Client::CodeRes codes;
 
         // Reset cached informations if users does not want them to be saved
         /*if(!s_save) {
@@ -142,35 +197,202 @@ void Query::run(sc::SearchReplyProxy const& reply) {
             c_repo = "torvalds/linux";
         }*/
 
-        if (query_string.empty()) {
-            // If the string is empty, get the current weather for London
-            //if(query.department_id() == "")
-                repositories = client_.repositories(c_query, s_name, s_description, s_readme);
-            //else if(query.department_id() == "code")
-            //    codes = client_.code(c_query, c_repo);
-        } else {
-            // otherwise, get the current weather for the search string
-            //if(query.department_id() == "") {
-                repositories = client_.repositories(query_string, s_name, s_description, s_readme);
-            //    c_query = query_string;
-            //}
-            //else if(query.department_id() == "code")
-            //    codes = client_.code(query_string, c_repo);
-            // Update cached query
+        if (span.active()) {
+            span.detail(query.department_id() + ": " + search);
+        }
+
+        // Next to the repositories, code is only worth its small budget
+        // once the query says enough
+        bool search_code = !code_search.empty()
+                && (!root || !repo.empty() || code_search.size() >= CODE_SEARCH_MIN_LENGTH);
+
+        // the Client is the helper class that provides the results
+        // without mixing APIs and scopes code.
+        // Add your code to retreive xml, json, or any other kind of result
+        // in the client.
+        //
+        // Results are pushed as soon as each one has been parsed, from
+        // whichever thread parsed it, so the reply and everything below
+        // is guarded by reply_mutex.
+        mutex reply_mutex;
+        sc::Category::SCPtr repositories_cat;
+        sc::Category::SCPtr code_cat;
+        sc::Category::SCPtr users_cat;
+        bool registered = false;
+        bool stopped = false;
+        size_t shown = 0;
+        unordered_set<string> pushed;
+        vector<string> top;
+        vector<Client::User> stubs;
+        Client::RepositoryList rendered;
+
+        // Both categories are registered along with the first result, in
+        // a fixed order whichever search answers first. Code only gets one
+        // if it is searched at all.
+        auto register_categories = [&]() {
+            if (registered) {
+                return;
+            }
+            registered = true;
+            if (root) {
+                repositories_cat = reply->register_category("repositories", _("Repositories"), "",
+                                                            renderers->repositories);
+            }
+            if (search_code) {
+                code_cat = reply->register_category("code", _("Code in ") + c_repo, "",
+                                                    renderers->code);
+            }
+        };
+        auto push = [&](const sc::CategorisedResult &res) {
+            // Time spent here is the shell not keeping up
+            Tracer::Span pushing(tracer, "push");
+            if (!reply->push(res)) {
+                // If we fail to push, it means the query has been cancelled.
+                // So stop downloading the rest;
+                stopped = true;
+                cancellation_.cancel();
+            }
+            ++shown;
+        };
+
+        Client::RepositoryHandler push_repository = [&](const Client::Repository &repository) {
+            lock_guard<mutex> lock(reply_mutex);
+
+            // Skip what the local index already showed
+            if (stopped || !pushed.insert(repository.full_name).second) {
+                return;
+            }
+            if (top.size() < PREFETCH_COUNT) {
+                top.push_back(repository.full_name);
+            }
+            register_categories();
+            Tracer::Span formatting(tracer, "result");
+            auto res = repositoryResult(repositories_cat, repository);
+            formatting.end();
+            push(res);
+            if (rendered.size() < s_limit) {
+                rendered.push_back(repository);
+            }
+        };
+        Client::CodeHandler push_code = [&](const Client::Code &code) {
+            lock_guard<mutex> lock(reply_mutex);
+            if (stopped) {
+                return;
+            }
+            register_categories();
+            Tracer::Span formatting(tracer, "result");
+            auto res = codeResult(code_cat, code);
+            formatting.end();
+            push(res);
+        };
+        Client::UserHandler push_user = [&](const Client::User &user) {
+            lock_guard<mutex> lock(reply_mutex);
+            if (stopped) {
+                return;
+            }
+            if (!users_cat) {
+                users_cat = reply->register_category("users", _("Users"), "",
+                                                     renderers->users);
+            }
+
+            // Some backends return full profiles, keep them for the
+            // previews. Otherwise users we know nothing more about are
+            // shown as they are, and completed in the background.
+            shared_ptr<const Client::User> profile;
+            if (client_->searches_return_profiles()) {
+                profile = make_shared<Client::User>(user);
+                if (resultCache) {
+                    resultCache->profiles.put(toStr(user.id), profile);
+                }
+            } else {
+                if (userHydrator) {
+                    profile = userHydrator->profile(user.id);
+                }
+                if (!profile) {
+                    stubs.push_back(user);
+                }
+            }
+            Tracer::Span formatting(tracer, "result");
+            auto res = userResult(users_cat, user, profile);
+            formatting.end();
+            push(res);
+        };
+
+        if (root) {
+            // The code search runs alongside the repository search rather
+            // than after it. Its result is cached and shared, so switching
+            // to the code department does not fetch it again.
+            future<void> code_searched;
+            if (search_code) {
+                code_searched = async(launch::async, [&]() {
+                    try {
+                        searchCode(code_search, push_code);
+                    } catch (domain_error &e) {
+                        // The repositories are still worth showing
+                        cerr << e.what() << endl;
+                    }
+                });
+            }
+
+            // Opening the scope shows the last results again at once,
+            // without any network or parsing
+            if (query_string.empty()) {
+                for (const auto &repository : c_repositories) {
+                    push_repository(repository);
+                }
+            }
+
+            // Show what we already know straight away, the network results
+            // follow. Without a network this is all there is.
+            if (repositoryIndex) {
+                Tracer::Span searching(tracer, "search index");
+                for (const auto &repository : repositoryIndex->search(search, s_limit)) {
+                    push_repository(repository);
+                }
+            }
+
+            searchRepositories(search, push_repository);
+            if (code_searched.valid()) {
+                code_searched.get();
+            }
+
+            // Without a qualifier, the code department searches the
+            // repository the user most likely means: the top result
+            if (repo.empty() && !query_string.empty() && !top.empty()) {
+                c_repo = top.front();
+            }
+        } else if (query.department_id() == "code") {
+            if (search_code) {
+                searchCode(code_search, push_code);
+            }
+        } else if (query.department_id() == "users") {
+            searchUsers(search, push_user);
+        }
+
+        // Update cached query
+        if (!query_string.empty()) {
             c_query = query_string;
         }
 
-        // Build up the description for the city
-        //stringstream ss(stringstream::in | stringstream::out);
-        //ss << current.city.name << ", " << current.city.country;
+        if (stopped || cancellation_.cancelled()) {
+            timer.dismiss();
+            return;
+        }
+
+        // The user is likely to open one of the first results next
+        if (prefetcher && !top.empty()) {
+            prefetcher->prefetch(top);
+        }
+        if (userHydrator && !stubs.empty()) {
+            userHydrator->hydrate(stubs);
+        }
 
         /**
           * 404 error
           */
-        if((repositories.total_count <= 0 && query.department_id() == "")
-                || (codes.total_count <= 0 && query.department_id() == "code")) {
+        if (shown == 0) {
             auto empty_cat = reply->register_category("empty",
-                                                      _("Nothing found"), "", sc::CategoryRenderer(EMPTY_TEMPLATE));
+                                                      _("Nothing found"), "", renderers->empty);
 
             // Create a result
             sc::CategorisedResult res(empty_cat);
@@ -189,89 +411,13 @@ void Query::run(sc::SearchReplyProxy const& reply) {
                 return;
             }
         }
-        /**
-         * Repository found
-         */
-        else if(query.department_id() == "") {
-            // Register a category for the current weather, with the title we just built
-            auto repositories_cat = reply->register_category("repositories", _("Repositories"), "",
-                                                             sc::CategoryRenderer(REPOSITORY_TEMPLATE));
-            auto code_cat = reply->register_category("code", _("Code"), "",
-                                                     sc::CategoryRenderer(CODE_TEMPLATE));
-
-            for (const auto &repository : repositories.repositories) {
-                // Iterate over the trackslist
-                sc::CategorisedResult res(repositories_cat);
-
-                // We must have a URI
-                res.set_uri(repository.html_url);
-
-                // We also need the track title
-                res.set_title(repository.full_name);
-
-                // Set the rest of the attributes, art, artist, etc
-                res.set_art(repository.owner.avatar_url);
-
-                QDate createdDate = QDate::fromString(QString::fromStdString(repository.created_at), Qt::ISODate);
-                QDate pushedDate = QDate::fromString(QString::fromStdString(repository.pushed_at), Qt::ISODate);
-                res["description"] = repository.description + "\n\nLanguage: " + repository.language +
-                        "\n\n" + toStr(repository.stargazers_count) + " stargazers, " +
-                        toStr(repository.watchers_count) + " watchers." +
-                        "\n\nCreated at " + createdDate.toString().toStdString() +
-                        "\nLast push " + pushedDate.toString().toStdString() +
-                        ", " + toStr(pushedDate.daysTo(QDate::currentDate())) +
-                        " days ago." +
-                        "\n\nOpen issues: " + toStr(repository.open_issues_count);
-                res["developer_uri"] = repository.owner.url;
-                res["new_issue_uri"] = repository.html_url + "/issues/new";
-                res["type"] = "repository";
-
-                //sc::CategorisedResult codeRes(code_cat);
-                //sc::CannedQuery code_query(query);
-                //code_query.set_department_id("code");
-                //codeRes.set_uri(code_query.to_uri());
-                res["code_query"] = repository.html_url + "/search";
-                //c_repo = repository.full_name;
-
-                // Push the result
-                if (!reply->push(res)) {
-                    // If we fail to push, it means the query has been cancelled.
-                    // So don't continue;
-                    return;
-                }
-            }
+        // Update cache. Only the root department renders repositories, the
+        // others keep the last ones if the query did not change.
+        if (root) {
+            c_repositories = move(rendered);
+        } else if (!query_string.empty() && query_string != c_query_loaded) {
+            c_repositories.clear();
         }
-        /**
-          * Code found
-          */
-        else if(query.department_id() == "code") {
-            // Register a category for the current weather, with the title we just built
-            auto code_cat = reply->register_category("code", _("Code in ") + c_repo, "",
-                                                     sc::CategoryRenderer(CODE_TEMPLATE));
-
-            for (const auto &code : codes.codes) {
-                // Iterate over the trackslist
-                sc::CategorisedResult res(code_cat);
-
-                // We must have a URI
-                res.set_uri(code.html_url);
-
-                // We also need the track title
-                res.set_title(code.name);
-                res["description"] = code.repository.full_name;
-                res["developer_uri"] = code.repository.owner.url;
-                res["new_issue_uri"] = code.repository.html_url + "/issues/new";
-                res["type"] = "code";
-
-                // Push the result
-                if (!reply->push(res)) {
-                    // If we fail to push, it means the query has been cancelled.
-                    // So don't continue;
-                    return;
-                }
-            }
-        }
-        // Update cache
         updateCache();
     } catch (domain_error &e) {
         // Handle exceptions being thrown by the client API
@@ -280,6 +426,210 @@ void Query::run(sc::SearchReplyProxy const& reply) {
     }
 }
 
+sc::CategorisedResult Query::repositoryResult(const sc::Category::SCPtr &category,
+                                              const Client::Repository &repository) {
+    sc::CategorisedResult res(category);
+    set_attributes(res, repository);
+
+    // We must have a URI
+    res.set_uri(repository.html_url);
+
+    // We also need the track title
+    res.set_title(repository.full_name);
+
+    // Set the rest of the attributes, art, artist, etc
+    // A local thumbnail of the avatar is much cheaper for the shell to load
+    res.set_art(avatarCache ? avatarCache->art(repository.owner) : repository.owner.avatar_url);
+
+    QDate createdDate = QDate::fromString(QString::fromStdString(repository.created_at), Qt::ISODate);
+    QDate pushedDate = QDate::fromString(QString::fromStdString(repository.pushed_at), Qt::ISODate);
+    res["description"] = repository.description + "\n\nLanguage: " + repository.language +
+            "\n\n" + toStr(repository.stargazers_count) + " stargazers, " +
+            toStr(repository.watchers_count) + " watchers." +
+            "\n\nCreated at " + createdDate.toString().toStdString() +
+            "\nLast push " + pushedDate.toString().toStdString() +
+            ", " + toStr(pushedDate.daysTo(QDate::currentDate())) +
+            " days ago." +
+            "\n\nOpen issues: " + toStr(repository.open_issues_count);
+    res["developer_uri"] = repository.owner.url;
+    res["new_issue_uri"] = repository.html_url + "/issues/new";
+    res["type"] = "repository";
+    res["code_query"] = repository.html_url + "/search";
+
+    return res;
+}
+
+sc::CategorisedResult Query::codeResult(const sc::Category::SCPtr &category,
+                                        const Client::Code &code) {
+    sc::CategorisedResult res(category);
+    set_attributes(res, code);
+
+    // We must have a URI
+    res.set_uri(code.html_url);
+
+    // We also need the track title
+    res.set_title(code.name);
+    res["description"] = code.repository.full_name;
+    res["developer_uri"] = code.repository.owner.url;
+    res["new_issue_uri"] = code.repository.html_url + "/issues/new";
+    res["type"] = "code";
+
+    return res;
+}
+
+sc::CategorisedResult Query::userResult(const sc::Category::SCPtr &category,
+                                        const Client::User &user,
+                                        const shared_ptr<const Client::User> &profile) {
+    // Use the full profile if it has been fetched already
+    const Client::User &shown = profile ? *profile : user;
+
+    sc::CategorisedResult res(category);
+    set_attributes(res, shown);
+
+    // We must have a URI
+    res.set_uri(shown.html_url);
+    res.set_title(shown.login);
+    res.set_art(shown.avatar_url);
+
+    if (profile) {
+        string subtitle = shown.company;
+        subtitle += (subtitle.empty() ? "" : ", ") + toStr(shown.followers) + " followers";
+        res["subtitle"] = subtitle;
+    }
+    res["description"] = shown.name;
+    res["type"] = "user";
+
+    return res;
+}
+
+shared_ptr<const Client::RepositoryRes> Query::searchRepositories(
+        const string &query, const Client::RepositoryHandler &on_repository) {
+    Tracer::Span span(client_->config()->tracer, "search repositories");
+    string key = ResultCache::key(query, s_name, s_description, s_readme, s_limit);
+
+    // A repeated search is answered straight from memory
+    shared_ptr<const Client::RepositoryRes> repositories;
+    if (resultCache) {
+        repositories = resultCache->repositories.get(key);
+        count_lookup(*client_->config(), repositories != nullptr);
+    }
+    if (repositories) {
+        if (on_repository) {
+            for (const auto &repository : repositories->repositories) {
+                on_repository(repository);
+            }
+        }
+        return repositories;
+    }
+
+    if (repositoryFlights) {
+        // If another query is already running this search, share its
+        // request. The fetch may outlive us, so it uses its own client.
+        Config::Ptr config = client_->config();
+        bool name = s_name, description = s_description, readme = s_readme;
+        size_t limit = s_limit;
+        repositories = repositoryFlights->run(
+                    key, cancellation_, on_repository,
+                    [=](const CancellationToken &token, const Client::RepositoryHandler &emit) {
+            auto client = Client::create(config);
+            return client->repositories(query, name, description, readme, limit, token, emit);
+        });
+        if (!repositories) {
+            // We were cancelled while waiting
+            return make_shared<Client::RepositoryRes>();
+        }
+    } else {
+        repositories = make_shared<Client::RepositoryRes>(
+                    client_->repositories(query, s_name, s_description, s_readme, s_limit,
+                                          cancellation_, on_repository));
+    }
+
+    // Everything we fetched can be found offline from now on
+    if (repositoryIndex && !repositories->repositories.empty()) {
+        repositoryIndex->add(repositories->repositories);
+    }
+
+    // Don't remember failures or partial downloads, they usually mean we
+    // were offline or cancelled
+    if (resultCache && repositories->total_count > 0) {
+        resultCache->repositories.put(key, repositories);
+    }
+    return repositories;
+}
+
+shared_ptr<const Client::CodeRes> Query::searchCode(
+        const string &query, const Client::CodeHandler &on_code) {
+    Tracer::Span span(client_->config()->tracer, "search code");
+    string key = ResultCache::key(query, c_repo);
+
+    // The root department may have fetched this already
+    shared_ptr<const Client::CodeRes> codes;
+    if (resultCache) {
+        codes = resultCache->code.get(key);
+        count_lookup(*client_->config(), codes != nullptr);
+    }
+    if (codes) {
+        if (on_code) {
+            for (const auto &code : codes->codes) {
+                on_code(code);
+            }
+        }
+        return codes;
+    }
+
+    if (codeFlights) {
+        // ...or still be fetching it
+        Config::Ptr config = client_->config();
+        string repo = c_repo;
+        codes = codeFlights->run(
+                    key, cancellation_, on_code,
+                    [=](const CancellationToken &token, const Client::CodeHandler &emit) {
+            auto client = Client::create(config);
+            return client->code(query, repo, token, emit);
+        });
+        if (!codes) {
+            // We were cancelled while waiting
+            return make_shared<Client::CodeRes>();
+        }
+    } else {
+        codes = make_shared<Client::CodeRes>(
+                    client_->code(query, c_repo, cancellation_, on_code));
+    }
+
+    if (resultCache && codes->total_count > 0) {
+        resultCache->code.put(key, codes);
+    }
+    return codes;
+}
+
+shared_ptr<const Client::UserRes> Query::searchUsers(
+        const string &query, const Client::UserHandler &on_user) {
+    Tracer::Span span(client_->config()->tracer, "search users");
+    string key = ResultCache::key(query);
+
+    shared_ptr<const Client::UserRes> users;
+    if (resultCache) {
+        users = resultCache->users.get(key);
+        count_lookup(*client_->config(), users != nullptr);
+    }
+    if (users) {
+        if (on_user) {
+            for (const auto &user : users->users) {
+                on_user(user);
+            }
+        }
+        return users;
+    }
+
+    users = make_shared<Client::UserRes>(
+                client_->users(query, cancellation_, on_user));
+
+    if (resultCache && users->total_count > 0) {
+        resultCache->users.put(key, users);
+    }
+    return users;
+}
+
 std::string Query::toStr(const int value) {
     std::ostringstream oss;
     oss << value;
@@ -292,31 +642,150 @@ void Query::initScope()
     if (config.empty())
         cerr << "CONFIG EMPTY!" << endl;
 
-    s_name = config["searchName"].get_bool();
-    s_description = config["searchDescription"].get_bool();
-    s_readme= config["searchReadme"].get_bool();
+    // Parsed once per change rather than once per query
+    Settings current;
+    if (settingsSnapshot) {
+        current = *settingsSnapshot->get(config);
+    } else {
+        current = Settings::parse(config);
+    }
+    s_name = current.name;
+    s_description = current.description;
+    s_readme = current.readme;
+    s_limit = current.limit;
+
+    // Never fetch more than the shell is going to show
+    int cardinality = search_metadata().cardinality();
+    if (cardinality > 0 && static_cast<size_t>(cardinality) < s_limit) {
+        s_limit = cardinality;
+    }
+
+    // Only happens outside of the scope, in tests
+    if (!renderers) {
+        renderers = make_shared<Renderers>();
+    }
+}
+
+StateSnapshot::Ptr Query::getStateSnapshot() const
+{
+    return stateSnapshot;
+}
+
+void Query::setStateSnapshot(const StateSnapshot::Ptr &value)
+{
+    stateSnapshot = value;
+}
+
+ResultCache::Ptr Query::getResultCache() const
+{
+    return resultCache;
+}
+
+void Query::setResultCache(const ResultCache::Ptr &value)
+{
+    resultCache = value;
+}
+
+RepositoryFlights::Ptr Query::getRepositoryFlights() const
+{
+    return repositoryFlights;
+}
+
+void Query::setRepositoryFlights(const RepositoryFlights::Ptr &value)
+{
+    repositoryFlights = value;
+}
+
+RepositoryIndex::Ptr Query::getRepositoryIndex() const
+{
+    return repositoryIndex;
+}
+
+void Query::setRepositoryIndex(const RepositoryIndex::Ptr &value)
+{
+    repositoryIndex = value;
+}
+
+CodeFlights::Ptr Query::getCodeFlights() const
+{
+    return codeFlights;
+}
+
+void Query::setCodeFlights(const CodeFlights::Ptr &value)
+{
+    codeFlights = value;
+}
+
+AvatarCache::Ptr Query::getAvatarCache() const
+{
+    return avatarCache;
+}
+
+void Query::setAvatarCache(const AvatarCache::Ptr &value)
+{
+    avatarCache = value;
+}
+
+Prefetcher::Ptr Query::getPrefetcher() const
+{
+    return prefetcher;
+}
+
+void Query::setPrefetcher(const Prefetcher::Ptr &value)
+{
+    prefetcher = value;
 }
 
-std::string Query::getCachePath() const
+Renderers::Ptr Query::getRenderers() const
 {
-    return cachePath;
+    return renderers;
 }
 
-void Query::setCachePath(const std::string &value)
+void Query::setRenderers(const Renderers::Ptr &value)
 {
-    cachePath = value;
+    renderers = value;
+}
+
+SettingsSnapshot::Ptr Query::getSettingsSnapshot() const
+{
+    return settingsSnapshot;
+}
+
+void Query::setSettingsSnapshot(const SettingsSnapshot::Ptr &value)
+{
+    settingsSnapshot = value;
+}
+
+UserHydrator::Ptr Query::getUserHydrator() const
+{
+    return userHydrator;
+}
+
+void Query::setUserHydrator(const UserHydrator::Ptr &value)
+{
+    userHydrator = value;
 }
 
 void Query::loadCache()
 {
-    QSettings cache(QString::fromUtf8(cachePath.c_str()), QSettings::NativeFormat);
-    c_query = cache.value("query", "module").toString().toStdString();
-    c_repo = cache.value("repo", "linux/linux").toString().toStdString();
+    // The snapshot is read once by the scope, this is just a copy
+    StateSnapshot::State defaults;
+    shared_ptr<const StateSnapshot::State> state = stateSnapshot ? stateSnapshot->state() : nullptr;
+    const StateSnapshot::State &cache = state ? *state : defaults;
+    c_query = cache.query;
+    c_query_loaded = cache.query;
+    c_repo = cache.repo;
+    c_repositories = cache.repositories;
 }
 
 void Query::updateCache()
 {
-    QSettings cache(QString::fromUtf8(cachePath.c_str()), QSettings::NativeFormat);
-    cache.setValue("query", QVariant(c_query.c_str()));
-    cache.setValue("repo", QVariant(c_repo.c_str()));
+    if (!stateSnapshot) {
+        return;
+    }
+    StateSnapshot::State cache;
+    cache.query = c_query;
+    cache.repo = c_repo;
+    cache.repositories = c_repositories;
+    stateSnapshot->update(cache);
 }
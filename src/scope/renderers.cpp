@@ -0,0 +1,92 @@
+#include <scope/renderers.h>
+
+using namespace std;
+using namespace scope;
+
+/**
+ * Repository result template
+ */
+const string Renderers::REPOSITORY_TEMPLATE =
+        R"(
+{
+        "schema-version": 1,
+        "template": {
+        "category-layout": "grid",
+        "card-size": "medium",
+        "overlay": true
+        },
+        "components": {
+        "title": "title",
+        "art" : {
+        "field": "art"
+        },
+        "overlay-color": "overlay"
+        }
+        }
+        )";
+
+/**
+ * Code result template
+ */
+const string Renderers::CODE_TEMPLATE =
+        R"(
+{
+        "schema-version": 1,
+        "template": {
+        "category-layout": "vertical-journal",
+        "card-size": 32
+        },
+        "components": {
+        "title": "title",
+        "summary":"summary",
+        "type":"type"
+        }
+        }
+        )";
+
+/**
+ * User result template
+ */
+const string Renderers::USER_TEMPLATE =
+        R"(
+{
+        "schema-version": 1,
+        "template": {
+        "category-layout": "grid",
+        "card-size": "small"
+        },
+        "components": {
+        "title": "title",
+        "subtitle": "subtitle",
+        "art" : {
+        "field": "art"
+        }
+        }
+        }
+        )";
+
+/**
+ * 404 page - Nothing return from the query
+ */
+const string Renderers::EMPTY_TEMPLATE =
+        R"(
+{
+        "schema-version": 1,
+        "template": {
+        "category-layout": "grid",
+        "card-size": "large"
+        },
+        "components": {
+        "title": "title",
+        "summary": "summary",
+        "type": "type"
+        }
+        }
+        )";
+
+Renderers::Renderers() :
+    repositories(REPOSITORY_TEMPLATE),
+    code(CODE_TEMPLATE),
+    users(USER_TEMPLATE),
+    empty(EMPTY_TEMPLATE) {
+}
@@ -0,0 +1,426 @@
+#include <scope/repository_index.h>
+
+#include <api/schema.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <unordered_map>
+
+#include <unistd.h>
+
+using namespace std;
+using namespace api;
+using namespace scope;
+
+namespace {
+
+/**
+ * Longest field we accept when reading the log back, anything longer
+ * means the file is corrupt
+ */
+const size_t MAX_FIELD = 1024 * 1024;
+
+/**
+ * Below this many dead documents the log is never rewritten
+ */
+const size_t MIN_DEAD = 1024;
+
+/**
+ * Fields are written as netstrings ("5:hello,"), so descriptions may
+ * contain anything
+ */
+void write_field(ostream &out, const string &value) {
+    out << value.size() << ':' << value << ',';
+}
+
+void write_field(ostream &out, unsigned int value) {
+    write_field(out, to_string(value));
+}
+
+bool read_field(istream &in, string &value) {
+    size_t size = 0;
+    if (!(in >> noskipws >> size) || size > MAX_FIELD || in.get() != ':') {
+        return false;
+    }
+    value.resize(size);
+    if (size > 0 && !in.read(&value[0], size)) {
+        return false;
+    }
+    return in.get() == ',';
+}
+
+bool read_field(istream &in, unsigned int &value) {
+    string text;
+    if (!read_field(in, text)) {
+        return false;
+    }
+    value = strtoul(text.c_str(), nullptr, 10);
+    return true;
+}
+
+bool read_field(istream &in, bool &value) {
+    unsigned int number = 0;
+    if (!read_field(in, number)) {
+        return false;
+    }
+    value = number != 0;
+    return true;
+}
+
+void write_field(ostream &out, bool value) {
+    write_field(out, static_cast<unsigned int>(value));
+}
+
+template<typename Record>
+void write_fields(ostream &out, const Record &record);
+
+template<typename Record>
+bool read_fields(istream &in, Record &record);
+
+/**
+ * Each record is its schema fields in order, nested records inlined
+ */
+template<typename Record>
+struct FieldWriter {
+    ostream &out;
+    const Record &record;
+
+    template<typename Member>
+    void operator()(const char *, Member Record::*member) {
+        write_field(out, record.*member);
+    }
+
+    void operator()(const char *, Client::Owner Record::*member) {
+        write_fields(out, record.*member);
+    }
+};
+
+template<typename Record>
+struct FieldReader {
+    istream &in;
+    Record &record;
+    bool valid;
+
+    template<typename Member>
+    void operator()(const char *, Member Record::*member) {
+        valid = valid && read_field(in, record.*member);
+    }
+
+    void operator()(const char *, Client::Owner Record::*member) {
+        valid = valid && read_fields(in, record.*member);
+    }
+};
+
+template<typename Record>
+void write_fields(ostream &out, const Record &record) {
+    FieldWriter<Record> writer { out, record };
+    Schema<Record>::visit(writer);
+}
+
+template<typename Record>
+bool read_fields(istream &in, Record &record) {
+    FieldReader<Record> reader { in, record, true };
+    Schema<Record>::visit(reader);
+    return reader.valid;
+}
+
+void write_record(ostream &out, const Client::Repository &repository) {
+    write_fields(out, repository);
+    out << '\n';
+}
+
+bool read_record(istream &in, Client::Repository &repository) {
+    return read_fields(in, repository) && in.get() == '\n';
+}
+
+bool same(const Client::Repository &a, const Client::Repository &b) {
+    return same_fields(a, b);
+}
+
+}
+
+RepositoryIndex::RepositoryIndex(const string &path, size_t capacity) :
+    path_(path), capacity_(capacity), oldest_(0), dead_(0), compacting_(false), searches_(0),
+    compactions_(0), evictions_(0) {
+    load();
+    log_.open(path_, ios::out | ios::app | ios::binary);
+}
+
+RepositoryIndex::~RepositoryIndex() {
+    if (compactor_.joinable()) {
+        compactor_.join();
+    }
+}
+
+vector<string> RepositoryIndex::words(const string &text) {
+    // Lower case runs of letters and digits. Bytes of multi-byte UTF-8
+    // characters are kept as part of the word.
+    vector<string> result;
+    string word;
+    for (char c : text) {
+        unsigned char u = static_cast<unsigned char>(c);
+        if (isalnum(u) || u >= 0x80) {
+            word += static_cast<char>(tolower(u));
+        } else if (!word.empty()) {
+            result.emplace_back(move(word));
+            word.clear();
+        }
+    }
+    if (!word.empty()) {
+        result.emplace_back(move(word));
+    }
+    return result;
+}
+
+unsigned int RepositoryIndex::weight(uint8_t fields) {
+    return (fields & NAME ? NAME_WEIGHT : 0u) + (fields & OWNER ? OWNER_WEIGHT : 0u)
+            + (fields & LANGUAGE ? LANGUAGE_WEIGHT : 0u)
+            + (fields & DESCRIPTION ? DESCRIPTION_WEIGHT : 0u);
+}
+
+void RepositoryIndex::load() {
+    ifstream in(path_, ios::in | ios::binary);
+    if (!in) {
+        return;
+    }
+
+    lock_guard<mutex> lock(mutex_);
+    Client::Repository repository;
+    streamoff valid = 0;
+    while (read_record(in, repository)) {
+        insert(repository);
+        valid = in.tellg();
+    }
+    evict();
+
+    // Cut off a record left half written by a crash, so that the next
+    // ones are appended to a readable log
+    in.clear();
+    in.seekg(0, ios::end);
+    if (in.tellg() > valid) {
+        in.close();
+        if (truncate(path_.c_str(), valid) != 0) {
+            remove(path_.c_str());
+        }
+    }
+}
+
+void RepositoryIndex::insert(const Client::Repository &repository) {
+    auto known = by_name_.find(repository.full_name);
+    if (known != by_name_.end()) {
+        documents_[known->second].live = false;
+        ++dead_;
+    }
+
+    uint32_t id = documents_.size();
+    documents_.push_back(Document { repository, true });
+    by_name_[repository.full_name] = id;
+
+    unordered_map<string, uint8_t> fields;
+    for (const string &word : words(repository.full_name)) {
+        fields[word] |= NAME;
+    }
+    for (const string &word : words(repository.owner.login)) {
+        fields[word] |= OWNER;
+    }
+    for (const string &word : words(repository.language)) {
+        fields[word] |= LANGUAGE;
+    }
+    for (const string &word : words(repository.description)) {
+        fields[word] |= DESCRIPTION;
+    }
+    for (const auto &field : fields) {
+        postings_[field.first].push_back(Posting { id, field.second });
+    }
+}
+
+void RepositoryIndex::evict() {
+    // Documents are in the order they were last added, so the first live
+    // ones are those fetched longest ago
+    while (by_name_.size() > capacity_) {
+        Document &document = documents_[oldest_++];
+        if (!document.live) {
+            continue;
+        }
+        document.live = false;
+        by_name_.erase(document.repository.full_name);
+        ++dead_;
+        ++evictions_;
+    }
+}
+
+void RepositoryIndex::add(const Client::RepositoryList &repositories) {
+    lock_guard<mutex> lock(mutex_);
+    bool changed = false;
+    for (const Client::Repository &repository : repositories) {
+        auto known = by_name_.find(repository.full_name);
+        if (known != by_name_.end() && same(documents_[known->second].repository, repository)) {
+            continue;
+        }
+        insert(repository);
+        write_record(log_, repository);
+        if (compacting_) {
+            pending_.push_back(repository);
+        }
+        changed = true;
+    }
+    if (!changed) {
+        return;
+    }
+    log_.flush();
+    evict();
+
+    if (!compacting_ && needs_compaction()) {
+        // A previous compaction is over once compacting_ is false
+        if (compactor_.joinable()) {
+            compactor_.join();
+        }
+        compacting_ = true;
+        compactor_ = thread(&RepositoryIndex::compact, this);
+    }
+}
+
+bool RepositoryIndex::needs_compaction() const {
+    return dead_ >= MIN_DEAD && dead_ > by_name_.size();
+}
+
+void RepositoryIndex::compact() {
+    Client::RepositoryList live;
+    {
+        lock_guard<mutex> lock(mutex_);
+        for (const Document &document : documents_) {
+            if (document.live) {
+                live.push_back(document.repository);
+            }
+        }
+    }
+
+    // Write the bulk of the new log without blocking searches
+    string temporary = path_ + ".tmp";
+    bool written;
+    {
+        ofstream out(temporary, ios::out | ios::trunc | ios::binary);
+        for (const Client::Repository &repository : live) {
+            write_record(out, repository);
+        }
+        written = out.good();
+    }
+
+    lock_guard<mutex> lock(mutex_);
+    if (written) {
+        {
+            ofstream out(temporary, ios::out | ios::app | ios::binary);
+            for (const Client::Repository &repository : pending_) {
+                write_record(out, repository);
+            }
+            written = out.good();
+        }
+    }
+    if (written) {
+        log_.close();
+        written = rename(temporary.c_str(), path_.c_str()) == 0;
+        log_.open(path_, ios::out | ios::app | ios::binary);
+    }
+    if (written) {
+        rebuild();
+        ++compactions_;
+    } else {
+        remove(temporary.c_str());
+    }
+    pending_.clear();
+    compacting_ = false;
+}
+
+void RepositoryIndex::rebuild() {
+    vector<Document> documents;
+    documents.swap(documents_);
+    by_name_.clear();
+    postings_.clear();
+    oldest_ = 0;
+    dead_ = 0;
+
+    for (const Document &document : documents) {
+        if (document.live) {
+            insert(document.repository);
+        }
+    }
+}
+
+Client::RepositoryList RepositoryIndex::search(const string &query, size_t limit) {
+    vector<string> terms = words(query);
+    Client::RepositoryList result;
+    if (terms.empty() || limit == 0) {
+        return result;
+    }
+    ++searches_;
+
+    lock_guard<mutex> lock(mutex_);
+
+    // Keep the documents matching every term so far, with their score
+    unordered_map<uint32_t, unsigned int> scores;
+    for (size_t i = 0; i < terms.size(); ++i) {
+        unordered_map<uint32_t, unsigned int> matched;
+        auto consider = [&](const vector<Posting> &postings) {
+            for (const Posting &posting : postings) {
+                if (!documents_[posting.document].live) {
+                    continue;
+                }
+                unsigned int previous = 0;
+                if (i > 0) {
+                    auto it = scores.find(posting.document);
+                    if (it == scores.end()) {
+                        continue;
+                    }
+                    previous = it->second;
+                }
+                unsigned int &score = matched[posting.document];
+                score = max(score, previous + weight(posting.fields));
+            }
+        };
+
+        const string &term = terms[i];
+        if (i + 1 == terms.size()) {
+            // The word being typed: anything it is a prefix of
+            for (auto it = postings_.lower_bound(term);
+                 it != postings_.end() && it->first.compare(0, term.size(), term) == 0;
+                 ++it) {
+                consider(it->second);
+            }
+        } else {
+            auto it = postings_.find(term);
+            if (it != postings_.end()) {
+                consider(it->second);
+            }
+        }
+
+        scores.swap(matched);
+        if (scores.empty()) {
+            return result;
+        }
+    }
+
+    // Best matches first, then the most popular
+    vector<pair<uint32_t, unsigned int>> ranked(scores.begin(), scores.end());
+    auto better = [this](const pair<uint32_t, unsigned int> &a,
+                         const pair<uint32_t, unsigned int> &b) {
+        if (a.second != b.second) {
+            return a.second > b.second;
+        }
+        return documents_[a.first].repository.stargazers_count
+                > documents_[b.first].repository.stargazers_count;
+    };
+    size_t count = min(limit, ranked.size());
+    partial_sort(ranked.begin(), ranked.begin() + count, ranked.end(), better);
+
+    for (size_t i = 0; i < count; ++i) {
+        result.push_back(documents_[ranked[i].first].repository);
+    }
+    return result;
+}
+
+RepositoryIndex::Stats RepositoryIndex::stats() const {
+    lock_guard<mutex> lock(mutex_);
+    return Stats { by_name_.size(), searches_, compactions_, evictions_ };
+}
@@ -0,0 +1,102 @@
+#include <scope/result_cache.h>
+
+using namespace std;
+using namespace api;
+using namespace scope;
+
+namespace {
+
+size_t size_of(const Client::Owner &owner) {
+    return sizeof(owner) + owner.login.capacity() + owner.avatar_url.capacity()
+            + owner.url.capacity();
+}
+
+size_t size_of(const Client::Repository &repository) {
+    return sizeof(repository) - sizeof(repository.owner) + size_of(repository.owner)
+            + repository.name.capacity() + repository.full_name.capacity()
+            + repository.description.capacity() + repository.html_url.capacity()
+            + repository.language.capacity() + repository.created_at.capacity()
+            + repository.pushed_at.capacity();
+}
+
+size_t size_of(const Client::Code &code) {
+    return sizeof(code) - sizeof(code.repository) + size_of(code.repository)
+            + code.name.capacity() + code.path.capacity() + code.html_url.capacity();
+}
+
+size_t size_of(const Client::User &user) {
+    return sizeof(user) + user.login.capacity() + user.avatar_url.capacity() + user.html_url.capacity()
+            + user.followers_url.capacity() + user.following_url.capacity()
+            + user.gists_url.capacity() + user.starred_url.capacity()
+            + user.organizations_url.capacity() + user.repos_url.capacity()
+            + user.name.capacity() + user.company.capacity() + user.blog.capacity()
+            + user.location.capacity() + user.email.capacity() + user.bio.capacity();
+}
+
+size_t size_of_repositories(const Client::RepositoryRes &res) {
+    size_t bytes = sizeof(res);
+    for (const auto &repository : res.repositories) {
+        bytes += size_of(repository);
+    }
+    return bytes;
+}
+
+size_t size_of_code(const Client::CodeRes &res) {
+    size_t bytes = sizeof(res);
+    for (const auto &code : res.codes) {
+        bytes += size_of(code);
+    }
+    return bytes;
+}
+
+size_t size_of_users(const Client::UserRes &res) {
+    size_t bytes = sizeof(res);
+    for (const auto &user : res.users) {
+        bytes += size_of(user);
+    }
+    return bytes;
+}
+
+size_t size_of_profile(const Client::User &user) {
+    return size_of(user);
+}
+
+size_t size_of_details(const Client::Details &details) {
+    size_t bytes = sizeof(details) + details.readme.capacity()
+            + details.latest_release.capacity();
+    for (const auto &language : details.languages) {
+        bytes += sizeof(language) + language.first.capacity();
+    }
+    for (const auto &contributor : details.contributors) {
+        bytes += sizeof(contributor) + contributor.first.capacity();
+    }
+    return bytes;
+}
+
+}
+
+ResultCache::ResultCache(size_t budget, chrono::seconds ttl) :
+    repositories(budget, ttl, size_of_repositories),
+    code(budget, ttl, size_of_code),
+    users(budget, ttl, size_of_users),
+    details(budget, ttl, size_of_details),
+    profiles(budget, ttl, size_of_profile) {
+}
+
+string ResultCache::key(const string &query, bool name, bool description,
+                        bool readme, size_t limit) {
+    // The flags and the limit change the search, so they are part of the key
+    string flags;
+    flags += name ? 'n' : '-';
+    flags += description ? 'd' : '-';
+    flags += readme ? 'r' : '-';
+    return flags + to_string(limit) + ":" + query;
+}
+
+string ResultCache::key(const string &query, const string &repo) {
+    return repo + ":" + query;
+}
+
+string ResultCache::key(const string &query) {
+    return query;
+}
@@ -1,3 +1,9 @@
+#include <api/connection_pool.h>
+#include <api/latency_tracker.h>
+#include <api/metrics.h>
+#include <api/rate_limiter.h>
+#include <api/response_cache.h>
+#include <api/tracer.h>
 #include <scope/localization.h>
 #include <scope/preview.h>
 #include <scope/query.h>
@@ -25,23 +31,197 @@ void Scope::start(string const&) {
     if (apiroot) {
         config_->apiroot = apiroot;
     }
+
+    // A token raises the rate limits, and is required by the GraphQL API
+    char *token = getenv("NETWORK_SCOPE_TOKEN");
+    if (token) {
+        config_->access_token = token;
+        config_->search_requests_per_minute = 30;
+        config_->core_requests_per_hour = 5000;
+    }
+    char *backend = getenv("NETWORK_SCOPE_BACKEND");
+    if (backend && string(backend) == "graphql") {
+        config_->backend = Config::Backend::graphql;
+    }
+
+    // Keep connections to the API warm across queries
+    config_->pool = make_shared<ConnectionPool>(config_->max_connections_per_host,
+                                                config_->keep_alive);
+
+    // Revalidate repeated requests instead of downloading them again
+    config_->response_cache = make_shared<ResponseCache>(cache_directory() + "/responses");
+
+    // Stay within the API budget, serving cached responses when it runs out
+    config_->rate_limiter = make_shared<RateLimiter>(config_->search_requests_per_minute,
+                                                     config_->core_requests_per_hour,
+                                                     config_->max_rate_limit_wait);
+
+    // Learn the usual response times, to duplicate requests that are slower
+    config_->latency = make_shared<LatencyTracker>();
+
+    // Record where the time goes, for chrome://tracing or Perfetto. The
+    // variable names the file, or is "1" for one in the cache directory.
+    char *trace = getenv("NETWORK_SCOPE_TRACE");
+    if (trace && *trace) {
+        tracePath_ = string(trace) == "1" ? cache_directory() + "/trace.json" : trace;
+        config_->tracer = make_shared<Tracer>();
+    }
+
+    // What each cache and service did, printed when the scope stops
+    char *stats = getenv("NETWORK_SCOPE_STATS");
+    printStats_ = stats && *stats;
+
+    // Latency percentiles and counters are always kept, and written to
+    // the cache directory every minute
+    config_->metrics = make_shared<Metrics>();
+    metricsWriter_ = make_shared<MetricsWriter>(config_->metrics,
+                                                cache_directory() + "/metrics.json");
+
+    // Everything that is the same for every query is built once
+    renderers_ = make_shared<Renderers>();
+    settingsSnapshot_ = make_shared<SettingsSnapshot>();
+
+    // Read what we showed last time once, rather than for every query
+    stateSnapshot_ = make_shared<StateSnapshot>(cache_directory() + "/state.bin");
+
+    // Answer repeated searches from memory for a few minutes
+    resultCache_ = make_shared<ResultCache>(8 * 1024 * 1024, chrono::minutes(5));
+
+    // Send identical concurrent searches only once
+    repositoryFlights_ = make_shared<RepositoryFlights>();
+    codeFlights_ = make_shared<CodeFlights>();
+
+    // Answer from the repositories we have seen before, even offline
+    repositoryIndex_ = make_shared<RepositoryIndex>(cache_directory() + "/repositories.log");
+
+    // Keep avatars at the size of a medium card, which is what the
+    // repository template uses
+    avatarCache_ = make_shared<AvatarCache>(config_, cache_directory() + "/avatars",
+                                            16 * 1024 * 1024, 128);
+
+    // Have the previews of the first results ready before they are opened
+    prefetcher_ = make_shared<Prefetcher>(config_, resultCache_);
+
+    // Complete the users found with their profiles, a few at a time
+    userHydrator_ = make_shared<UserHydrator>(config_, resultCache_);
 }
 
 void Scope::stop() {
+    if (printStats_) {
+        printStats();
+    }
+
+    // Stop everything that works in the background first: the services
+    // below are still in use until their threads are joined
+    prefetcher_.reset();
+    userHydrator_.reset();
+    avatarCache_.reset();
+
+    // Writes the final numbers
+    metricsWriter_.reset();
+
+    if (config_ && config_->tracer) {
+        if (config_->tracer->write(tracePath_)) {
+            cerr << "trace: written to " << tracePath_ << endl;
+        } else {
+            cerr << "trace: could not write " << tracePath_ << endl;
+        }
+    }
+
+    // Requests still in flight, such as losing hedges, hold on to the
+    // configuration themselves, so it is never changed under them
+    config_.reset();
+}
+
+void Scope::printStats() const {
+    if (prefetcher_) {
+        Prefetcher::Stats stats = prefetcher_->stats();
+        cerr << "previews: " << stats.fetched << " prefetched, " << stats.cached
+             << " already cached, " << stats.dropped << " dropped" << endl;
+    }
+    if (userHydrator_) {
+        UserHydrator::Stats stats = userHydrator_->stats();
+        cerr << "profiles: " << stats.hydrated << " fetched, " << stats.cached
+             << " already cached, " << stats.dropped << " dropped" << endl;
+    }
+    if (avatarCache_) {
+        AvatarCache::Stats stats = avatarCache_->stats();
+        cerr << "avatars: " << stats.hits << " local, " << stats.misses
+             << " remote, " << stats.downloads << " downloaded, "
+             << stats.evictions << " evicted, " << stats.revalidations
+             << " revalidated" << endl;
+    }
+    if (config_ && config_->pool) {
+        ConnectionPool::Stats stats = config_->pool->stats();
+        cerr << "connections: about " << stats.estimated_handshakes << " handshakes and "
+             << stats.estimated_reuses << " reuses, " << stats.waits << " waits" << endl;
+    }
+    if (config_ && config_->response_cache) {
+        ResponseCache::Stats stats = config_->response_cache->stats();
+        cerr << "response cache: " << stats.hits << " hits, " << stats.misses
+             << " misses, " << stats.revalidations << " revalidations, "
+             << stats.bytes_saved << " bytes saved, " << stats.stale
+             << " served stale, " << stats.evictions << " evicted" << endl;
+    }
+    if (config_ && config_->rate_limiter) {
+        RateLimiter::Stats stats = config_->rate_limiter->stats();
+        cerr << "rate limit: " << stats.granted << " granted, " << stats.waited
+             << " waited, " << stats.dropped << " dropped, " << stats.exhausted
+             << " exhausted" << endl;
+    }
+    if (config_ && config_->latency) {
+        LatencyTracker::Stats stats = config_->latency->stats();
+        cerr << "latency: " << stats.samples << " samples, " << stats.hedges
+             << " hedges, " << stats.hedge_wins << " won by the hedge, "
+             << stats.retries << " retries" << endl;
+    }
+    if (resultCache_) {
+        auto stats = resultCache_->repositories.stats();
+        cerr << "result cache: " << stats.hits << " hits, " << stats.misses
+             << " misses, " << stats.evictions << " evictions, "
+             << stats.expirations << " expirations" << endl;
+    }
+    if (repositoryFlights_) {
+        auto stats = repositoryFlights_->stats();
+        cerr << "searches: " << stats.started << " sent, " << stats.saved
+             << " saved by sharing, " << stats.abandoned << " abandoned" << endl;
+    }
+    if (codeFlights_) {
+        auto stats = codeFlights_->stats();
+        cerr << "code searches: " << stats.started << " sent, " << stats.saved
+             << " saved by sharing, " << stats.abandoned << " abandoned" << endl;
+    }
+    if (repositoryIndex_) {
+        RepositoryIndex::Stats stats = repositoryIndex_->stats();
+        cerr << "repository index: " << stats.repositories << " repositories, "
+             << stats.searches << " searches, " << stats.compactions
+             << " compactions, " << stats.evictions << " evictions" << endl;
+    }
 }
 
 sc::SearchQueryBase::UPtr Scope::search(const sc::CannedQuery &query,
                                         const sc::SearchMetadata &metadata) {
     // Boilerplate construction of Query
     Query *q = new Query(query, metadata, config_);
-    q->setCachePath(cache_directory() + "/cache.ini");
+    q->setStateSnapshot(stateSnapshot_);
+    q->setRenderers(renderers_);
+    q->setSettingsSnapshot(settingsSnapshot_);
+    q->setResultCache(resultCache_);
+    q->setRepositoryFlights(repositoryFlights_);
+    q->setCodeFlights(codeFlights_);
+    q->setRepositoryIndex(repositoryIndex_);
+    q->setAvatarCache(avatarCache_);
+    q->setPrefetcher(prefetcher_);
+    q->setUserHydrator(userHydrator_);
     return sc::SearchQueryBase::UPtr(q);
 }
 
 sc::PreviewQueryBase::UPtr Scope::preview(sc::Result const& result,
                                           sc::ActionMetadata const& metadata) {
     // Boilerplate construction of Preview
-    return sc::PreviewQueryBase::UPtr(new Preview(result, metadata));
+    Preview *p = new Preview(result, metadata, config_);
+    p->setResultCache(resultCache_);
+    return sc::PreviewQueryBase::UPtr(p);
 }
 
 #define EXPORT __attribute__ ((visibility ("default")))
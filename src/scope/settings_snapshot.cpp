@@ -0,0 +1,90 @@
+#include <scope/settings_snapshot.h>
+
+namespace sc = unity::scopes;
+
+using namespace std;
+using namespace scope;
+
+namespace {
+
+/**
+ * The settings the scope reads, as named in the settings ini file
+ */
+enum Key {
+    SEARCH_NAME,
+    SEARCH_DESCRIPTION,
+    SEARCH_README,
+    RESULT_LIMIT,
+    KEYS
+};
+
+const char *const KEY_NAMES[KEYS] = {
+    "searchName",
+    "searchDescription",
+    "searchReadme",
+    "resultLimit"
+};
+
+const sc::Variant &value(const sc::VariantMap &settings, Key key) {
+    static const sc::Variant missing;
+    auto it = settings.find(KEY_NAMES[key]);
+    return it == settings.end() ? missing : it->second;
+}
+
+bool flag(const sc::VariantMap &settings, Key key) {
+    const sc::Variant &v = value(settings, key);
+    return v.which() == sc::Variant::Type::Bool ? v.get_bool() : true;
+}
+
+}
+
+/**
+ * The settings parsed from the values they were parsed from
+ */
+struct SettingsSnapshot::Version {
+    sc::Variant values[KEYS];
+    Settings settings;
+
+    bool matches(const sc::VariantMap &raw) const {
+        for (int key = 0; key < KEYS; ++key) {
+            if (!(value(raw, static_cast<Key>(key)) == values[key])) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+Settings Settings::parse(const sc::VariantMap &settings) {
+    Settings result;
+    result.name = flag(settings, SEARCH_NAME);
+    result.description = flag(settings, SEARCH_DESCRIPTION);
+    result.readme = flag(settings, SEARCH_README);
+
+    // Number settings may come back as either int or double
+    const sc::Variant &limit = value(settings, RESULT_LIMIT);
+    int count = 30;
+    if (limit.which() == sc::Variant::Type::Int) {
+        count = limit.get_int();
+    } else if (limit.which() == sc::Variant::Type::Double) {
+        count = static_cast<int>(limit.get_double());
+    }
+    result.limit = count > 0 ? count : 30;
+    return result;
+}
+
+shared_ptr<const Settings> SettingsSnapshot::get(const sc::VariantMap &raw) {
+    shared_ptr<const Version> current = atomic_load(&current_);
+    if (!current || !current->matches(raw)) {
+        // Concurrent queries with new settings may each parse them, the
+        // last one to finish stays
+        auto version = make_shared<Version>();
+        for (int key = 0; key < KEYS; ++key) {
+            version->values[key] = value(raw, static_cast<Key>(key));
+        }
+        version->settings = Settings::parse(raw);
+        atomic_store(&current_, shared_ptr<const Version>(version));
+        current = version;
+    }
+    return shared_ptr<const Settings>(current, &current->settings);
+}
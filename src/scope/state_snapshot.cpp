@@ -0,0 +1,325 @@
+#include <scope/state_snapshot.h>
+
+#include <api/schema.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace api;
+using namespace scope;
+
+namespace {
+
+/**
+ * Identifies the file and the layout version
+ */
+const char MAGIC[4] = { 'G', 'H', 'S', '1' };
+
+/**
+ * Appends fields in the snapshot layout: integers as 4 bytes in host
+ * order, strings as their length followed by their bytes, records as
+ * their schema fields
+ */
+class Writer {
+public:
+    void field(uint32_t value) {
+        data_.append(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    void field(bool value) {
+        data_ += value ? '\1' : '\0';
+    }
+
+    void field(const string &value) {
+        field(static_cast<uint32_t>(value.size()));
+        data_ += value;
+    }
+
+    /**
+     * Every field of the record's schema, in order
+     */
+    template<typename Record>
+    void record(const Record &value) {
+        Fields<Record> fields { *this, value };
+        Schema<Record>::visit(fields);
+    }
+
+    const string &data() const {
+        return data_;
+    }
+
+private:
+    template<typename Record>
+    struct Fields {
+        Writer &writer;
+        const Record &value;
+
+        template<typename Member>
+        void operator()(const char *, Member Record::*member) {
+            writer.store(value.*member);
+        }
+    };
+
+    void store(unsigned int value) {
+        field(static_cast<uint32_t>(value));
+    }
+
+    void store(bool value) {
+        field(value);
+    }
+
+    void store(const string &value) {
+        field(value);
+    }
+
+    template<typename Nested>
+    void store(const Nested &value) {
+        record(value);
+    }
+
+    string data_;
+};
+
+/**
+ * Reads fields back out of the mapped file, failing instead of reading
+ * past its end
+ */
+class Reader {
+public:
+    Reader(const char *begin, const char *end) :
+        position_(begin), end_(end) {
+    }
+
+    bool field(uint32_t &value) {
+        if (static_cast<size_t>(end_ - position_) < sizeof(value)) {
+            return false;
+        }
+        memcpy(&value, position_, sizeof(value));
+        position_ += sizeof(value);
+        return true;
+    }
+
+    bool field(bool &value) {
+        if (position_ == end_) {
+            return false;
+        }
+        value = *position_++ != 0;
+        return true;
+    }
+
+    bool field(string &value) {
+        uint32_t size = 0;
+        if (!field(size) || static_cast<size_t>(end_ - position_) < size) {
+            return false;
+        }
+        value.assign(position_, size);
+        position_ += size;
+        return true;
+    }
+
+    template<typename Record>
+    bool record(Record &value) {
+        Fields<Record> fields { *this, value, true };
+        Schema<Record>::visit(fields);
+        return fields.valid;
+    }
+
+    bool magic() {
+        if (static_cast<size_t>(end_ - position_) < sizeof(MAGIC)
+                || memcmp(position_, MAGIC, sizeof(MAGIC)) != 0) {
+            return false;
+        }
+        position_ += sizeof(MAGIC);
+        return true;
+    }
+
+private:
+    template<typename Record>
+    struct Fields {
+        Reader &reader;
+        Record &value;
+        bool valid;
+
+        template<typename Member>
+        void operator()(const char *, Member Record::*member) {
+            valid = valid && reader.load(value.*member);
+        }
+    };
+
+    bool load(unsigned int &value) {
+        uint32_t read = 0;
+        if (!field(read)) {
+            return false;
+        }
+        value = read;
+        return true;
+    }
+
+    bool load(bool &value) {
+        return field(value);
+    }
+
+    bool load(string &value) {
+        return field(value);
+    }
+
+    template<typename Nested>
+    bool load(Nested &value) {
+        return record(value);
+    }
+
+    const char *position_;
+    const char *end_;
+};
+
+string encode(const StateSnapshot::State &state) {
+    Writer writer;
+    writer.field(state.query);
+    writer.field(state.repo);
+    writer.field(static_cast<uint32_t>(state.repositories.size()));
+    for (const auto &repository : state.repositories) {
+        writer.record(repository);
+    }
+    return string(MAGIC, sizeof(MAGIC)) + writer.data();
+}
+
+}
+
+StateSnapshot::StateSnapshot(const string &path, chrono::milliseconds delay) :
+    path_(path), delay_(delay), state_(make_shared<State>()), dirty_(false),
+    stopping_(false) {
+    load();
+    encoded_ = encode(*state_);
+    worker_ = thread(&StateSnapshot::work, this);
+}
+
+StateSnapshot::~StateSnapshot() {
+    {
+        lock_guard<mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    worker_.join();
+
+    // The last update may still be waiting
+    if (dirty_) {
+        save(encoded_);
+    }
+}
+
+shared_ptr<const StateSnapshot::State> StateSnapshot::state() const {
+    lock_guard<mutex> lock(mutex_);
+    return state_;
+}
+
+void StateSnapshot::update(const State &state) {
+    string encoded = encode(state);
+    auto updated = make_shared<State>(state);
+    {
+        lock_guard<mutex> lock(mutex_);
+        if (encoded == encoded_) {
+            return;
+        }
+        state_ = updated;
+        encoded_ = move(encoded);
+        dirty_ = true;
+        updated_ = chrono::steady_clock::now();
+    }
+    wake_.notify_one();
+}
+
+void StateSnapshot::work() {
+    unique_lock<mutex> lock(mutex_);
+    for (;;) {
+        wake_.wait(lock, [this]() { return stopping_ || dirty_; });
+        if (stopping_) {
+            return;
+        }
+
+        // Wait for the user to stop typing, every update starts over
+        auto due = updated_ + delay_;
+        if (chrono::steady_clock::now() < due) {
+            wake_.wait_until(lock, due, [this]() { return stopping_; });
+            continue;
+        }
+
+        // Only this thread writes until it is joined
+        string data = encoded_;
+        dirty_ = false;
+        lock.unlock();
+        save(data);
+        lock.lock();
+    }
+}
+
+void StateSnapshot::load() {
+    int fd = open(path_.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return;
+    }
+    size_t size = st.st_size;
+    void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapped == MAP_FAILED) {
+        return;
+    }
+
+    const char *data = static_cast<const char *>(mapped);
+    Reader reader(data, data + size);
+    auto state = make_shared<State>();
+    uint32_t count = 0;
+    bool valid = reader.magic() && reader.field(state->query) && reader.field(state->repo)
+            && reader.field(count);
+    for (uint32_t i = 0; valid && i < count; ++i) {
+        state->repositories.emplace_back();
+        valid = reader.record(state->repositories.back());
+    }
+    munmap(mapped, size);
+
+    if (valid) {
+        lock_guard<mutex> lock(mutex_);
+        state_ = state;
+    }
+}
+
+bool StateSnapshot::save(const string &data) const {
+    // Write next to the final file, so it is replaced all at once. The
+    // data has to be on disk before the rename, or a crash could leave
+    // an empty file behind the new name.
+    string temporary = path_ + ".tmp";
+    int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        return false;
+    }
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t result = write(fd, data.data() + written, data.size() - written);
+        if (result < 0) {
+            break;
+        }
+        written += result;
+    }
+    if (written < data.size() || fsync(fd) != 0) {
+        close(fd);
+        remove(temporary.c_str());
+        return false;
+    }
+    close(fd);
+    if (rename(temporary.c_str(), path_.c_str()) != 0) {
+        remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,49 @@
+#include <scope/user_hydrator.h>
+
+using namespace std;
+using namespace api;
+using namespace scope;
+
+UserHydrator::UserHydrator(Config::Ptr config, ResultCache::Ptr cache,
+                           size_t parallelism, size_t capacity) :
+    cache_(cache), client_(Client::create(config)), hydrated_(0), cached_(0),
+    queue_(capacity, parallelism,
+           [](const Client::User &user) { return user.id; },
+           [this](const Client::User &stub, const CancellationToken &stop) {
+               fetch(stub, stop);
+           }) {
+    client_->setPriority(RateLimiter::Priority::background);
+}
+
+shared_ptr<const Client::User> UserHydrator::profile(unsigned int id) const {
+    return cache_->profiles.get(to_string(id));
+}
+
+void UserHydrator::hydrate(const vector<Client::User> &stubs) {
+    queue_.push(stubs);
+}
+
+void UserHydrator::fetch(const Client::User &stub, const CancellationToken &stop) {
+    string key = to_string(stub.id);
+    if (cache_->profiles.get(key)) {
+        ++cached_;
+        return;
+    }
+
+    try {
+        auto user = client_->user(stub.login, stop);
+
+        // A missing id usually means the rate limiter held us back,
+        // let a later search try again
+        if (!stop.cancelled() && user.id == stub.id) {
+            cache_->profiles.put(key, make_shared<Client::User>(move(user)));
+            ++hydrated_;
+        }
+    } catch (exception &) {
+        // Hydrating is best effort, the stub is still shown
+    }
+}
+
+UserHydrator::Stats UserHydrator::stats() const {
+    return Stats { hydrated_, cached_, queue_.dropped() };
+}
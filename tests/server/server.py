@@ -1,11 +1,53 @@
 #!/usr/bin/env python3
 
+import argparse
+import base64
+import gzip
+import hashlib
 import http.server
+import json
 import os
+import random
 import socketserver
 import sys
+import threading
+import time
+import zlib
 from urllib.parse import urlparse,parse_qs
 
+# The server stands in for the parts of the GitHub API the scope uses.
+# Everything it returns is generated from the item's index, so any corpus
+# size gives the same answers from one run to the next. The options make
+# it slow, flaky or stingy the way the real API can be:
+#
+#   --corpus 10000                 items matching every search
+#   --latency fixed:50             milliseconds added to each response,
+#             uniform:10:200       also drawn uniformly,
+#             lognormal:40:0.5     or around a median with a spread
+#   --error-rate 0.05              share of API requests answered with
+#   --error-status 502             this status instead
+#   --rate-limit 30:5000           search requests per minute and core
+#                                  requests per hour, reported in the
+#                                  X-RateLimit headers and enforced
+#   --seed 1                       for the latency and errors drawn
+#
+# Responses carry an ETag and answer If-None-Match with a 304, and are
+# compressed when the client accepts it.
+
+def parse_options(argv):
+    parser = argparse.ArgumentParser(description='Fake GitHub API server')
+    parser.add_argument('--corpus', type=int, default=1000)
+    parser.add_argument('--latency', default='fixed:0')
+    parser.add_argument('--error-rate', type=float, default=0.0)
+    parser.add_argument('--error-status', type=int, default=502)
+    parser.add_argument('--rate-limit', default=None)
+    parser.add_argument('--seed', type=int, default=0)
+    return parser.parse_args(argv)
+
+options = parse_options([])
+rng = random.Random(0)
+rng_lock = threading.Lock()
+
 def read_file(path):
     file = os.path.join(os.path.dirname(__file__), path)
     if os.path.isfile(file):
@@ -16,48 +58,419 @@ def read_file(path):
 
     return content
 
+def page_range(page, per_page):
+    # The indices of one page, GitHub style, within the corpus
+    start = min((page - 1) * per_page, options.corpus)
+    return range(start, min(start + per_page, options.corpus))
+
+def search_page(items):
+    return json.dumps({
+        'total_count': options.corpus,
+        'incomplete_results': False,
+        'items': items
+    }, indent=2)
+
+def owner(i):
+    login = 'user%d' % (i % 17)
+    return {
+        'login': login,
+        'id': 100 + i % 17,
+        'avatar_url': 'https://avatars.githubusercontent.com/u/%d?v=3' % (100 + i % 17),
+        'url': 'https://api.github.com/users/%s' % login,
+        'html_url': 'https://github.com/%s' % login,
+        'type': 'User',
+        'site_admin': False
+    }
+
+def repository(q, i):
+    # A deterministic repository that looks like GitHub's, owner block included
+    login = owner(i)['login']
+    return {
+        'id': 1000 + i,
+        'name': '%s-%d' % (q, i),
+        'full_name': '%s/%s-%d' % (login, q, i),
+        'owner': owner(i),
+        'private': False,
+        'html_url': 'https://github.com/%s/%s-%d' % (login, q, i),
+        'description': 'A %s project, number %d of the search results' % (q, i),
+        'fork': i % 5 == 0,
+        'created_at': '2014-06-%02dT12:00:00Z' % (1 + i % 28),
+        'updated_at': '2015-08-%02dT12:00:00Z' % (1 + i % 28),
+        'pushed_at': '2015-08-%02dT12:00:00Z' % (1 + i % 28),
+        'size': 100 * i,
+        'stargazers_count': 1000 - i,
+        'watchers_count': 1000 - i,
+        'language': ['C++', 'Python', 'JavaScript', 'Go'][i % 4],
+        'forks_count': i % 50,
+        'open_issues_count': i % 7,
+        'score': 100.0 / (i + 1)
+    }
+
+def find_repository(owner_login, name):
+    # Repositories are named after the search that found them: "<q>-<i>"
+    q, _, index = name.rpartition('-')
+    if not q or not index.isdigit() or int(index) >= options.corpus:
+        return None
+    item = repository(q, int(index))
+    return item if item['owner']['login'] == owner_login else None
+
+def search_repositories(q, page, per_page):
+    return search_page([repository(q, i) for i in page_range(page, per_page)])
+
+def search_code(q, repo, page, per_page):
+    # Files of the repository searched in, any of them matching
+    owner_login, _, name = repo.partition('/')
+    item = find_repository(owner_login, name) or repository(q, 0)
+    items = []
+    for i in page_range(page, per_page):
+        path = 'src/%s/file%d.cpp' % (q, i)
+        items.append({
+            'name': 'file%d.cpp' % i,
+            'path': path,
+            'sha': hashlib.sha1(path.encode('UTF-8')).hexdigest(),
+            'url': 'https://api.github.com/repositories/%d/contents/%s' % (item['id'], path),
+            'html_url': '%s/blob/master/%s' % (item['html_url'], path),
+            'repository': item,
+            'score': 100.0 / (i + 1)
+        })
+    return search_page(items)
+
+def user(i):
+    # A deterministic full profile, as returned by /users/:login
+    login = 'user%d' % i
+    return {
+        'login': login,
+        'id': 100 + i,
+        'avatar_url': 'https://avatars.githubusercontent.com/u/%d?v=3' % (100 + i),
+        'url': 'https://api.github.com/users/%s' % login,
+        'html_url': 'https://github.com/%s' % login,
+        'type': 'User',
+        'name': 'User %d' % i,
+        'company': 'Company %d' % (i % 5),
+        'blog': 'https://%s.example.com' % login,
+        'location': 'City %d' % (i % 11),
+        'email': '%s@example.com' % login,
+        'hireable': i % 2 == 0,
+        'bio': 'Writes code, number %d' % i,
+        'public_repos': 10 + i,
+        'public_gists': i % 9,
+        'followers': 1000 - i,
+        'following': i % 30
+    }
+
+def find_user(login):
+    index = login[len('user'):]
+    if not login.startswith('user') or not index.isdigit() or int(index) >= options.corpus:
+        return None
+    return user(int(index))
+
+def search_users(q, page, per_page):
+    # Like GitHub, searches only return the start of each profile
+    keys = ['login', 'id', 'avatar_url', 'url', 'html_url', 'type']
+    items = []
+    for i in page_range(page, per_page):
+        profile = user(i)
+        items.append({key: profile[key] for key in keys})
+    return search_page(items)
+
+def readme(item):
+    text = '# %s\n\n%s.\n\nA project used by the tests.\n' % (item['name'], item['description'])
+    return {
+        'name': 'README.md',
+        'path': 'README.md',
+        'encoding': 'base64',
+        'content': base64.encodebytes(text.encode('UTF-8')).decode('ascii')
+    }
+
+def languages(item):
+    return {'C++': 8000, 'Python': 2000}
+
+def latest_release(item):
+    return {'tag_name': 'v1.%d' % (item['id'] % 10), 'name': 'Release'}
+
+def contributors(item, per_page):
+    return [{'login': 'user%d' % i, 'contributions': 100 - i} for i in range(min(per_page, 30))]
+
+def graphql(request):
+    # Enough of GitHub's GraphQL API for the scope's own queries, answered
+    # under the aliases they use
+    query = request.get('query', '')
+    variables = request.get('variables', {})
+
+    def graphql_user(profile):
+        return {
+            'id': profile['id'],
+            'login': profile['login'],
+            'avatar_url': profile['avatar_url'],
+            'html_url': profile['html_url'],
+            'name': profile['name'],
+            'company': profile['company'],
+            'blog': profile['blog'],
+            'location': profile['location'],
+            'email': profile['email'],
+            'hireable': profile['hireable'],
+            'bio': profile['bio'],
+            'followers': {'totalCount': profile['followers']},
+            'following': {'totalCount': profile['following']},
+            'repositories': {'totalCount': profile['public_repos']},
+            'gists': {'totalCount': profile['public_gists']}
+        }
+
+    if 'type: REPOSITORY' in query:
+        first = variables.get('first', 30)
+        start = int(variables.get('after') or 0)
+        q = variables.get('q', '').split(' ')[0]
+        nodes = []
+        for i in range(start, min(start + first, options.corpus)):
+            item = repository(q, i)
+            nodes.append({
+                'name': item['name'],
+                'full_name': item['full_name'],
+                'description': item['description'],
+                'private': item['private'],
+                'fork': item['fork'],
+                'html_url': item['html_url'],
+                'forks_count': item['forks_count'],
+                'stargazers_count': item['stargazers_count'],
+                'created_at': item['created_at'],
+                'pushed_at': item['pushed_at'],
+                'primaryLanguage': {'name': item['language']},
+                'watchers': {'totalCount': item['watchers_count']},
+                'issues': {'totalCount': item['open_issues_count']},
+                'owner': {
+                    'login': item['owner']['login'],
+                    'avatar_url': item['owner']['avatar_url'],
+                    'html_url': item['owner']['html_url'],
+                    'id': item['owner']['id']
+                }
+            })
+        data = {'search': {
+            'repositoryCount': options.corpus,
+            'pageInfo': {'hasNextPage': start + first < options.corpus,
+                         'endCursor': str(start + first)},
+            'nodes': nodes
+        }}
+    elif 'type: USER' in query:
+        data = {'search': {
+            'userCount': options.corpus,
+            'nodes': [graphql_user(user(i))
+                      for i in range(min(variables.get('first', 30), options.corpus))]
+        }}
+    elif 'user(login' in query:
+        profile = find_user(variables.get('login', ''))
+        data = {'user': graphql_user(profile) if profile else None}
+    elif 'repository(owner' in query:
+        data = {'repository': {
+            'readme': {'text': '# %s\n\nA project used by the tests.' % variables.get('name', '')},
+            'languages': {'edges': [
+                {'size': 8000, 'node': {'name': 'C++'}},
+                {'size': 2000, 'node': {'name': 'Python'}}
+            ]},
+            'latestRelease': {'tagName': 'v1.0'}
+        }}
+    else:
+        return json.dumps({'errors': [{'message': 'Unsupported query'}]})
+    return json.dumps({'data': data})
+
+def encode(body, accept_encoding):
+    # Compress the way the client asked for, preferring gzip like GitHub does
+    accepted = [e.strip() for e in accept_encoding.split(',')]
+    if 'gzip' in accepted:
+        return gzip.compress(body), 'gzip'
+    if 'deflate' in accepted:
+        return zlib.compress(body), 'deflate'
+    return body, None
+
+def latency():
+    # Seconds to wait before answering, drawn from the --latency distribution
+    kind, _, parameters = options.latency.partition(':')
+    values = [float(v) for v in parameters.split(':') if v]
+    with rng_lock:
+        if kind == 'uniform':
+            milliseconds = rng.uniform(values[0], values[1])
+        elif kind == 'lognormal':
+            milliseconds = values[0] * rng.lognormvariate(0.0, values[1])
+        else:
+            milliseconds = values[0] if values else 0.0
+    return milliseconds / 1000.0
+
+def failing():
+    if options.error_rate <= 0:
+        return False
+    with rng_lock:
+        return rng.random() < options.error_rate
+
+class RateLimit:
+    # GitHub's fixed windows: searches per minute, everything else per hour
+    WINDOWS = {'search': 60, 'core': 3600}
+
+    def __init__(self, spec):
+        self.limits = None
+        if spec:
+            search, core = spec.split(':')
+            self.limits = {'search': int(search), 'core': int(core)}
+        self.used = {}
+        self.resets = {}
+        self.lock = threading.Lock()
+
+    def take(self, resource, counted):
+        # The headers to send, and whether the request may go through
+        if not self.limits:
+            return {}, True
+        with self.lock:
+            now = int(time.time())
+            if self.resets.get(resource, 0) <= now:
+                self.resets[resource] = now + self.WINDOWS[resource]
+                self.used[resource] = 0
+            allowed = self.used[resource] < self.limits[resource]
+            if allowed and counted:
+                self.used[resource] += 1
+            headers = {
+                'X-RateLimit-Limit': str(self.limits[resource]),
+                'X-RateLimit-Remaining': str(self.limits[resource] - self.used[resource]),
+                'X-RateLimit-Reset': str(self.resets[resource]),
+                'X-RateLimit-Resource': resource
+            }
+            if not allowed:
+                headers['Retry-After'] = str(self.resets[resource] - now)
+            return headers, allowed
+
+rate_limit = RateLimit(None)
+
 class MyRequestHandler(http.server.BaseHTTPRequestHandler):
+    # Keep connections open, so the client's pool is exercised
+    protocol_version = 'HTTP/1.1'
+
     def do_GET(self):
         sys.stderr.write("GET: %s\n" % self.path)
         sys.stderr.flush()
+        self.rate_headers = {}
 
         parse = urlparse(self.path)
         path = parse.path
         query = parse_qs(parse.query)
-        
-        if path == '/data/2.5/weather':
-            self.send_response(200)
-            self.send_header("Content-type", "text/html")
-            self.end_headers()
-
-            mode = 'json'
-            if 'mode' in query:
-                mode = query['mode'][0]
-
-            self.wfile.write(bytes(read_file('weather/%s.%s' % (query['q'][0], mode)), 'UTF-8'))
-        elif path == '/data/2.5/forecast/daily':
-            self.send_response(200)
-            self.send_header("Content-type", "text/html")
-            self.end_headers()
-
-            mode = 'json'
-            if 'mode' in query:
-                mode = query['mode'][0]
-
-            self.wfile.write(bytes(read_file('forecast/daily/%s.%s' % (query['q'][0], mode)), 'UTF-8'))
+        segments = [s for s in path.split('/') if s]
+
+        page = int(query['page'][0]) if 'page' in query else 1
+        per_page = min(int(query['per_page'][0]), 100) if 'per_page' in query else 30
+        # The client joins qualifiers with '+', which may come through as spaces
+        terms = query['q'][0].replace('+', ' ').split(' ') if 'q' in query else ['']
+        qualifiers = dict(t.split(':', 1) for t in terms[1:] if ':' in t)
+
+        if path.startswith('/data/2.5/'):
+            self.send_weather(path, query)
+        elif not self.admit('search' if segments[:1] == ['search'] else 'core'):
+            pass
+        elif path == '/search/users':
+            self.send_json(search_users(terms[0], page, per_page))
+        elif path == '/search/repositories':
+            self.send_json(search_repositories(terms[0], page, per_page))
+        elif path == '/search/code':
+            self.send_json(search_code(terms[0], qualifiers.get('repo', ''), page, per_page))
+        elif len(segments) == 2 and segments[0] == 'users' and find_user(segments[1]):
+            self.send_json(json.dumps(find_user(segments[1]), indent=2))
+        elif len(segments) >= 3 and segments[0] == 'repos' \
+                and find_repository(segments[1], segments[2]):
+            item = find_repository(segments[1], segments[2])
+            part = '/'.join(segments[3:])
+            if part == '':
+                self.send_json(json.dumps(item, indent=2))
+            elif part == 'readme':
+                self.send_json(json.dumps(readme(item), indent=2))
+            elif part == 'languages':
+                self.send_json(json.dumps(languages(item), indent=2))
+            elif part == 'releases/latest':
+                self.send_json(json.dumps(latest_release(item), indent=2))
+            elif part == 'contributors':
+                self.send_json(json.dumps(contributors(item, per_page), indent=2))
+            else:
+                self.send_not_found()
         else:
-            self.send_response(404)
-            self.send_header("Content-type", "text/html")
-            self.end_headers()
-            self.wfile.write(bytes('ERROR', 'UTF-8'))
+            self.send_not_found()
+
+    do_HEAD = do_GET
+
+    def do_POST(self):
+        sys.stderr.write("POST: %s\n" % self.path)
+        sys.stderr.flush()
+        self.rate_headers = {}
+
+        length = int(self.headers.get('Content-Length', 0))
+        payload = self.rfile.read(length)
+
+        if urlparse(self.path).path != '/graphql':
+            self.send_not_found()
+        elif self.admit('core'):
+            self.send_json(graphql(json.loads(payload.decode('UTF-8'))))
+
+    def admit(self, resource):
+        # Apply the injected latency, errors and rate limits. Returns false
+        # when the request has already been answered.
+        time.sleep(latency())
+        if failing():
+            self.send(options.error_status, 'application/json',
+                      json.dumps({'message': 'Injected failure'}).encode('UTF-8'))
+            return False
+
+        # Like GitHub, conditional requests answered with a 304 are free
+        self.rate_headers, allowed = rate_limit.take(resource, 'If-None-Match' not in self.headers)
+        if not allowed:
+            self.send(403, 'application/json',
+                      json.dumps({'message': 'API rate limit exceeded'}).encode('UTF-8'),
+                      self.rate_headers)
+            return False
+        return True
+
+    def send_weather(self, path, query):
+        # The fixtures of the original weather scope tests
+        mode = query['mode'][0] if 'mode' in query else 'json'
+        fixture = 'weather' if path == '/data/2.5/weather' else 'forecast/daily'
+        self.send(200, 'text/html',
+                  bytes(read_file('%s/%s.%s' % (fixture, query['q'][0], mode)), 'UTF-8'))
+
+    def send_not_found(self):
+        self.send(404, 'application/json',
+                  json.dumps({'message': 'Not Found'}).encode('UTF-8'),
+                  self.rate_headers)
+
+    def send_json(self, content):
+        raw = bytes(content, 'UTF-8')
+        headers = dict(self.rate_headers)
+        headers['ETag'] = '"%s"' % hashlib.sha1(raw).hexdigest()
+        if self.headers.get('If-None-Match') == headers['ETag']:
+            self.send(304, None, b'', headers)
+            return
+
+        body, encoding = encode(raw, self.headers.get('Accept-Encoding', ''))
+        if encoding:
+            headers['Content-Encoding'] = encoding
+        self.send(200, 'application/json', body, headers)
+
+    def send(self, status, content_type, body, headers=None):
+        self.send_response(status)
+        if content_type:
+            self.send_header("Content-type", content_type)
+        for key, value in (headers or {}).items():
+            self.send_header(key, value)
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        if self.command != 'HEAD':
+            self.wfile.write(body)
+
+class Server(socketserver.ThreadingMixIn, socketserver.TCPServer):
+    # Requests are answered in parallel, as GitHub does, so injected
+    # latency doesn't queue them up
+    daemon_threads = True
 
 if __name__ == "__main__":
+    options = parse_options(sys.argv[1:])
+    rng = random.Random(options.seed)
+    rate_limit = RateLimit(options.rate_limit)
+
     Handler = MyRequestHandler
-    httpd = socketserver.TCPServer(("127.0.0.1", 0), Handler)
+    httpd = Server(("127.0.0.1", 0), Handler)
 
     sys.stdout.write('%d\n' % httpd.server_address[1])
     sys.stdout.flush()
 
     httpd.serve_forever()
-
-
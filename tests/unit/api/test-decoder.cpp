@@ -0,0 +1,185 @@
+#include <api/decoder.h>
+#include <api/schema.h>
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+
+#include <QJsonArray>
+#include <QJsonDocument>
+
+using namespace std;
+using namespace api;
+
+/**
+ * Keep the tests in an anonymous namespace
+ */
+namespace {
+
+/**
+ * A repository object as the API returns it
+ */
+string repository_json(int i) {
+    ostringstream oss;
+    oss << R"({"id": )" << i << R"(, "name": "repo)" << i
+        << R"(", "full_name": "owner)" << i << "/repo" << i
+        << R"(", "owner": {"login": "owner)" << i << R"(", "id": )" << 1000 + i
+        << R"(, "avatar_url": "https://avatars.githubusercontent.com/u/)" << 1000 + i
+        << R"(?v=3", "html_url": "https://github.com/owner)" << i << R"("},)"
+        << R"("private": false, "fork": )" << (i % 2 ? "true" : "false")
+        << R"(, "html_url": "https://github.com/owner)" << i << "/repo" << i
+        << R"(", "description": "Description of repository number )" << i
+        << R"(", "language": "C++", "forks_count": )" << i
+        << R"(, "stargazers_count": )" << 2 * i << R"(, "watchers_count": )" << 3 * i
+        << R"(, "open_issues_count": 7, "created_at": "2014-01-01T00:00:00Z",)"
+        << R"( "pushed_at": "2015-02-03T04:05:06Z"})";
+    return oss.str();
+}
+
+/**
+ * A search/repositories payload with the given number of items
+ */
+string repositories_payload(int count) {
+    ostringstream oss;
+    oss << R"({"total_count": )" << count << R"(, "incomplete_results": false, "items": [)";
+    for (int i = 0; i < count; ++i) {
+        oss << (i ? "," : "") << repository_json(i);
+    }
+    oss << "]}";
+    return oss.str();
+}
+
+Client::RepositoryList decoded_repositories(const QJsonDocument &root) {
+    Client::RepositoryList result;
+    for (const QJsonValue &item : root.object().value(QLatin1String("items")).toArray()) {
+        result.emplace_back();
+        decode(item.toObject(), result.back());
+    }
+    return result;
+}
+
+TEST(Decoder, repository_fields) {
+    QJsonDocument root = QJsonDocument::fromJson(repositories_payload(2).c_str());
+    Client::RepositoryList repositories = decoded_repositories(root);
+
+    ASSERT_EQ(2u, repositories.size());
+    const Client::Repository &repository = repositories.back();
+    EXPECT_EQ("owner1", repository.owner.login);
+    EXPECT_EQ(1001u, repository.owner.id);
+    EXPECT_EQ("https://github.com/owner1", repository.owner.url);
+    EXPECT_EQ("repo1", repository.name);
+    EXPECT_EQ("owner1/repo1", repository.full_name);
+    EXPECT_EQ("Description of repository number 1", repository.description);
+    EXPECT_FALSE(repository.prvt);
+    EXPECT_TRUE(repository.fork);
+    EXPECT_EQ("C++", repository.language);
+    EXPECT_EQ(2u, repository.stargazers_count);
+    EXPECT_EQ(3u, repository.watchers_count);
+    EXPECT_EQ(7u, repository.open_issues_count);
+    EXPECT_EQ("2015-02-03T04:05:06Z", repository.pushed_at);
+}
+
+TEST(Decoder, schema_compares_every_field) {
+    QJsonDocument root = QJsonDocument::fromJson(repositories_payload(1).c_str());
+    Client::Repository repository = decoded_repositories(root).front();
+    Client::Repository copy = repository;
+    EXPECT_TRUE(same_fields(repository, copy));
+
+    // Nested records are compared too
+    copy.owner.avatar_url += "?s=64";
+    EXPECT_FALSE(same_fields(repository, copy));
+}
+
+/**
+ * Decode a single object of JSON text into a record
+ */
+template<typename Record>
+Record decoded(const string &json, Record record = Record()) {
+    decode(QJsonDocument::fromJson(json.c_str()).object(), record);
+    return record;
+}
+
+TEST(Decoder, user_fields) {
+    Client::User user = decoded<Client::User>(
+                R"({"login": "octocat", "id": 583231, "type": "User",)"
+                R"( "avatar_url": "https://avatars.githubusercontent.com/u/583231?v=3",)"
+                R"( "html_url": "https://github.com/octocat", "name": "The Octocat",)"
+                R"( "company": "GitHub", "blog": "http://www.github.com/blog",)"
+                R"( "location": "San Francisco", "hireable": true, "bio": "",)"
+                R"( "public_repos": 8, "public_gists": 8, "followers": 3938, "following": 9})");
+
+    EXPECT_EQ("octocat", user.login);
+    EXPECT_EQ(583231u, user.id);
+    EXPECT_EQ("https://github.com/octocat", user.html_url);
+    EXPECT_EQ("The Octocat", user.name);
+    EXPECT_EQ("GitHub", user.company);
+    EXPECT_EQ("San Francisco", user.location);
+    EXPECT_TRUE(user.hireable);
+    EXPECT_EQ("", user.bio);
+    EXPECT_EQ(8u, user.public_repos);
+    EXPECT_EQ(3938u, user.followers);
+    EXPECT_EQ(9u, user.following);
+}
+
+TEST(Decoder, code_fields) {
+    Client::Code code = decoded<Client::Code>(
+                R"({"name": "main.cpp", "path": "src/main.cpp", "sha": "d1a2b3",)"
+                R"( "html_url": "https://github.com/owner0/repo0/blob/master/src/main.cpp",)"
+                R"( "repository": )" + repository_json(0) + "}");
+
+    EXPECT_EQ("main.cpp", code.name);
+    EXPECT_EQ("src/main.cpp", code.path);
+    EXPECT_EQ("https://github.com/owner0/repo0/blob/master/src/main.cpp", code.html_url);
+
+    // The repository and its owner are decoded with their own schemas
+    EXPECT_EQ("owner0/repo0", code.repository.full_name);
+    EXPECT_EQ("C++", code.repository.language);
+    EXPECT_EQ("owner0", code.repository.owner.login);
+    EXPECT_EQ(1000u, code.repository.owner.id);
+}
+
+TEST(Decoder, missing_and_null_fields_are_empty) {
+    // Whatever the record held before is not kept either
+    Client::Repository before;
+    before.description = "An old description";
+    before.fork = true;
+    before.forks_count = 12;
+    before.owner.login = "someone";
+
+    Client::Repository repository = decoded<Client::Repository>(
+                R"({"name": "repo", "description": null, "language": null,)"
+                R"( "forks_count": null, "owner": null})", before);
+
+    EXPECT_EQ("repo", repository.name);
+    EXPECT_EQ("", repository.description);
+    EXPECT_EQ("", repository.language);
+    EXPECT_EQ("", repository.full_name);
+    EXPECT_FALSE(repository.fork);
+    EXPECT_EQ(0u, repository.forks_count);
+    EXPECT_EQ(0u, repository.stargazers_count);
+    EXPECT_EQ("", repository.owner.login);
+    EXPECT_EQ(0u, repository.owner.id);
+}
+
+TEST(Decoder, wrong_types_are_empty) {
+    Client::User user = decoded<Client::User>(
+                R"({"login": 42, "id": "583231", "hireable": "yes",)"
+                R"( "followers": [1, 2], "name": {"first": "The"}, "location": "Berlin"})");
+
+    EXPECT_EQ("", user.login);
+    EXPECT_EQ(0u, user.id);
+    EXPECT_FALSE(user.hireable);
+    EXPECT_EQ(0u, user.followers);
+    EXPECT_EQ("", user.name);
+
+    // The fields around them are still decoded
+    EXPECT_EQ("Berlin", user.location);
+
+    Client::Repository repository = decoded<Client::Repository>(
+                R"({"name": "repo", "owner": "octocat"})");
+    EXPECT_EQ("repo", repository.name);
+    EXPECT_EQ("", repository.owner.login);
+}
+
+} // namespace
@@ -0,0 +1,90 @@
+#include "temporary-path-test.h"
+
+#include <api/disk_lru.h>
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <string>
+
+using namespace std;
+using namespace api;
+
+/**
+ * Keep the tests in an anonymous namespace
+ */
+namespace {
+
+class TestDiskLru: public TemporaryPathTest {
+protected:
+    TestDiskLru() :
+        TemporaryPathTest("disk-lru-test") {
+    }
+
+    static bool is_entry(const string &name) {
+        return name.size() > 4 && name.compare(name.size() - 4, 4, ".dat") == 0;
+    }
+
+    void write(DiskLru &files, const string &name, size_t size) {
+        ofstream(files.path(name)) << string(size, 'x');
+    }
+
+    bool exists(DiskLru &files, const string &name) {
+        return ifstream(files.path(name)).good();
+    }
+};
+
+TEST_F(TestDiskLru, evicts_the_least_recently_used) {
+    DiskLru files(path_, 2500, is_entry);
+    for (const string name : { "a.dat", "b.dat" }) {
+        write(files, name, 1000);
+        ASSERT_TRUE(files.stored(name));
+    }
+
+    // Reading the oldest one keeps it around
+    EXPECT_NE(nullptr, files.use("a.dat"));
+    write(files, "c.dat", 1000);
+    ASSERT_TRUE(files.stored("c.dat"));
+
+    EXPECT_TRUE(exists(files, "a.dat"));
+    EXPECT_FALSE(exists(files, "b.dat"));
+    EXPECT_TRUE(exists(files, "c.dat"));
+    EXPECT_EQ(nullptr, files.use("b.dat"));
+    EXPECT_EQ(1u, files.evictions());
+}
+
+TEST_F(TestDiskLru, rewriting_a_file_replaces_its_size) {
+    DiskLru files(path_, 2500, is_entry);
+    for (int i = 0; i < 5; ++i) {
+        write(files, "a.dat", 1000);
+        ASSERT_TRUE(files.stored("a.dat"));
+    }
+    EXPECT_EQ(0u, files.evictions());
+    ASSERT_NE(nullptr, files.use("a.dat"));
+    EXPECT_EQ(1000u, files.use("a.dat")->size);
+
+    EXPECT_FALSE(files.stored("missing.dat"));
+}
+
+TEST_F(TestDiskLru, picks_up_previous_runs_within_the_new_budget) {
+    {
+        DiskLru files(path_, 10000, is_entry);
+        for (const string name : { "a.dat", "b.dat", "c.dat" }) {
+            write(files, name, 1000);
+            ASSERT_TRUE(files.stored(name));
+        }
+        write(files, "d.tmp", 1000);
+    }
+
+    // Only entries count, and they fit
+    DiskLru files(path_, 3000, is_entry);
+    EXPECT_EQ(0u, files.evictions());
+    EXPECT_NE(nullptr, files.use("a.dat"));
+    EXPECT_EQ(nullptr, files.use("d.tmp"));
+
+    // A smaller budget deletes some of them straight away
+    DiskLru smaller(path_, 1500, is_entry);
+    EXPECT_EQ(2u, smaller.evictions());
+}
+
+}
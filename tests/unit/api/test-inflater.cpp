@@ -0,0 +1,154 @@
+#include <api/inflater.h>
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <string>
+
+#include <zlib.h>
+
+using namespace std;
+using namespace api;
+
+/**
+ * Keep the tests in an anonymous namespace
+ */
+namespace {
+
+/**
+ * Compress a body with the given zlib window bits: 15 + 16 for gzip,
+ * 15 for zlib and -15 for raw deflate
+ */
+string compress(const string &body, int window_bits) {
+    z_stream stream;
+    stream.zalloc = Z_NULL;
+    stream.zfree = Z_NULL;
+    stream.opaque = Z_NULL;
+    deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, window_bits, 8,
+                 Z_DEFAULT_STRATEGY);
+
+    string result(deflateBound(&stream, body.size()), '\0');
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(body.data()));
+    stream.avail_in = body.size();
+    stream.next_out = reinterpret_cast<Bytef *>(&result[0]);
+    stream.avail_out = result.size();
+    deflate(&stream, Z_FINISH);
+    result.resize(result.size() - stream.avail_out);
+    deflateEnd(&stream);
+    return result;
+}
+
+/**
+ * A body long enough to come out in several blocks
+ */
+string json_body() {
+    string body = "{\"total_count\": 1000, \"items\": [";
+    for (int i = 0; i < 1000; ++i) {
+        body += (i ? ", " : "") + string("{\"id\": ") + to_string(i)
+                + ", \"full_name\": \"owner/repository-" + to_string(i) + "\"}";
+    }
+    return body + "]}";
+}
+
+/**
+ * Feed a body a few bytes at a time and collect what comes out
+ */
+string inflated(const string &body, const string &encoding, size_t chunk_size,
+                bool *compressed = nullptr) {
+    string result;
+    Inflater inflater([&result](const string &block) { result += block; });
+    for (size_t i = 0; i < body.size(); i += chunk_size) {
+        inflater.feed(body.substr(i, chunk_size));
+    }
+    inflater.finish(encoding);
+    if (compressed) {
+        *compressed = inflater.compressed();
+    }
+    return result;
+}
+
+TEST(Inflater, inflates_gzip) {
+    bool compressed = false;
+    EXPECT_EQ(json_body(), inflated(compress(json_body(), 15 + 16), "gzip", 4096, &compressed));
+    EXPECT_TRUE(compressed);
+}
+
+TEST(Inflater, inflates_zlib) {
+    EXPECT_EQ(json_body(), inflated(compress(json_body(), 15), "deflate", 4096));
+}
+
+TEST(Inflater, inflates_raw_deflate) {
+    bool compressed = false;
+    EXPECT_EQ(json_body(), inflated(compress(json_body(), -15), " Deflate", 4096, &compressed));
+    EXPECT_TRUE(compressed);
+}
+
+TEST(Inflater, streams_what_it_recognises) {
+    string streamed;
+    Inflater inflater([&streamed](const string &block) { streamed += block; });
+    string body = compress(json_body(), 15 + 16);
+    inflater.feed(body.substr(0, body.size() / 2));
+    EXPECT_FALSE(streamed.empty());
+
+    // A raw deflate stream can't be told from other binary data until
+    // the header is in
+    streamed.clear();
+    Inflater raw([&streamed](const string &block) { streamed += block; });
+    body = compress(json_body(), -15);
+    raw.feed(body);
+    EXPECT_TRUE(streamed.empty());
+    raw.finish("deflate");
+    EXPECT_EQ(json_body(), streamed);
+}
+
+TEST(Inflater, header_split_across_chunks) {
+    EXPECT_EQ(json_body(), inflated(compress(json_body(), 15 + 16), "gzip", 1));
+    EXPECT_EQ(json_body(), inflated(compress(json_body(), 15), "deflate", 1));
+    EXPECT_EQ(json_body(), inflated(compress(json_body(), -15), "deflate", 1));
+}
+
+TEST(Inflater, passes_text_through) {
+    bool compressed = true;
+    EXPECT_EQ(json_body(), inflated(json_body(), "", 1000, &compressed));
+    EXPECT_FALSE(compressed);
+    EXPECT_EQ("<html>Bad gateway</html>", inflated("<html>Bad gateway</html>", "", 1));
+}
+
+TEST(Inflater, passes_binary_identity_bodies_through) {
+    string binary;
+    for (int i = 0; i < 1000; ++i) {
+        binary += static_cast<char>(i * 7 % 256);
+    }
+    bool compressed = true;
+    EXPECT_EQ(binary, inflated(binary, "", 100, &compressed));
+    EXPECT_FALSE(compressed);
+    EXPECT_EQ(binary, inflated(binary, "identity", 100));
+    EXPECT_EQ(binary, inflated(binary, "br", 100));
+
+    // Without the header, even a raw deflate stream is left alone
+    string raw = compress(json_body(), -15);
+    EXPECT_EQ(raw, inflated(raw, "", 4096));
+}
+
+TEST(Inflater, flushes_a_body_too_short_to_recognise) {
+    EXPECT_EQ("1", inflated("1", "", 1));
+    EXPECT_EQ("", inflated("", "", 1));
+
+    // A 304 names the encoding, but has no body
+    EXPECT_EQ("", inflated("", "gzip", 1));
+}
+
+TEST(Inflater, corrupt_stream) {
+    string body = compress(json_body(), 15 + 16);
+    for (size_t i = 10; i < 40; ++i) {
+        body[i] = static_cast<char>(0xff);
+    }
+    EXPECT_THROW(inflated(body, "gzip", 4096), domain_error);
+}
+
+TEST(Inflater, truncated_stream) {
+    string body = compress(json_body(), 15 + 16);
+    EXPECT_THROW(inflated(body.substr(0, body.size() / 2), "gzip", 4096), domain_error);
+}
+
+}
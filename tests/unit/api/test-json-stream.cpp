@@ -0,0 +1,98 @@
+#include <api/json_stream.h>
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QString>
+
+using namespace std;
+using namespace api;
+
+/**
+ * Keep the tests in an anonymous namespace
+ */
+namespace {
+
+const string SEARCH =
+        R"({"total_count": 2, "incomplete_results": false, "items": [)"
+        R"({"name": "one", "description": "has \"quotes\", {braces} and [brackets]"},)"
+        R"( {"name": "two", "owner": {"login": "nested \\"}, "topics": ["a", "b"]}]})";
+
+class TestJsonStream: public ::testing::Test {
+protected:
+    TestJsonStream() :
+        stream_([this](const QJsonObject &item) {
+        names_.push_back(item.value(QLatin1String("name")).toString().toStdString());
+        descriptions_.push_back(item.value(QLatin1String("description")).toString().toStdString());
+    }) {
+    }
+
+    void feed(const string &body, size_t chunk_size) {
+        for (size_t i = 0; i < body.size(); i += chunk_size) {
+            stream_.feed(body.substr(i, chunk_size));
+        }
+    }
+
+    JsonStream stream_;
+    vector<string> names_;
+    vector<string> descriptions_;
+};
+
+TEST_F(TestJsonStream, items_and_fields_in_one_chunk) {
+    feed(SEARCH, SEARCH.size());
+    EXPECT_EQ((vector<string> { "one", "two" }), names_);
+    EXPECT_TRUE(stream_.complete());
+    EXPECT_EQ("2", stream_.field("total_count"));
+    EXPECT_EQ("false", stream_.field("incomplete_results"));
+    EXPECT_EQ(0u, stream_.errors());
+}
+
+TEST_F(TestJsonStream, items_split_across_chunks) {
+    // Every possible split point, down to a byte at a time
+    feed(SEARCH, 1);
+    EXPECT_EQ((vector<string> { "one", "two" }), names_);
+    EXPECT_TRUE(stream_.complete());
+    EXPECT_EQ("2", stream_.field("total_count"));
+}
+
+TEST_F(TestJsonStream, escaped_quotes_and_braces_inside_strings) {
+    feed(SEARCH, 7);
+    ASSERT_EQ(2u, descriptions_.size());
+    EXPECT_EQ(R"(has "quotes", {braces} and [brackets])", descriptions_[0]);
+}
+
+TEST_F(TestJsonStream, incomplete_until_the_end) {
+    feed(SEARCH.substr(0, SEARCH.size() - 1), 16);
+    EXPECT_EQ(2u, names_.size());
+    EXPECT_FALSE(stream_.complete());
+}
+
+TEST_F(TestJsonStream, error_document) {
+    feed(R"({"message": "Validation Failed", "errors": [{"code": "missing"}]})", 5);
+    EXPECT_TRUE(names_.empty());
+    EXPECT_TRUE(stream_.complete());
+    EXPECT_EQ("", stream_.field("total_count"));
+    EXPECT_EQ("\"Validation Failed\"", stream_.field("message"));
+}
+
+TEST_F(TestJsonStream, reset_after_an_error_document) {
+    // A retried request follows the error body of the failed one
+    feed(R"({"message": "Server Error"})", 4);
+    stream_.reset();
+    feed(SEARCH, 9);
+    EXPECT_EQ((vector<string> { "one", "two" }), names_);
+    EXPECT_EQ("2", stream_.field("total_count"));
+    EXPECT_EQ("", stream_.field("message"));
+}
+
+TEST_F(TestJsonStream, counts_broken_items) {
+    feed(R"({"total_count": 2, "items": [{"name": "one", "size": 1x}, {"name": "two"}]})", 11);
+    EXPECT_EQ((vector<string> { "two" }), names_);
+    EXPECT_EQ(1u, stream_.errors());
+}
+
+}
@@ -0,0 +1,99 @@
+#include "temporary-path-test.h"
+
+#include <api/metrics.h>
+
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace api;
+
+/**
+ * Keep the tests in an anonymous namespace
+ */
+namespace {
+
+class TestMetrics: public TemporaryPathTest {
+protected:
+    TestMetrics() :
+        TemporaryPathTest("metrics-test.json") {
+    }
+};
+
+TEST_F(TestMetrics, percentiles_within_a_sixteenth) {
+    Metrics::Histogram histogram;
+    for (int i = 1; i <= 1000; ++i) {
+        histogram.record(chrono::milliseconds(i));
+    }
+
+    Metrics::Histogram::Summary summary = histogram.summary();
+    EXPECT_EQ(1000u, summary.count);
+    EXPECT_EQ(1000000u, summary.max);
+    EXPECT_NEAR(500000, summary.p50, 500000 / 16);
+    EXPECT_NEAR(900000, summary.p90, 900000 / 16);
+    EXPECT_NEAR(990000, summary.p99, 990000 / 16);
+
+    // Never above the largest value seen
+    EXPECT_LE(summary.p99, summary.max);
+}
+
+TEST_F(TestMetrics, small_and_huge_values) {
+    Metrics::Histogram histogram;
+    histogram.record(chrono::microseconds(3));
+    EXPECT_EQ(3u, histogram.summary().p50);
+
+    // Beyond the last bucket still counts, at the maximum
+    histogram.record(chrono::hours(100));
+    EXPECT_EQ(2u, histogram.summary().count);
+    EXPECT_EQ(360000000000u, histogram.summary().max);
+}
+
+TEST_F(TestMetrics, endpoints_from_paths) {
+    EXPECT_EQ(Metrics::Endpoint::search_repositories,
+              Metrics::endpoint({ "search", "repositories" }));
+    EXPECT_EQ(Metrics::Endpoint::search_code, Metrics::endpoint({ "search", "code" }));
+    EXPECT_EQ(Metrics::Endpoint::search_users, Metrics::endpoint({ "search", "users" }));
+    EXPECT_EQ(Metrics::Endpoint::users, Metrics::endpoint({ "users", "octocat" }));
+    EXPECT_EQ(Metrics::Endpoint::repos, Metrics::endpoint({ "repos", "a", "b", "readme" }));
+    EXPECT_EQ(Metrics::Endpoint::graphql, Metrics::endpoint({ "graphql" }));
+    EXPECT_EQ(Metrics::Endpoint::other, Metrics::endpoint({ }));
+}
+
+TEST_F(TestMetrics, counts_from_many_threads_and_writes_them) {
+    Metrics metrics;
+    vector<thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([&metrics]() {
+            for (int j = 0; j < 1000; ++j) {
+                metrics.add(Metrics::Counter::bytes_fetched, 10);
+                Metrics::Timer timer(&metrics.latency(Metrics::Endpoint::users));
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+    {
+        Metrics::Timer timer(&metrics.query);
+        timer.dismiss();
+    }
+
+    EXPECT_EQ(40000u, metrics.value(Metrics::Counter::bytes_fetched));
+    EXPECT_EQ(0u, metrics.value(Metrics::Counter::parse_errors));
+    EXPECT_EQ(4000u, metrics.latency(Metrics::Endpoint::users).summary().count);
+    EXPECT_EQ(0u, metrics.query.summary().count);
+
+    ASSERT_TRUE(metrics.write(path_));
+    ifstream in(path_);
+    string written((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    EXPECT_NE(string::npos, written.find(R"("bytes_fetched": 40000)"));
+    EXPECT_NE(string::npos, written.find(R"("users": {"count": 4000)"));
+    EXPECT_NE(string::npos, written.find(R"("query": {"count": 0)"));
+}
+
+}
@@ -0,0 +1,112 @@
+#include <api/rate_limiter.h>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+#include <thread>
+
+using namespace std;
+using namespace api;
+
+/**
+ * Keep the tests in an anonymous namespace
+ */
+namespace {
+
+typedef RateLimiter::Endpoint Endpoint;
+typedef RateLimiter::Priority Priority;
+
+/**
+ * An X-RateLimit-Reset header this many seconds from now
+ */
+string reset_in(int seconds) {
+    return to_string(chrono::duration_cast<chrono::seconds>(
+                         chrono::system_clock::now().time_since_epoch()).count() + seconds);
+}
+
+TEST(RateLimiter, endpoints) {
+    EXPECT_EQ(Endpoint::search, RateLimiter::endpoint("search"));
+    EXPECT_EQ(Endpoint::core, RateLimiter::endpoint("repos"));
+    EXPECT_EQ(Endpoint::core, RateLimiter::endpoint("users"));
+}
+
+TEST(RateLimiter, sheds_background_work_first) {
+    // 10 searches, of which background work leaves 3 to the user
+    RateLimiter limiter(10, 60, chrono::milliseconds(0));
+    CancellationToken token;
+    for (int i = 0; i < 7; ++i) {
+        EXPECT_TRUE(limiter.acquire(Endpoint::search, Priority::background, token));
+    }
+    EXPECT_FALSE(limiter.acquire(Endpoint::search, Priority::background, token));
+
+    // The reserve is still there for the user
+    for (int i = 0; i < 3; ++i) {
+        EXPECT_TRUE(limiter.acquire(Endpoint::search, Priority::user, token));
+    }
+    EXPECT_FALSE(limiter.acquire(Endpoint::search, Priority::user, token));
+
+    // The other budget is untouched
+    EXPECT_TRUE(limiter.acquire(Endpoint::core, Priority::background, token));
+
+    RateLimiter::Stats stats = limiter.stats();
+    EXPECT_EQ(11u, stats.granted);
+    EXPECT_EQ(1u, stats.dropped);
+    EXPECT_EQ(1u, stats.exhausted);
+}
+
+TEST(RateLimiter, waits_for_the_reset_window) {
+    RateLimiter limiter(10, 60, chrono::milliseconds(3000));
+    CancellationToken token;
+
+    // The server says the budget is spent for a second or two
+    limiter.update(Endpoint::search, "0", reset_in(2), "");
+    EXPECT_FALSE(limiter.acquire(Endpoint::search, Priority::background, token));
+
+    auto start = chrono::steady_clock::now();
+    EXPECT_TRUE(limiter.acquire(Endpoint::search, Priority::user, token));
+    EXPECT_GT(chrono::steady_clock::now() - start, chrono::milliseconds(100));
+    EXPECT_EQ(1u, limiter.stats().waited);
+
+    // And the whole budget is back
+    for (int i = 0; i < 6; ++i) {
+        EXPECT_TRUE(limiter.acquire(Endpoint::search, Priority::background, token));
+    }
+}
+
+TEST(RateLimiter, refuses_a_reset_beyond_the_longest_wait) {
+    RateLimiter limiter(10, 60, chrono::milliseconds(200));
+    CancellationToken token;
+    limiter.update(Endpoint::core, "0", reset_in(3600), "");
+
+    auto start = chrono::steady_clock::now();
+    EXPECT_FALSE(limiter.acquire(Endpoint::core, Priority::user, token));
+
+    // Refused straight away rather than after waiting for nothing
+    EXPECT_LT(chrono::steady_clock::now() - start, chrono::milliseconds(100));
+    EXPECT_TRUE(limiter.acquire(Endpoint::search, Priority::user, token));
+}
+
+TEST(RateLimiter, honours_retry_after) {
+    RateLimiter limiter(10, 60, chrono::milliseconds(200));
+    CancellationToken token;
+    limiter.update(Endpoint::search, "", "", "60");
+    EXPECT_FALSE(limiter.acquire(Endpoint::search, Priority::user, token));
+}
+
+TEST(RateLimiter, stops_waiting_when_cancelled) {
+    RateLimiter limiter(10, 60, chrono::milliseconds(5000));
+    CancellationToken token;
+    limiter.update(Endpoint::search, "0", reset_in(4), "");
+
+    thread canceller([token]() {
+        this_thread::sleep_for(chrono::milliseconds(100));
+        token.cancel();
+    });
+    auto start = chrono::steady_clock::now();
+    EXPECT_FALSE(limiter.acquire(Endpoint::search, Priority::user, token));
+    EXPECT_LT(chrono::steady_clock::now() - start, chrono::milliseconds(1000));
+    canceller.join();
+}
+
+}
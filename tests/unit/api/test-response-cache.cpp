@@ -0,0 +1,78 @@
+#include "temporary-path-test.h"
+
+#include <api/response_cache.h>
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+using namespace std;
+using namespace api;
+
+/**
+ * Keep the tests in an anonymous namespace
+ */
+namespace {
+
+class TestResponseCache: public TemporaryPathTest {
+protected:
+    TestResponseCache() :
+        TemporaryPathTest("response-cache-test") {
+    }
+
+    ResponseCache::Entry entry(const string &etag) {
+        return ResponseCache::Entry { etag, string(), string(1000, 'x') };
+    }
+
+};
+
+TEST_F(TestResponseCache, stores_and_finds_entries) {
+    ResponseCache cache(path_);
+    string key = ResponseCache::key("https://api.github.com", { "search", "code" },
+                                    { { "q", "b" }, { "page", "2" } });
+    EXPECT_EQ(key, ResponseCache::key("https://api.github.com", { "search", "code" },
+                                      { { "page", "2" }, { "q", "b" } }));
+
+    ResponseCache::Entry found;
+    EXPECT_FALSE(cache.find(key, found));
+    cache.store(key, entry("\"abc\""));
+    ASSERT_TRUE(cache.find(key, found));
+    EXPECT_EQ("\"abc\"", found.etag);
+    EXPECT_EQ(string(1000, 'x'), found.body);
+    EXPECT_EQ(1u, cache.stats().misses);
+}
+
+TEST_F(TestResponseCache, evicts_the_least_recently_used) {
+    // Room for two entries of a little over 1000 bytes
+    ResponseCache cache(path_, 2500);
+    cache.store("a", entry("1"));
+    cache.store("b", entry("2"));
+
+    // Using the older entry keeps it
+    ResponseCache::Entry found;
+    EXPECT_TRUE(cache.find("a", found));
+    cache.store("c", entry("3"));
+
+    EXPECT_TRUE(cache.find("a", found));
+    EXPECT_FALSE(cache.find("b", found));
+    EXPECT_TRUE(cache.find("c", found));
+    EXPECT_EQ(1u, cache.stats().evictions);
+}
+
+TEST_F(TestResponseCache, keeps_the_budget_across_runs) {
+    {
+        ResponseCache cache(path_);
+        cache.store("a", entry("1"));
+        cache.store("b", entry("2"));
+        cache.store("c", entry("3"));
+    }
+
+    // A smaller budget trims the entries found on disk
+    ResponseCache cache(path_, 1500);
+    EXPECT_EQ(2u, cache.stats().evictions);
+    ResponseCache::Entry found;
+    int left = cache.find("a", found) + cache.find("b", found) + cache.find("c", found);
+    EXPECT_EQ(1, left);
+}
+
+}
@@ -0,0 +1,93 @@
+#include <api/tracer.h>
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+
+using namespace std;
+using namespace api;
+
+/**
+ * Keep the tests in an anonymous namespace
+ */
+namespace {
+
+class TestTracer: public ::testing::Test {
+protected:
+    void SetUp() override {
+        const char *tmpdir = getenv("TMPDIR");
+        path_ = string(tmpdir ? tmpdir : "/tmp") + "/tracer-test.json";
+        remove(path_.c_str());
+    }
+
+    void TearDown() override {
+        remove(path_.c_str());
+    }
+
+    string written(const Tracer &tracer) {
+        EXPECT_TRUE(tracer.write(path_));
+        ifstream in(path_);
+        return string(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    }
+
+    string path_;
+};
+
+TEST_F(TestTracer, writes_chrome_trace_events) {
+    auto tracer = make_shared<Tracer>();
+    {
+        Tracer::Span span(tracer, "request");
+        span.detail("/search/\"repositories\"");
+        tracer->instant("first byte");
+    }
+    thread([tracer]() {
+        Tracer::Span span(tracer, "attempt");
+    }).join();
+
+    string trace = written(*tracer);
+    EXPECT_NE(string::npos, trace.find(R"("name": "request")"));
+    EXPECT_NE(string::npos, trace.find(R"("ph": "X")"));
+    EXPECT_NE(string::npos, trace.find(R"("name": "first byte")"));
+    EXPECT_NE(string::npos, trace.find(R"("ph": "i")"));
+    EXPECT_NE(string::npos, trace.find(R"("detail": "/search/\"repositories\"")"));
+
+    // The other thread wrote to a ring of its own
+    EXPECT_NE(string::npos, trace.find(R"("name": "attempt", "cat": "scope", "pid": 1, "tid": 2)"));
+}
+
+TEST_F(TestTracer, keeps_the_latest_events) {
+    auto tracer = make_shared<Tracer>(2);
+    const char *names[] = { "first", "second", "third" };
+    for (const char *name : names) {
+        Tracer::Span span(tracer, name);
+    }
+
+    string trace = written(*tracer);
+    EXPECT_EQ(string::npos, trace.find(R"("name": "first")"));
+    EXPECT_LT(trace.find(R"("name": "second")"), trace.find(R"("name": "third")"));
+}
+
+TEST_F(TestTracer, reuses_the_rings_of_finished_threads) {
+    auto tracer = make_shared<Tracer>();
+    for (int i = 0; i < 3; ++i) {
+        thread([tracer]() {
+            Tracer::Span span(tracer, "attempt");
+        }).join();
+    }
+
+    string trace = written(*tracer);
+    EXPECT_NE(string::npos, trace.find(R"("tid": 1)"));
+    EXPECT_EQ(string::npos, trace.find(R"("tid": 2)"));
+}
+
+TEST_F(TestTracer, records_nothing_without_a_tracer) {
+    Tracer::Span span(Tracer::Ptr(), "request");
+    EXPECT_FALSE(span.active());
+}
+
+}
@@ -0,0 +1,98 @@
+#include <scope/lru_cache.h>
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace scope;
+
+/**
+ * Keep the tests in an anonymous namespace
+ */
+namespace {
+
+typedef LruCache<string> Cache;
+
+size_t string_size(const string &value) {
+    return value.size();
+}
+
+Cache::ValuePtr value(size_t size) {
+    return make_shared<string>(size, 'x');
+}
+
+TEST(LruCache, hits_and_misses) {
+    Cache cache(1024, chrono::seconds(60), string_size, 1);
+    EXPECT_FALSE(cache.get("a"));
+    cache.put("a", make_shared<string>("value"));
+    ASSERT_TRUE(cache.get("a"));
+    EXPECT_EQ("value", *cache.get("a"));
+
+    // Storing again replaces the value
+    cache.put("a", make_shared<string>("other"));
+    EXPECT_EQ("other", *cache.get("a"));
+
+    Cache::Stats stats = cache.stats();
+    EXPECT_EQ(3u, stats.hits);
+    EXPECT_EQ(1u, stats.misses);
+}
+
+TEST(LruCache, evicts_the_least_recently_used) {
+    // Room for two values of 99 bytes and their one-byte keys
+    Cache cache(250, chrono::seconds(60), string_size, 1);
+    cache.put("a", value(99));
+    cache.put("b", value(99));
+
+    // Reading the older one makes it the most recently used
+    EXPECT_TRUE(cache.get("a"));
+    cache.put("c", value(99));
+
+    EXPECT_TRUE(cache.get("a"));
+    EXPECT_FALSE(cache.get("b"));
+    EXPECT_TRUE(cache.get("c"));
+    EXPECT_EQ(1u, cache.stats().evictions);
+}
+
+TEST(LruCache, skips_values_larger_than_a_shard) {
+    Cache cache(100, chrono::seconds(60), string_size, 1);
+    cache.put("a", value(10));
+    cache.put("huge", value(1000));
+    EXPECT_FALSE(cache.get("huge"));
+    EXPECT_TRUE(cache.get("a"));
+}
+
+TEST(LruCache, expires_entries) {
+    Cache cache(1024, chrono::seconds(0), string_size, 1);
+    cache.put("a", value(10));
+    EXPECT_FALSE(cache.get("a"));
+    EXPECT_EQ(1u, cache.stats().expirations);
+}
+
+TEST(LruCache, concurrent_readers_and_writers) {
+    Cache cache(64 * 1024, chrono::seconds(60), string_size);
+    vector<thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&cache, t]() {
+            for (int i = 0; i < 2000; ++i) {
+                string key = to_string((i * 7 + t) % 300);
+                if (i % 3 == 0) {
+                    cache.put(key, value(100));
+                } else if (auto found = cache.get(key)) {
+                    EXPECT_EQ(100u, found->size());
+                }
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    Cache::Stats stats = cache.stats();
+    EXPECT_EQ(4u * 2000 - 4 * 667, stats.hits + stats.misses);
+}
+
+}
@@ -0,0 +1,86 @@
+#include <scope/prefetcher.h>
+#include <scope/user_hydrator.h>
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace api;
+using namespace scope;
+
+/**
+ * Keep the tests in an anonymous namespace
+ */
+namespace {
+
+/**
+ * A configuration pointing at a server that isn't there, so anything
+ * that does reach the network comes back empty
+ */
+Config::Ptr offline_config() {
+    Config::Ptr config = make_shared<Config>();
+    config->apiroot = "http://127.0.0.1:9";
+    config->max_attempts = 1;
+    return config;
+}
+
+/**
+ * Wait until a condition holds, for at most a few seconds
+ */
+template<typename Condition>
+bool eventually(Condition condition) {
+    for (int i = 0; i < 500 && !condition(); ++i) {
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+    return condition();
+}
+
+TEST(Prefetcher, skips_cached_details) {
+    ResultCache::Ptr cache = make_shared<ResultCache>(1 << 20, chrono::seconds(60));
+    auto details = make_shared<Client::Details>();
+    details->latest_release = "v1.0";
+    cache->details.put("owner/cached", details);
+    cache->details.put("owner/also-cached", details);
+
+    Prefetcher prefetcher(offline_config(), cache);
+    prefetcher.prefetch({ "owner/cached", "owner/also-cached" });
+
+    ASSERT_TRUE(eventually([&]() { return prefetcher.stats().cached == 2; }));
+    EXPECT_EQ(0u, prefetcher.stats().fetched);
+    EXPECT_EQ("v1.0", cache->details.get("owner/cached")->latest_release);
+}
+
+TEST(Prefetcher, stops_with_work_queued) {
+    ResultCache::Ptr cache = make_shared<ResultCache>(1 << 20, chrono::seconds(60));
+
+    // Going away with a request in flight and more waiting
+    Prefetcher prefetcher(offline_config(), cache, 2);
+    prefetcher.prefetch({ "owner/a", "owner/b", "owner/c", "owner/d" });
+    EXPECT_EQ(2u, prefetcher.stats().dropped);
+}
+
+TEST(UserHydrator, skips_cached_profiles) {
+    ResultCache::Ptr cache = make_shared<ResultCache>(1 << 20, chrono::seconds(60));
+    auto profile = make_shared<Client::User>();
+    profile->login = "octocat";
+    profile->id = 583231;
+    profile->company = "GitHub";
+    cache->profiles.put("583231", profile);
+
+    UserHydrator hydrator(offline_config(), cache);
+    Client::User stub = Client::User();
+    stub.login = "octocat";
+    stub.id = 583231;
+    hydrator.hydrate({ stub });
+
+    ASSERT_TRUE(eventually([&]() { return hydrator.stats().cached == 1; }));
+    EXPECT_EQ(0u, hydrator.stats().hydrated);
+    EXPECT_EQ("GitHub", hydrator.profile(583231)->company);
+}
+
+}
@@ -0,0 +1,115 @@
+#include "temporary-path-test.h"
+
+#include <scope/repository_index.h>
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <string>
+
+using namespace std;
+using namespace api;
+using namespace scope;
+
+/**
+ * Keep the tests in an anonymous namespace
+ */
+namespace {
+
+Client::Repository repository(const string &owner, const string &name,
+                              const string &description, const string &language,
+                              unsigned int stargazers) {
+    Client::Repository result = Client::Repository();
+    result.owner.login = owner;
+    result.name = name;
+    result.full_name = owner + "/" + name;
+    result.description = description;
+    result.language = language;
+    result.html_url = "https://github.com/" + result.full_name;
+    result.stargazers_count = stargazers;
+    return result;
+}
+
+class TestRepositoryIndex: public TemporaryPathTest {
+protected:
+    TestRepositoryIndex() :
+        TemporaryPathTest("repository-index-test.log") {
+    }
+};
+
+TEST_F(TestRepositoryIndex, search_matches_every_word_and_prefix) {
+    RepositoryIndex index(path_);
+    index.add({
+                  repository("ubuntu", "ubuntu-ui-toolkit", "QML components for Ubuntu", "QML", 50),
+                  repository("qt", "qtbase", "Qt Base (Core, Gui, Widgets)", "C++", 900),
+                  repository("someone", "touch-scope", "An Ubuntu Touch scope in C++", "C++", 3)
+              });
+
+    // Every word must match, the last one as a prefix
+    auto results = index.search("ubuntu touc", 10);
+    ASSERT_EQ(1u, results.size());
+    EXPECT_EQ("someone/touch-scope", results[0].full_name);
+
+    // Matches in the name rank above matches in the description
+    results = index.search("Ubuntu", 10);
+    ASSERT_EQ(2u, results.size());
+    EXPECT_EQ("ubuntu/ubuntu-ui-toolkit", results[0].full_name);
+
+    EXPECT_TRUE(index.search("python", 10).empty());
+    EXPECT_EQ(1u, index.search("c++ qt", 1).size());
+}
+
+TEST_F(TestRepositoryIndex, survives_restart_and_torn_writes) {
+    {
+        RepositoryIndex index(path_);
+        index.add({ repository("qt", "qtbase", "Qt\tBase,\nwith 12:odd, bytes", "C++", 900) });
+
+        // An update replaces the old version
+        index.add({ repository("qt", "qtbase", "Qt\tBase,\nwith 12:odd, bytes", "C++", 901) });
+    }
+
+    // Simulate a crash in the middle of a write
+    FILE *log = fopen(path_.c_str(), "a");
+    ASSERT_NE(nullptr, log);
+    fputs("2:qt,1:", log);
+    fclose(log);
+
+    RepositoryIndex index(path_);
+    auto results = index.search("qtbase", 10);
+    ASSERT_EQ(1u, results.size());
+    EXPECT_EQ(901u, results[0].stargazers_count);
+    EXPECT_EQ("Qt\tBase,\nwith 12:odd, bytes", results[0].description);
+    EXPECT_EQ(1u, index.stats().repositories);
+
+    // New records still go after the last good one
+    index.add({ repository("ubuntu", "unity", "", "C++", 10) });
+    RepositoryIndex reopened(path_);
+    EXPECT_EQ(2u, reopened.stats().repositories);
+}
+
+TEST_F(TestRepositoryIndex, keeps_the_most_recently_fetched) {
+    {
+        RepositoryIndex index(path_, 2);
+        index.add({ repository("qt", "qtbase", "", "C++", 900),
+                    repository("ubuntu", "unity", "", "C++", 10) });
+
+        // Fetching a repository again makes it the most recent
+        index.add({ repository("qt", "qtbase", "", "C++", 901) });
+        index.add({ repository("someone", "touch-scope", "", "C++", 3) });
+
+        EXPECT_EQ(2u, index.stats().repositories);
+        EXPECT_EQ(1u, index.stats().evictions);
+        EXPECT_TRUE(index.search("unity", 10).empty());
+        EXPECT_EQ(2u, index.search("c++", 10).size());
+    }
+
+    // The log still holds everything until it is rewritten, the cap
+    // applies when it is loaded too
+    RepositoryIndex index(path_, 1);
+    EXPECT_EQ(1u, index.stats().repositories);
+    auto results = index.search("c++", 10);
+    ASSERT_EQ(1u, results.size());
+    EXPECT_EQ("someone/touch-scope", results[0].full_name);
+}
+
+}
@@ -0,0 +1,176 @@
+#include <scope/single_flight.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace api;
+using namespace scope;
+
+/**
+ * Keep the tests in an anonymous namespace
+ */
+namespace {
+
+typedef SingleFlight<vector<int>, int> Flights;
+
+/**
+ * A fetch that emits a few items, then waits until released
+ */
+class Fetch {
+public:
+    Fetch() :
+        released_(released_promise_.get_future().share()), calls_(0) {
+    }
+
+    Flights::Fetch function(bool fail = false) {
+        return [this, fail](const CancellationToken &token, const Flights::ItemHandler &emit) {
+            ++calls_;
+            emit(1);
+            emit(2);
+            while (released_.wait_for(chrono::milliseconds(10)) != future_status::ready) {
+                if (token.cancelled()) {
+                    aborted_ = true;
+                    return vector<int>();
+                }
+            }
+            if (fail) {
+                throw domain_error("server error");
+            }
+            emit(3);
+            return vector<int> { 1, 2, 3 };
+        };
+    }
+
+    void release() {
+        released_promise_.set_value();
+    }
+
+    int calls() const {
+        return calls_;
+    }
+
+    bool aborted() const {
+        return aborted_;
+    }
+
+private:
+    promise<void> released_promise_;
+    shared_future<void> released_;
+    atomic<int> calls_;
+    atomic<bool> aborted_ { false };
+};
+
+/**
+ * Wait until a condition holds, for at most a few seconds
+ */
+template<typename Condition>
+bool eventually(Condition condition) {
+    for (int i = 0; i < 500 && !condition(); ++i) {
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+    return condition();
+}
+
+TEST(SingleFlight, callers_share_one_fetch) {
+    Flights flights;
+    Fetch fetch;
+
+    vector<int> first_items, second_items;
+    auto first = async(launch::async, [&]() {
+        return flights.run("qt", CancellationToken(),
+                           [&](int item) { first_items.push_back(item); }, fetch.function());
+    });
+    ASSERT_TRUE(eventually([&]() { return fetch.calls() == 1; }));
+    auto second = async(launch::async, [&]() {
+        return flights.run("qt", CancellationToken(),
+                           [&](int item) { second_items.push_back(item); }, fetch.function());
+    });
+    ASSERT_TRUE(eventually([&]() { return flights.stats().saved == 1; }));
+    fetch.release();
+
+    EXPECT_EQ((vector<int> { 1, 2, 3 }), *first.get());
+    EXPECT_EQ((vector<int> { 1, 2, 3 }), *second.get());
+    EXPECT_EQ(1, fetch.calls());
+
+    // The late caller caught up on the items emitted before it attached
+    EXPECT_EQ((vector<int> { 1, 2, 3 }), first_items);
+    EXPECT_EQ((vector<int> { 1, 2, 3 }), second_items);
+}
+
+TEST(SingleFlight, waiters_get_the_answer_when_the_leader_is_cancelled) {
+    Flights flights;
+    Fetch fetch;
+
+    CancellationToken leader;
+    auto first = async(launch::async, [&]() {
+        return flights.run("qt", leader, Flights::ItemHandler(), fetch.function());
+    });
+    ASSERT_TRUE(eventually([&]() { return fetch.calls() == 1; }));
+    auto second = async(launch::async, [&]() {
+        return flights.run("qt", CancellationToken(), Flights::ItemHandler(), fetch.function());
+    });
+    ASSERT_TRUE(eventually([&]() { return flights.stats().saved == 1; }));
+
+    leader.cancel();
+    EXPECT_FALSE(first.get());
+
+    // Someone still waits, so the fetch goes on
+    fetch.release();
+    auto value = second.get();
+    ASSERT_TRUE(value);
+    EXPECT_EQ((vector<int> { 1, 2, 3 }), *value);
+    EXPECT_FALSE(fetch.aborted());
+    EXPECT_EQ(0u, flights.stats().abandoned);
+}
+
+TEST(SingleFlight, waiters_get_the_error_when_the_fetch_throws) {
+    Flights flights;
+    Fetch fetch;
+
+    auto first = async(launch::async, [&]() {
+        return flights.run("qt", CancellationToken(), Flights::ItemHandler(),
+                           fetch.function(true));
+    });
+    ASSERT_TRUE(eventually([&]() { return fetch.calls() == 1; }));
+    auto second = async(launch::async, [&]() {
+        return flights.run("qt", CancellationToken(), Flights::ItemHandler(),
+                           fetch.function(true));
+    });
+    ASSERT_TRUE(eventually([&]() { return flights.stats().saved == 1; }));
+    fetch.release();
+
+    EXPECT_THROW(first.get(), domain_error);
+    EXPECT_THROW(second.get(), domain_error);
+
+    // A failed fetch is forgotten, the next caller tries again
+    Fetch retry;
+    retry.release();
+    EXPECT_EQ((vector<int> { 1, 2, 3 }),
+              *flights.run("qt", CancellationToken(), Flights::ItemHandler(), retry.function()));
+}
+
+TEST(SingleFlight, aborts_the_fetch_when_everybody_leaves) {
+    Flights flights;
+    Fetch fetch;
+
+    CancellationToken caller;
+    auto first = async(launch::async, [&]() {
+        return flights.run("qt", caller, Flights::ItemHandler(), fetch.function());
+    });
+    ASSERT_TRUE(eventually([&]() { return fetch.calls() == 1; }));
+    caller.cancel();
+
+    EXPECT_FALSE(first.get());
+    EXPECT_TRUE(eventually([&]() { return fetch.aborted(); }));
+    EXPECT_EQ(1u, flights.stats().abandoned);
+}
+
+}
@@ -0,0 +1,104 @@
+#include "temporary-path-test.h"
+
+#include <scope/state_snapshot.h>
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <string>
+#include <thread>
+
+#include <unistd.h>
+
+using namespace std;
+using namespace api;
+using namespace scope;
+
+/**
+ * Keep the tests in an anonymous namespace
+ */
+namespace {
+
+class TestStateSnapshot: public TemporaryPathTest {
+protected:
+    TestStateSnapshot() :
+        TemporaryPathTest("state-snapshot-test.bin") {
+    }
+};
+
+TEST_F(TestStateSnapshot, round_trips_through_the_file) {
+    {
+        StateSnapshot snapshot(path_);
+        EXPECT_EQ("module", snapshot.state()->query);
+        EXPECT_TRUE(snapshot.state()->repositories.empty());
+
+        StateSnapshot::State state;
+        state.query = "scope";
+        state.repo = "ubuntu/unity";
+        state.repositories.push_back(Client::Repository());
+        state.repositories.back().full_name = "ubuntu/unity";
+        state.repositories.back().description = string("with\0nul", 8);
+        state.repositories.back().owner.id = 42;
+        state.repositories.back().fork = true;
+        snapshot.update(state);
+    }
+
+    StateSnapshot snapshot(path_);
+    auto state = snapshot.state();
+    EXPECT_EQ("scope", state->query);
+    EXPECT_EQ("ubuntu/unity", state->repo);
+    ASSERT_EQ(1u, state->repositories.size());
+    EXPECT_EQ("ubuntu/unity", state->repositories[0].full_name);
+    EXPECT_EQ(string("with\0nul", 8), state->repositories[0].description);
+    EXPECT_EQ(42u, state->repositories[0].owner.id);
+    EXPECT_TRUE(state->repositories[0].fork);
+}
+
+TEST_F(TestStateSnapshot, ignores_a_truncated_file) {
+    {
+        StateSnapshot snapshot(path_);
+        StateSnapshot::State state;
+        state.query = "scope";
+        state.repositories.resize(3);
+        snapshot.update(state);
+    }
+    FILE *file = fopen(path_.c_str(), "r+");
+    ASSERT_NE(nullptr, file);
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fclose(file);
+    ASSERT_EQ(0, truncate(path_.c_str(), size - 5));
+
+    StateSnapshot snapshot(path_);
+    EXPECT_EQ("module", snapshot.state()->query);
+    EXPECT_TRUE(snapshot.state()->repositories.empty());
+}
+
+TEST_F(TestStateSnapshot, writes_once_the_updates_settle) {
+    auto exists = [this]() { return access(path_.c_str(), F_OK) == 0; };
+    {
+        StateSnapshot snapshot(path_, chrono::milliseconds(200));
+        StateSnapshot::State state;
+        for (const char *query : { "s", "sc", "sco" }) {
+            state.query = query;
+            snapshot.update(state);
+        }
+
+        // Read back from memory straight away, but not written yet
+        EXPECT_EQ("sco", snapshot.state()->query);
+        EXPECT_FALSE(exists());
+
+        for (int i = 0; i < 100 && !exists(); ++i) {
+            this_thread::sleep_for(chrono::milliseconds(20));
+        }
+        EXPECT_TRUE(exists());
+        EXPECT_EQ("sco", StateSnapshot(path_).state()->query);
+
+        // The last update is written when the snapshot goes away
+        state.query = "scope";
+        snapshot.update(state);
+    }
+    EXPECT_EQ("scope", StateSnapshot(path_).state()->query);
+}
+
+}
@@ -0,0 +1,173 @@
+#include <scope/work_queue.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace api;
+using namespace scope;
+
+/**
+ * Keep the tests in an anonymous namespace
+ */
+namespace {
+
+typedef WorkQueue<string, string> Queue;
+
+/**
+ * A handler that records the items it was given, and holds on to the
+ * item "busy" until released, so the queue fills up behind it
+ */
+class Work {
+public:
+    Work() :
+        released_(released_promise_.get_future().share()) {
+    }
+
+    Queue::Handler handler() {
+        return [this](const string &item, const CancellationToken &stop) {
+            if (item == "busy") {
+                busy_ = true;
+                while (released_.wait_for(chrono::milliseconds(10)) != future_status::ready) {
+                    if (stop.cancelled()) {
+                        aborted_ = true;
+                        return;
+                    }
+                }
+            }
+            lock_guard<mutex> lock(mutex_);
+            handled_.push_back(item);
+        };
+    }
+
+    void release() {
+        released_promise_.set_value();
+    }
+
+    bool busy() const {
+        return busy_;
+    }
+
+    bool aborted() const {
+        return aborted_;
+    }
+
+    vector<string> handled() {
+        lock_guard<mutex> lock(mutex_);
+        return handled_;
+    }
+
+private:
+    promise<void> released_promise_;
+    shared_future<void> released_;
+    atomic<bool> busy_ { false };
+    atomic<bool> aborted_ { false };
+
+    mutex mutex_;
+    vector<string> handled_;
+};
+
+string identity(const string &item) {
+    return item;
+}
+
+/**
+ * Wait until a condition holds, for at most a few seconds
+ */
+template<typename Condition>
+bool eventually(Condition condition) {
+    for (int i = 0; i < 500 && !condition(); ++i) {
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+    return condition();
+}
+
+TEST(WorkQueue, latest_items_first) {
+    Work work;
+    Queue queue(8, 1, identity, work.handler());
+    queue.push({ "busy" });
+    ASSERT_TRUE(eventually([&]() { return work.busy(); }));
+
+    queue.push({ "a", "b" });
+    queue.push({ "c", "d" });
+    work.release();
+
+    ASSERT_TRUE(eventually([&]() { return work.handled().size() == 5; }));
+    EXPECT_EQ((vector<string> { "busy", "c", "d", "a", "b" }), work.handled());
+}
+
+TEST(WorkQueue, items_waiting_are_not_queued_twice) {
+    Work work;
+    Queue queue(8, 1, identity, work.handler());
+    queue.push({ "busy" });
+    ASSERT_TRUE(eventually([&]() { return work.busy(); }));
+
+    queue.push({ "a" });
+    queue.push({ "b", "a" });
+    work.release();
+
+    ASSERT_TRUE(eventually([&]() { return work.handled().size() == 3; }));
+    this_thread::sleep_for(chrono::milliseconds(50));
+    EXPECT_EQ((vector<string> { "busy", "b", "a" }), work.handled());
+}
+
+TEST(WorkQueue, drops_the_oldest_items_beyond_capacity) {
+    Work work;
+    Queue queue(2, 1, identity, work.handler());
+    queue.push({ "busy" });
+    ASSERT_TRUE(eventually([&]() { return work.busy(); }));
+
+    queue.push({ "a", "b" });
+    queue.push({ "c" });
+    EXPECT_EQ(1u, queue.dropped());
+    queue.push({ "d", "e" });
+    EXPECT_EQ(3u, queue.dropped());
+
+    // Dropped items can be queued again
+    queue.push({ "b" });
+    EXPECT_EQ(4u, queue.dropped());
+    work.release();
+
+    ASSERT_TRUE(eventually([&]() { return work.handled().size() == 3; }));
+    this_thread::sleep_for(chrono::milliseconds(50));
+    EXPECT_EQ((vector<string> { "busy", "b", "d" }), work.handled());
+}
+
+TEST(WorkQueue, stops_the_work_in_flight) {
+    Work work;
+    {
+        Queue queue(8, 2, identity, work.handler());
+        queue.push({ "busy" });
+        ASSERT_TRUE(eventually([&]() { return work.busy(); }));
+        queue.push({ "a", "b", "c" });
+        ASSERT_TRUE(eventually([&]() { return work.handled().size() == 3; }));
+        queue.push({ "busy" });
+    }
+
+    // The workers are gone, and the item in flight was given up on
+    EXPECT_TRUE(work.aborted());
+    EXPECT_EQ((vector<string> { "a", "b", "c" }), work.handled());
+}
+
+TEST(WorkQueue, stops_with_items_waiting) {
+    Work work;
+    {
+        Queue queue(8, 1, identity, work.handler());
+        queue.push({ "busy" });
+        ASSERT_TRUE(eventually([&]() { return work.busy(); }));
+        queue.push({ "a", "b" });
+    }
+
+    EXPECT_TRUE(work.aborted());
+    EXPECT_TRUE(work.handled().empty());
+}
+
+}
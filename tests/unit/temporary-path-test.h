@@ -0,0 +1,50 @@
+#ifndef TESTS_UNIT_TEMPORARY_PATH_TEST_H_
+#define TESTS_UNIT_TEMPORARY_PATH_TEST_H_
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include <dirent.h>
+#include <unistd.h>
+
+/**
+ * A fixture for tests writing to a path under $TMPDIR.
+ *
+ * Whatever is at the path is removed before and after each test: a file,
+ * or a directory along with the files in it.
+ */
+class TemporaryPathTest: public ::testing::Test {
+protected:
+    explicit TemporaryPathTest(const std::string &name) {
+        const char *tmpdir = getenv("TMPDIR");
+        path_ = std::string(tmpdir ? tmpdir : "/tmp") + "/" + name;
+    }
+
+    void SetUp() override {
+        clear();
+    }
+
+    void TearDown() override {
+        clear();
+    }
+
+    void clear() {
+        DIR *dir = opendir(path_.c_str());
+        if (dir) {
+            while (dirent *entry = readdir(dir)) {
+                remove((path_ + "/" + entry->d_name).c_str());
+            }
+            closedir(dir);
+            rmdir(path_.c_str());
+        } else {
+            remove(path_.c_str());
+        }
+    }
+
+    std::string path_;
+};
+
+#endif // TESTS_UNIT_TEMPORARY_PATH_TEST_H_